@@ -8,3 +8,13 @@ target_include_directories(aseba_conf INTERFACE ${PROJECT_SOURCE_DIR}/aseba ${PR
 if (WIN32)
     target_compile_definitions(aseba_conf INTERFACE -DWIN32_LEAN_AND_MEAN -DNOMINMAX)
 endif()
+
+# pre-decoded, direct-threaded interpreter of the VM for hosts, relies on computed goto;
+# changes the layout of AsebaVMState, so everything including vm.h must see it
+option(ASEBA_VM_THREADED_DISPATCH "Enable the threaded dispatch engine of the VM (GCC or Clang only)" OFF)
+if (ASEBA_VM_THREADED_DISPATCH)
+    if (NOT CMAKE_C_COMPILER_ID MATCHES "GNU|Clang")
+        message(FATAL_ERROR "ASEBA_VM_THREADED_DISPATCH requires GCC or Clang")
+    endif()
+    target_compile_definitions(aseba_conf INTERFACE ASEBA_VM_THREADED_DISPATCH)
+endif()
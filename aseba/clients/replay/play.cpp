@@ -20,13 +20,17 @@
 #include <dashel/dashel.h>
 #include "common/consts.h"
 #include "common/msg/msg.h"
+#include "common/msg/Trace.h"
 #include "common/utils/utils.h"
 #include "transport/dashel_plugins/dashel-plugins.h"
 #include <time.h>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
 #include <string>
 #include <deque>
+#include <memory>
 
 namespace Aseba {
 using namespace Dashel;
@@ -38,27 +42,70 @@ using namespace std;
 /*@{*/
 
 //! A message player
-//! This class replay saved user messages
+//! This class replay saved user messages, from text or from a binary trace
 class Player : public Hub {
 private:
     using StringList = deque<string>;
 
     bool respectTimings;
     int speedFactor;
-    Stream* in;
+    Stream* in = nullptr;
+    unique_ptr<TraceReader> trace;
     string line;
     UnifiedTime lastTimeStamp;
     UnifiedTime lastEventTime;
 
 public:
-    Player(const char* inputFile, bool respectTimings, int speedFactor)
+    Player(const char* inputFile, bool respectTimings, int speedFactor, unsigned seekTime)
         : respectTimings(respectTimings), speedFactor(speedFactor), lastTimeStamp(0) {
-        if(inputFile)
+        if(inputFile && TraceReader::isTrace(inputFile)) {
+            trace.reset(new TraceReader(inputFile));
+            trace->seek(seekTime);
+        } else if(inputFile)
             in = connect("file:" + string(inputFile) + ";mode=read");
         else
             in = connect("stdin:");
     }
 
+    //! Replay the input until its end
+    void play() {
+        if(trace)
+            playTrace();
+        else
+            run();
+    }
+
+    //! Replay a binary trace, scheduling messages relatively to the first one so that delays do not accumulate
+    void playTrace() {
+        TraceRecord record;
+        UnifiedTime playStart;
+        uint32_t firstTime = 0;
+        bool first = true;
+        while(trace->next(record)) {
+            if(first) {
+                firstTime = record.time;
+                playStart = UnifiedTime();
+                first = false;
+            }
+            if(respectTimings) {
+                const UnifiedTime dueTime(playStart + UnifiedTime(record.time - firstTime) / speedFactor);
+                const UnifiedTime now;
+                if(now < dueTime)
+                    (dueTime - now).sleep();
+            }
+
+            // process connections and disconnections of targets
+            if(!step())
+                return;
+
+            // write message as recorded on all connected streams
+            for(auto destStream : dataStreams) {
+                destStream->write(record.message.frame(), record.message.frameSize());
+                destStream->flush();
+            }
+        }
+    }
+
     StringList tokenize(const string& input) {
         StringList list;
         const size_t inputSize(input.size());
@@ -164,7 +211,9 @@ void dumpHelp(std::ostream& stream, const char* programName) {
     stream << "--fast          : replay messages twice the speed of real time\n";
     stream << "--faster        : replay messages four times the speed of real time\n";
     stream << "--fastest       : replay messages as fast as possible\n";
-    stream << "-f INPUT_FILE   : open INPUT_FILE instead of stdin\n";
+    stream << "--speed N       : replay messages N times the speed of real time\n";
+    stream << "--seek SECONDS  : start replaying SECONDS after the beginning of a binary trace\n";
+    stream << "-f INPUT_FILE   : open INPUT_FILE instead of stdin, either a text or a binary trace recording\n";
     stream << "-h, --help      : shows this help\n";
     stream << "-V, --version   : shows the version number\n";
     stream << "Targets are any valid Dashel targets." << std::endl;
@@ -182,6 +231,7 @@ int main(int argc, char* argv[]) {
     Dashel::initPlugins();
     bool respectTimings = true;
     int speedFactor = 1;
+    unsigned seekTime = 0;
     std::vector<std::string> targets;
     const char* inputFile = nullptr;
 
@@ -196,6 +246,16 @@ int main(int argc, char* argv[]) {
             speedFactor = 2;
         } else if(strcmp(arg, "--faster") == 0) {
             speedFactor = 4;
+        } else if((strcmp(arg, "--speed") == 0) || (strcmp(arg, "--seek") == 0)) {
+            argCounter++;
+            if(argCounter >= argc || atoi(argv[argCounter]) < 0) {
+                dumpHelp(std::cout, argv[0]);
+                return 1;
+            }
+            if(strcmp(arg, "--speed") == 0)
+                speedFactor = std::max(1, atoi(argv[argCounter]));
+            else
+                seekTime = unsigned(atof(argv[argCounter]) * 1000);
         } else if((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0)) {
             dumpHelp(std::cout, argv[0]);
             return 0;
@@ -219,10 +279,10 @@ int main(int argc, char* argv[]) {
         targets.push_back(ASEBA_DEFAULT_TARGET);
 
     try {
-        Aseba::Player player(inputFile, respectTimings, speedFactor);
+        Aseba::Player player(inputFile, respectTimings, speedFactor, seekTime);
         for(size_t i = 0; i < targets.size(); i++)
             player.connect(targets[i]);
-        player.run();
+        player.play();
     } catch(Dashel::DashelException e) {
         std::cerr << e.what() << std::endl;
     }
@@ -20,12 +20,14 @@
 #include <dashel/dashel.h>
 #include "common/consts.h"
 #include "common/msg/msg.h"
+#include "common/msg/Trace.h"
 #include "common/utils/utils.h"
 #include "transport/dashel_plugins/dashel-plugins.h"
 #include <time.h>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <memory>
 
 namespace Aseba {
 using namespace Dashel;
@@ -37,10 +39,34 @@ using namespace std;
 /*@{*/
 
 //! A message recorder.
-//! This class saves user messages
+//! This class saves user messages, as text to stdout or to a binary trace
 class Recorder : public Hub {
+public:
+    //! Record messages to the binary trace fileName instead of stdout
+    bool openTrace(const string& fileName) {
+        trace.reset(new TraceWriter(fileName));
+        return trace->isOpen();
+    }
+
+    //! Process incoming data, writing recorded messages at least every TraceWriter::maxChunkAge ms
+    void record() {
+        if(!trace) {
+            run();
+            return;
+        }
+        while(step(int(TraceWriter::maxChunkAge)))
+            trace->tick();
+        trace->flush();
+    }
+
 protected:
     void incomingData(Stream* stream) override {
+        if(trace) {
+            // messages are copied from their frame as received, without being deserialized
+            trace->write(MessageView::receive(stream, frame));
+            return;
+        }
+
         dumpTime(cout, true);
 
         // receive and deserialize message
@@ -57,6 +83,10 @@ protected:
             cout << setw(2) << setfill('0') << unsigned(*it) << " ";
         cout << dec << endl;
     }
+
+private:
+    unique_ptr<TraceWriter> trace;
+    vector<uint8_t> frame;
 };
 
 /*@}*/
@@ -68,6 +98,7 @@ void dumpHelp(std::ostream& stream, const char* programName) {
     stream << "Aseba rec, record the user messages to stdout for later replay, usage:\n";
     stream << programName << " [options] [targets]*\n";
     stream << "Options:\n";
+    stream << "-o TRACE_FILE   : record to TRACE_FILE in a compact binary format instead of stdout\n";
     stream << "-h, --help      : shows this help\n";
     stream << "-V, --version   : shows the version number\n";
     stream << "Targets are any valid Dashel targets." << std::endl;
@@ -84,6 +115,7 @@ void dumpVersion(std::ostream& stream) {
 int main(int argc, char* argv[]) {
     Dashel::initPlugins();
     std::vector<std::string> targets;
+    const char* traceFile = nullptr;
 
     int argCounter = 1;
 
@@ -96,6 +128,13 @@ int main(int argc, char* argv[]) {
         } else if((strcmp(arg, "-V") == 0) || (strcmp(arg, "--version") == 0)) {
             dumpVersion(std::cout);
             return 0;
+        } else if(strcmp(arg, "-o") == 0) {
+            argCounter++;
+            if(argCounter >= argc) {
+                dumpHelp(std::cout, argv[0]);
+                return 1;
+            } else
+                traceFile = argv[argCounter];
         } else {
             targets.push_back(argv[argCounter]);
         }
@@ -107,9 +146,13 @@ int main(int argc, char* argv[]) {
 
     try {
         Aseba::Recorder recorder;
+        if(traceFile && !recorder.openTrace(traceFile)) {
+            std::cerr << "Cannot create trace file " << traceFile << std::endl;
+            return 1;
+        }
         for(size_t i = 0; i < targets.size(); i++)
             recorder.connect(targets[i]);
-        recorder.run();
+        recorder.record();
     } catch(Dashel::DashelException e) {
         std::cerr << e.what() << std::endl;
     }
@@ -0,0 +1,278 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/consts.h"
+#include "common/msg/msg.h"
+#include "common/msg/TraceIndex.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace Aseba {
+using namespace std;
+namespace bip = boost::interprocess;
+
+/**
+\defgroup trace Binary traces indexing and queries
+*/
+/*@{*/
+
+//! A file mapped read-only in memory
+class MappedFile {
+public:
+    explicit MappedFile(const string& fileName) {
+        try {
+            mapping = bip::file_mapping(fileName.c_str(), bip::read_only);
+            region = bip::mapped_region(mapping, bip::read_only);
+        } catch(const bip::interprocess_exception&) {
+            // missing or empty file
+        }
+    }
+
+    const uint8_t* data() const {
+        return static_cast<const uint8_t*>(region.get_address());
+    }
+    size_t size() const {
+        return region.get_size();
+    }
+
+private:
+    bip::file_mapping mapping;
+    bip::mapped_region region;
+};
+
+//! A trace and its index, both mapped in memory; the index is rebuilt if missing or outdated
+class IndexedTrace {
+public:
+    explicit IndexedTrace(const string& fileName) : trace(fileName), indexFileName(fileName + ".idx") {
+        if(!trace.data())
+            return;
+        index.reset(new MappedFile(indexFileName));
+        valid = index->data() && traceIndex.open(index->data(), index->size(), trace.size());
+        if(valid)
+            return;
+
+        vector<uint8_t> data;
+        if(!TraceIndex::build(trace.data(), trace.size(), data))
+            return;
+        // the outdated index must be unmapped before being rewritten
+        index.reset();
+        {
+            ofstream file(indexFileName, ios::binary | ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+        index.reset(new MappedFile(indexFileName));
+        valid = index->data() && traceIndex.open(index->data(), index->size(), trace.size());
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    MappedFile trace;
+    string indexFileName;
+    unique_ptr<MappedFile> index;
+    TraceIndex traceIndex;
+    bool valid = false;
+};
+
+//! Measure the time taken by f in seconds
+template <typename F>
+double measure(F f) {
+    const auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//! Compare scanning and deserializing the whole trace with building the index and querying it
+int bench(const string& fileName) {
+    const MappedFile trace(fileName);
+    if(!trace.data()) {
+        cerr << "Cannot open " << fileName << endl;
+        return 1;
+    }
+    const double megabytes = double(trace.size()) / (1024 * 1024);
+
+    size_t count = 0;
+    const double scanTime = measure([&] {
+        forEachTraceRecord(trace.data(), trace.size(), [&](uint32_t, uint64_t, const MessageView& message) {
+            unique_ptr<Message> m(message.toMessage());
+            count++;
+        });
+    });
+    cout << "scan and decode: " << count << " messages, " << megabytes / scanTime << " MB/s, "
+         << count / scanTime << " messages/s" << endl;
+
+    vector<uint8_t> data;
+    const double buildTime = measure([&] { TraceIndex::build(trace.data(), trace.size(), data); });
+    TraceIndex index;
+    if(!index.open(data.data(), data.size(), trace.size())) {
+        cerr << fileName << " is not a trace" << endl;
+        return 1;
+    }
+    cout << "index build: " << index.keysCount() << " keys, " << data.size() << " bytes, " << megabytes / buildTime
+         << " MB/s" << endl;
+
+    // random queries of a single source and type over a tenth of the recording
+    const auto all = index.query({});
+    if(all.empty())
+        return 0;
+    const uint32_t duration = all.back().time;
+    mt19937 generator(0);
+    const size_t queries = 1000;
+    size_t found = 0;
+    const double queryTime = measure([&] {
+        for(size_t i = 0; i < queries; ++i) {
+            const auto& entry = all[generator() % all.size()];
+            const MessageView message(TraceIndex::messageAt(trace.data(), trace.size(), entry.offset));
+            TraceIndex::Query query;
+            query.source = message.source();
+            query.type = message.type();
+            query.from = duration ? uint32_t(generator() % duration) : 0;
+            query.to = query.from + duration / 10;
+            for(const auto& e : index.query(query))
+                found += TraceIndex::messageAt(trace.data(), trace.size(), e.offset).isValid();
+        }
+    });
+    cout << "indexed queries: " << queries / queryTime << " queries/s, " << found << " messages found" << endl;
+    return 0;
+}
+
+/*@}*/
+}  // namespace Aseba
+
+
+//! Show usage
+void dumpHelp(std::ostream& stream, const char* programName) {
+    stream << "Aseba trace, index and query binary traces recorded by asebarec, usage:\n";
+    stream << programName << " index TRACE_FILE\n";
+    stream << programName << " query [options] TRACE_FILE\n";
+    stream << programName << " bench TRACE_FILE\n";
+    stream << "Query options:\n";
+    stream << "--source NODE   : only messages from NODE\n";
+    stream << "--type TYPE     : only messages of type TYPE\n";
+    stream << "--from SECONDS  : only messages received SECONDS or more after the start of the recording\n";
+    stream << "--to SECONDS    : only messages received SECONDS or less after the start of the recording\n";
+    stream << "--count         : only print the number of matching messages\n";
+    stream << "The index is stored beside the trace, in TRACE_FILE.idx, and rebuilt when the trace changes.\n";
+    stream << "-h, --help      : shows this help\n";
+    stream << "-V, --version   : shows the version number\n";
+    stream << "Report bugs to: aseba-dev@gna.org" << std::endl;
+}
+
+//! Show version
+void dumpVersion(std::ostream& stream) {
+    stream << "Aseba trace " << ASEBA_VERSION << std::endl;
+    stream << "Aseba protocol " << ASEBA_PROTOCOL_VERSION << std::endl;
+    stream << "Licence LGPLv3: GNU LGPL version 3 <http://www.gnu.org/licenses/lgpl.html>\n";
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        dumpHelp(std::cout, argv[0]);
+        return 1;
+    }
+    const std::string command(argv[1]);
+    if(command == "-h" || command == "--help") {
+        dumpHelp(std::cout, argv[0]);
+        return 0;
+    } else if(command == "-V" || command == "--version") {
+        dumpVersion(std::cout);
+        return 0;
+    }
+
+    Aseba::TraceIndex::Query query;
+    bool countOnly = false;
+    const char* traceFile = nullptr;
+
+    int argCounter = 2;
+
+    while(argCounter < argc) {
+        const char* arg = argv[argCounter];
+
+        if(strcmp(arg, "--count") == 0) {
+            countOnly = true;
+        } else if((strcmp(arg, "--source") == 0) || (strcmp(arg, "--type") == 0) || (strcmp(arg, "--from") == 0) ||
+                  (strcmp(arg, "--to") == 0)) {
+            argCounter++;
+            if(argCounter >= argc) {
+                dumpHelp(std::cout, argv[0]);
+                return 1;
+            }
+            const char* value = argv[argCounter];
+            if(strcmp(arg, "--source") == 0)
+                query.source = int(strtol(value, nullptr, 0));
+            else if(strcmp(arg, "--type") == 0)
+                query.type = int(strtol(value, nullptr, 0));
+            else if(strcmp(arg, "--from") == 0)
+                query.from = uint32_t(atof(value) * 1000);
+            else
+                query.to = uint32_t(atof(value) * 1000);
+        } else {
+            traceFile = arg;
+        }
+        argCounter++;
+    }
+
+    if(!traceFile) {
+        dumpHelp(std::cout, argv[0]);
+        return 1;
+    }
+
+    if(command == "bench")
+        return Aseba::bench(traceFile);
+
+    const Aseba::IndexedTrace trace(traceFile);
+    if(!trace.isValid()) {
+        std::cerr << traceFile << " is not a trace, or cannot be indexed" << std::endl;
+        return 1;
+    }
+
+    if(command == "index") {
+        std::cout << "Indexed " << trace.traceIndex.keysCount() << " sources and types into " << trace.indexFileName
+                  << std::endl;
+        return 0;
+    } else if(command != "query") {
+        dumpHelp(std::cout, argv[0]);
+        return 1;
+    }
+
+    const auto entries = trace.traceIndex.query(query);
+    if(countOnly) {
+        std::cout << entries.size() << std::endl;
+        return 0;
+    }
+    for(const auto& entry : entries) {
+        const auto view(Aseba::TraceIndex::messageAt(trace.trace.data(), trace.trace.size(), entry.offset));
+        std::unique_ptr<Aseba::Message> message(view.toMessage());
+        std::wcout << entry.time / 1000 << L"." << std::setw(3) << std::setfill(L'0') << entry.time % 1000 << L" ";
+        message->dump(std::wcout);
+        std::wcout << std::endl;
+    }
+
+    return 0;
+}
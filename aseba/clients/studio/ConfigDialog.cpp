@@ -48,6 +48,7 @@ CONFIG_PROPERTY_CHECKBOX_HANDLER(ShowHidden, generalpage, showhidden)
 CONFIG_PROPERTY_CHECKBOX_HANDLER(ShowKeywordToolbar, generalpage, keywordToolbar)
 CONFIG_PROPERTY_CHECKBOX_HANDLER(ShowMemoryUsage, generalpage, memoryusage)
 CONFIG_PROPERTY_CHECKBOX_HANDLER(AutoCompletion, editorpage, autoKeyword)
+CONFIG_PROPERTY_CHECKBOX_HANDLER(VectorLoops, generalpage, vectorLoops)
 
 /*** ConfigPage ***/
 ConfigPage::ConfigPage(QString title, QWidget* parent) : QWidget(parent) {
@@ -151,6 +152,14 @@ GeneralPage::GeneralPage(QWidget* parent) : ConfigPage(tr("General Setup"), pare
     // Show line numbers
     gb1layout->addWidget(newCheckbox(tr("Show line numbers"), QStringLiteral("showlinenumbers"), true));
 
+    QGroupBox* gb2 = new QGroupBox(tr("Compiler"));
+    auto* gb2layout = new QVBoxLayout();
+    gb2->setLayout(gb2layout);
+    mainLayout->addWidget(gb2);
+    // Compile assignments between vectors to loops when this makes the bytecode smaller
+    gb2layout->addWidget(
+        newCheckbox(tr("Use loops for vector assignments when smaller"), QStringLiteral("vectorLoops"), true));
+
     mainLayout->addStretch();
 }
 
@@ -62,6 +62,8 @@ public:
     CONFIG_PROPERTY_CHECKBOX_DECLARE(ShowMemoryUsage)
     // autocompletion behaviour
     CONFIG_PROPERTY_CHECKBOX_DECLARE(AutoCompletion)
+    // compiler options
+    CONFIG_PROPERTY_CHECKBOX_DECLARE(VectorLoops)
 
 signals:
     void settingsChanged();
@@ -199,7 +199,7 @@ void NodeTab::run() {
             set_breakpoints_and_run();
         }
     });
-    auto req = m_thymio->load_aseba_code(code.toUtf8());
+    auto req = m_thymio->load_aseba_code(code.toUtf8(), ConfigDialog::getVectorLoops());
     watcher->setRequest(req);
     m_compilation_watcher->setRequest(req);
 }
@@ -214,7 +214,7 @@ void NodeTab::compileCodeOnTarget() {
         return;
 
     auto code = editor->toPlainText();
-    m_compilation_watcher->setRequest(m_thymio->compile_aseba_code(code.toUtf8()));
+    m_compilation_watcher->setRequest(m_thymio->compile_aseba_code(code.toUtf8(), ConfigDialog::getVectorLoops()));
 }
 
 void NodeTab::step() {
@@ -0,0 +1,89 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MessageView.h"
+#ifndef ASEBA_NO_DASHEL
+#    include <dashel/dashel.h>
+#endif
+
+namespace Aseba {
+
+MessageView::MessageView(const uint8_t* data, size_t size) {
+    if(data && size >= headerSize) {
+        this->data = data;
+        if(frameSize() > size)
+            this->data = nullptr;
+    }
+}
+
+#ifndef ASEBA_NO_DASHEL
+MessageView MessageView::receive(Dashel::Stream* stream, std::vector<uint8_t>& storage) {
+    storage.resize(headerSize);
+    stream->read(storage.data(), headerSize);
+    const size_t len = uint16_t(storage[0]) | uint16_t(storage[1] << 8);
+    storage.resize(headerSize + len);
+    if(len)
+        stream->read(storage.data() + headerSize, len);
+    return MessageView(storage.data(), storage.size());
+}
+#endif
+
+bool MessageView::isCommand() const {
+    const uint16_t t = type();
+    // the payload of all CmdMessage subclasses starts with the destination
+    return (t >= ASEBA_MESSAGE_BOOTLOADER_RESET && t <= ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE) ||
+        (t >= ASEBA_MESSAGE_SET_BYTECODE && t <= ASEBA_MESSAGE_GET_NODE_DESCRIPTION) ||
+        (t >= ASEBA_MESSAGE_GET_DEVICE_INFO && t <= ASEBA_MESSAGE_GET_CHANGED_VARIABLES);
+}
+
+bool MessageView::isFromNode() const {
+    const uint16_t t = type();
+    return (t >= ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION && t <= ASEBA_MESSAGE_BOOTLOADER_ACK) ||
+        (t >= ASEBA_MESSAGE_DESCRIPTION && t <= ASEBA_MESSAGE_CHANGED_VARIABLES);
+}
+
+uint16_t MessageView::destination() const {
+    if(!isCommand() || payloadSize() < 2)
+        return ASEBA_DEST_INVALID;
+    return read(headerSize);
+}
+
+void MessageView::appendTo(std::vector<uint8_t>& rawData) const {
+    rawData.insert(rawData.end(), data, data + frameSize());
+}
+
+void MessageView::appendTo(std::vector<uint8_t>& rawData, uint16_t source, uint16_t dest) const {
+    const size_t start = rawData.size();
+    appendTo(rawData);
+    auto write = [&rawData, start](size_t offset, uint16_t value) {
+        rawData[start + offset] = uint8_t(value);
+        rawData[start + offset + 1] = uint8_t(value >> 8);
+    };
+    write(2, source);
+    if(isCommand() && payloadSize() >= 2)
+        write(headerSize, dest);
+}
+
+Message* MessageView::toMessage() const {
+    Message::SerializationBuffer buffer;
+    buffer.rawData.assign(payload(), payload() + payloadSize());
+    return Message::create(source(), type(), buffer);
+}
+
+}  // namespace Aseba
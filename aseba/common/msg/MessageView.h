@@ -0,0 +1,121 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_MSG_VIEW
+#define ASEBA_MSG_VIEW
+
+#include "msg.h"
+#include <cstddef>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup msg */
+/*@{*/
+
+//! Non-owning view over a framed message (len + source + type + payload), as received on the wire.
+/*!
+    A view gives access to the header and to the payload words of a message without
+    allocating nor deserializing it, so that a message can be inspected, routed and
+    re-emitted as is. Use toMessage() to get the full object when its fields are needed.
+    The view is only valid as long as the underlying bytes are.
+*/
+class MessageView {
+public:
+    //! Size in bytes of the header preceding the payload
+    static constexpr size_t headerSize = 6;
+
+    //! An invalid view
+    MessageView() = default;
+    //! Create a view over the first frame of data, invalid if data does not hold a complete frame
+    MessageView(const uint8_t* data, size_t size);
+
+#ifndef ASEBA_NO_DASHEL
+    //! Read a message from stream into storage, which is reused across calls, and return a view on it
+    static MessageView receive(Dashel::Stream* stream, std::vector<uint8_t>& storage);
+#endif
+
+    //! Return whether the view is over a complete frame
+    bool isValid() const {
+        return data != nullptr;
+    }
+
+    //! Return the number of payload bytes
+    uint16_t payloadSize() const {
+        return read(0);
+    }
+    //! Return the number of bytes of the whole frame, header included
+    size_t frameSize() const {
+        return headerSize + payloadSize();
+    }
+    uint16_t source() const {
+        return read(2);
+    }
+    uint16_t type() const {
+        return read(4);
+    }
+
+    //! Return the first byte of the frame
+    const uint8_t* frame() const {
+        return data;
+    }
+    //! Return the first byte of the payload
+    const uint8_t* payload() const {
+        return data + headerSize;
+    }
+
+    //! Return the number of 16-bit words in the payload
+    size_t wordCount() const {
+        return payloadSize() / 2;
+    }
+    //! Return the i-th 16-bit word of the payload, which must be smaller than wordCount()
+    int16_t word(size_t i) const {
+        return static_cast<int16_t>(read(headerSize + 2 * i));
+    }
+
+    //! Return whether this is a message emitted by a script, whose payload is its argument words
+    bool isUserMessage() const {
+        return type() < 0x8000;
+    }
+    //! Return whether this is a command to a specific node, see CmdMessage
+    bool isCommand() const;
+    //! Return whether this message is sent by a node about itself, so that its source is the node
+    bool isFromNode() const;
+    //! Return the node this command is for, or ASEBA_DEST_INVALID if this is not a command
+    uint16_t destination() const;
+
+    //! Append the frame to rawData
+    void appendTo(std::vector<uint8_t>& rawData) const;
+    //! Append the frame to rawData, replacing its source and, for commands, its destination
+    void appendTo(std::vector<uint8_t>& rawData, uint16_t source, uint16_t dest) const;
+
+    //! Deserialize the full message, the caller is responsible for freeing it
+    Message* toMessage() const;
+
+private:
+    uint16_t read(size_t offset) const {
+        return uint16_t(data[offset]) | uint16_t(data[offset + 1] << 8);
+    }
+
+    const uint8_t* data = nullptr;
+};
+
+/*@}*/
+}  // namespace Aseba
+
+#endif  // ASEBA_MSG_VIEW
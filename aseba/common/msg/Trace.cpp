@@ -0,0 +1,199 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Aseba {
+using namespace std;
+
+namespace {
+    const char traceMagic[4] = {'A', 'T', 'R', 'C'};
+    const char chunkMagic[4] = {'A', 'C', 'H', 'K'};
+
+    uint32_t read32(const uint8_t* data) {
+        return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+    }
+    void write32(uint8_t* data, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            data[i] = uint8_t(value >> (8 * i));
+    }
+}  // namespace
+
+namespace TraceFormat {
+    bool ChunkHeader::read(const uint8_t* data, size_t size) {
+        if(size < chunkHeaderSize || memcmp(data, chunkMagic, 4) != 0)
+            return false;
+        this->size = read32(data + 4);
+        count = read32(data + 8);
+        firstTime = read32(data + 12);
+        lastTime = read32(data + 16);
+        return true;
+    }
+
+    void ChunkHeader::write(uint8_t* data) const {
+        memcpy(data, chunkMagic, 4);
+        write32(data + 4, size);
+        write32(data + 8, count);
+        write32(data + 12, firstTime);
+        write32(data + 16, lastTime);
+    }
+
+    bool readHeader(const uint8_t* data, size_t size, UnifiedTime& startTime) {
+        if(size < headerSize || memcmp(data, traceMagic, 4) != 0)
+            return false;
+        if((uint16_t(data[4]) | (uint16_t(data[5]) << 8)) != version)
+            return false;
+        startTime = UnifiedTime(UnifiedTime::Value(read32(data + 8)) | (UnifiedTime::Value(read32(data + 12)) << 32));
+        return true;
+    }
+}  // namespace TraceFormat
+
+//
+
+TraceWriter::TraceWriter(const std::string& fileName, UnifiedTime startTime, size_t chunkSize)
+    : file(fileName, ios::binary | ios::trunc), startTime(startTime), chunkSize(chunkSize) {
+    uint8_t header[TraceFormat::headerSize] = {};
+    memcpy(header, traceMagic, 4);
+    header[4] = uint8_t(TraceFormat::version);
+    header[5] = uint8_t(TraceFormat::version >> 8);
+    write32(header + 8, uint32_t(startTime.value));
+    write32(header + 12, uint32_t(startTime.value >> 32));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    chunk.reserve(chunkSize + TraceFormat::chunkHeaderSize + TraceFormat::recordHeaderSize +
+                  MessageView::headerSize + ASEBA_MAX_EVENT_ARG_SIZE);
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+}
+
+void TraceWriter::write(const MessageView& message, UnifiedTime time) {
+    const uint32_t t = time > startTime ? uint32_t((time - startTime).value) : 0;
+    tick(time);
+
+    if(chunk.empty()) {
+        // room for the header, filled once the chunk is complete
+        chunk.resize(TraceFormat::chunkHeaderSize);
+        chunkHeader.count = 0;
+        chunkHeader.firstTime = t;
+    }
+    const size_t pos = chunk.size();
+    chunk.resize(pos + TraceFormat::recordHeaderSize);
+    write32(chunk.data() + pos, t);
+    message.appendTo(chunk);
+    chunkHeader.count++;
+    chunkHeader.lastTime = max(chunkHeader.lastTime, t);
+    count++;
+
+    if(chunk.size() >= chunkSize)
+        flush();
+}
+
+void TraceWriter::tick(UnifiedTime now) {
+    const uint32_t t = now > startTime ? uint32_t((now - startTime).value) : 0;
+    if(!chunk.empty() && t - chunkHeader.firstTime >= maxChunkAge)
+        flush();
+}
+
+void TraceWriter::flush() {
+    if(chunk.empty())
+        return;
+    chunkHeader.size = uint32_t(chunk.size() - TraceFormat::chunkHeaderSize);
+    chunkHeader.write(chunk.data());
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    file.flush();
+    chunk.clear();
+    chunkHeader = TraceFormat::ChunkHeader();
+}
+
+//
+
+TraceReader::TraceReader(const std::string& fileName) : file(fileName, ios::binary) {
+    uint8_t header[TraceFormat::headerSize];
+    if(file.read(reinterpret_cast<char*>(header), sizeof(header)))
+        valid = TraceFormat::readHeader(header, sizeof(header), startTime);
+}
+
+bool TraceReader::isTrace(const std::string& fileName) {
+    return TraceReader(fileName).isValid();
+}
+
+void TraceReader::seek(uint32_t time) {
+    if(!valid)
+        return;
+    file.clear();
+    file.seekg(TraceFormat::headerSize);
+    chunk.clear();
+    readPos = 0;
+    if(!readChunk(time))
+        return;
+
+    // skip the records of the chunk preceding time
+    while(readPos + TraceFormat::recordHeaderSize <= chunk.size() && read32(chunk.data() + readPos) < time) {
+        const MessageView message(chunk.data() + readPos + TraceFormat::recordHeaderSize,
+                                  chunk.size() - readPos - TraceFormat::recordHeaderSize);
+        if(!message.isValid())
+            break;
+        readPos += TraceFormat::recordHeaderSize + message.frameSize();
+    }
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if(!valid)
+        return false;
+    while(readPos >= chunk.size()) {
+        if(!readChunk(0))
+            return false;
+    }
+    if(readPos + TraceFormat::recordHeaderSize > chunk.size())
+        return false;
+    record.time = read32(chunk.data() + readPos);
+    record.message = MessageView(chunk.data() + readPos + TraceFormat::recordHeaderSize,
+                                 chunk.size() - readPos - TraceFormat::recordHeaderSize);
+    if(!record.message.isValid())
+        return false;
+    readPos += TraceFormat::recordHeaderSize + record.message.frameSize();
+    return true;
+}
+
+bool TraceReader::readChunk(uint32_t skipBefore) {
+    uint8_t data[TraceFormat::chunkHeaderSize];
+    TraceFormat::ChunkHeader header;
+    while(file.read(reinterpret_cast<char*>(data), sizeof(data)) && header.read(data, sizeof(data))) {
+        // only the chunk headers are read until reaching time
+        if(header.lastTime < skipBefore) {
+            file.seekg(header.size, ios::cur);
+            continue;
+        }
+        chunk.resize(header.size);
+        readPos = 0;
+        if(file.read(reinterpret_cast<char*>(chunk.data()), header.size))
+            return true;
+        // an incomplete chunk ends the trace
+        break;
+    }
+    chunk.clear();
+    readPos = 0;
+    return false;
+}
+
+}  // namespace Aseba
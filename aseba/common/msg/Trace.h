@@ -0,0 +1,153 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_MSG_TRACE
+#define ASEBA_MSG_TRACE
+
+#include "MessageView.h"
+#include "../utils/utils.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup msg */
+/*@{*/
+
+/**
+    Binary, append-only recording of the messages seen on a network.
+    All integers are little-endian.
+
+    - file header (16 bytes): "ATRC", version (uint16), reserved (uint16),
+      time of the start of the recording in ms since epoch (uint64)
+    - then a sequence of chunks, each with a header (20 bytes): "ACHK",
+      size of the records of the chunk in bytes (uint32), number of records (uint32),
+      time of the first and of the last record (uint32 each)
+    - each record is a time (uint32) followed by the message as framed on the wire
+      (len, source, type, payload)
+
+    Times of chunks and records are in ms since the start of the recording.
+    Chunk headers act as a sparse index: they allow to skip chunks without reading their content.
+    A chunk is only written once complete, so that an interrupted recording stays readable.
+*/
+namespace TraceFormat {
+    constexpr uint16_t version = 1;
+    constexpr size_t headerSize = 16;
+    constexpr size_t chunkHeaderSize = 20;
+    constexpr size_t recordHeaderSize = 4;
+
+    //! Header of a chunk of records
+    struct ChunkHeader {
+        uint32_t size = 0;
+        uint32_t count = 0;
+        uint32_t firstTime = 0;
+        uint32_t lastTime = 0;
+
+        //! Read a chunk header from data, return false if it does not hold one
+        bool read(const uint8_t* data, size_t size);
+        //! Write the chunk header to data, which must hold chunkHeaderSize bytes
+        void write(uint8_t* data) const;
+    };
+
+    //! Read the header of a trace from data, return false if it does not hold one
+    bool readHeader(const uint8_t* data, size_t size, UnifiedTime& startTime);
+}  // namespace TraceFormat
+
+//! A message read from a trace
+struct TraceRecord {
+    //! time of reception, in ms since the start of the recording
+    uint32_t time = 0;
+    MessageView message;
+};
+
+//! Record messages to a trace file, by chunks
+class TraceWriter {
+public:
+    //! Size of chunks above which they are written to the file
+    static constexpr size_t defaultChunkSize = 64 * 1024;
+    //! Age of the first message of a chunk above which it is written to the file, in ms
+    static constexpr uint32_t maxChunkAge = 1000;
+
+    //! Create a new trace in fileName, whose recording starts at startTime
+    TraceWriter(const std::string& fileName, UnifiedTime startTime = UnifiedTime(),
+                size_t chunkSize = defaultChunkSize);
+    //! Write the last chunk and close the file
+    ~TraceWriter();
+
+    //! Return whether the trace file could be created
+    bool isOpen() const {
+        return file.is_open();
+    }
+    //! Append message received at time to the trace
+    void write(const MessageView& message, UnifiedTime time = UnifiedTime());
+    //! Write the current chunk if it is older than maxChunkAge at time now
+    void tick(UnifiedTime now = UnifiedTime());
+    //! Write the current chunk to the file
+    void flush();
+
+    //! Return the number of messages written so far
+    unsigned long long messagesCount() const {
+        return count;
+    }
+
+private:
+    std::ofstream file;
+    UnifiedTime startTime;
+    size_t chunkSize;
+    std::vector<uint8_t> chunk;
+    TraceFormat::ChunkHeader chunkHeader;
+    unsigned long long count = 0;
+};
+
+//! Read the messages of a trace file in order, by chunks
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& fileName);
+
+    //! Return whether fileName is a trace file
+    static bool isTrace(const std::string& fileName);
+
+    //! Return whether the file is a trace
+    bool isValid() const {
+        return valid;
+    }
+    //! Return the time of the start of the recording
+    UnifiedTime getStartTime() const {
+        return startTime;
+    }
+
+    //! Continue reading from the first message received at or after time, in ms since the start of the recording
+    void seek(uint32_t time);
+    //! Read the next message, return false at the end of the trace; record is valid until the next call
+    bool next(TraceRecord& record);
+
+private:
+    bool readChunk(uint32_t skipBefore);
+
+    std::ifstream file;
+    bool valid = false;
+    UnifiedTime startTime;
+    std::vector<uint8_t> chunk;
+    size_t readPos = 0;
+};
+
+/*@}*/
+}  // namespace Aseba
+
+#endif  // ASEBA_MSG_TRACE
@@ -0,0 +1,171 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TraceIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace Aseba {
+using namespace std;
+
+namespace {
+    const char indexMagic[4] = {'A', 'T', 'I', 'X'};
+    const uint16_t indexVersion = 1;
+    const size_t indexHeaderSize = 24;
+    const size_t keySize = 16;
+    const size_t entrySize = 12;
+
+    uint64_t read(const uint8_t* data, size_t bytes) {
+        uint64_t value = 0;
+        for(size_t i = 0; i < bytes; ++i)
+            value |= uint64_t(data[i]) << (8 * i);
+        return value;
+    }
+    void write(uint8_t* data, uint64_t value, size_t bytes) {
+        for(size_t i = 0; i < bytes; ++i)
+            data[i] = uint8_t(value >> (8 * i));
+    }
+}  // namespace
+
+bool forEachTraceRecord(const uint8_t* data, size_t size,
+                        const std::function<void(uint32_t, uint64_t, const MessageView&)>& f) {
+    UnifiedTime startTime;
+    if(!TraceFormat::readHeader(data, size, startTime))
+        return false;
+
+    size_t pos = TraceFormat::headerSize;
+    TraceFormat::ChunkHeader chunk;
+    while(chunk.read(data + pos, size - pos) && size - pos - TraceFormat::chunkHeaderSize >= chunk.size) {
+        pos += TraceFormat::chunkHeaderSize;
+        const size_t end = pos + chunk.size;
+        while(pos + TraceFormat::recordHeaderSize <= end) {
+            const MessageView message(data + pos + TraceFormat::recordHeaderSize,
+                                      end - pos - TraceFormat::recordHeaderSize);
+            if(!message.isValid())
+                break;
+            f(uint32_t(read(data + pos, 4)), pos, message);
+            pos += TraceFormat::recordHeaderSize + message.frameSize();
+        }
+        pos = end;
+    }
+    return true;
+}
+
+bool TraceIndex::build(const uint8_t* data, size_t size, std::vector<uint8_t>& index) {
+    // group the messages by source and type
+    map<uint32_t, vector<Entry>> messages;
+    const bool isTrace = forEachTraceRecord(data, size, [&](uint32_t time, uint64_t offset, const MessageView& m) {
+        messages[(uint32_t(m.source()) << 16) | m.type()].push_back({time, offset});
+    });
+    if(!isTrace)
+        return false;
+
+    size_t entriesCount = 0;
+    for(const auto& key : messages)
+        entriesCount += key.second.size();
+
+    index.assign(indexHeaderSize + messages.size() * keySize + entriesCount * entrySize, 0);
+    memcpy(index.data(), indexMagic, 4);
+    write(index.data() + 4, indexVersion, 2);
+    write(index.data() + 8, size, 8);
+    write(index.data() + 16, messages.size(), 4);
+
+    uint8_t* key = index.data() + indexHeaderSize;
+    uint8_t* entry = key + messages.size() * keySize;
+    size_t first = 0;
+    for(auto& keyMessages : messages) {
+        auto& entries = keyMessages.second;
+        // the clock of the recorder might have been adjusted during the recording
+        stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+        write(key, keyMessages.first >> 16, 2);
+        write(key + 2, keyMessages.first & 0xffff, 2);
+        write(key + 4, entries.size(), 4);
+        write(key + 8, first, 8);
+        key += keySize;
+        for(const auto& e : entries) {
+            write(entry, e.time, 4);
+            write(entry + 4, e.offset, 8);
+            entry += entrySize;
+        }
+        first += entries.size();
+    }
+    return true;
+}
+
+MessageView TraceIndex::messageAt(const uint8_t* data, size_t size, uint64_t offset) {
+    if(offset + TraceFormat::recordHeaderSize > size)
+        return {};
+    return MessageView(data + offset + TraceFormat::recordHeaderSize,
+                       size - offset - TraceFormat::recordHeaderSize);
+}
+
+bool TraceIndex::open(const uint8_t* data, size_t size, uint64_t traceSize) {
+    this->data = nullptr;
+    if(size < indexHeaderSize || memcmp(data, indexMagic, 4) != 0 || read(data + 4, 2) != indexVersion ||
+       read(data + 8, 8) != traceSize)
+        return false;
+    keys = read(data + 16, 4);
+    if(size < indexHeaderSize + keys * keySize)
+        return false;
+    entries = (size - indexHeaderSize - keys * keySize) / entrySize;
+    this->data = data;
+    return true;
+}
+
+std::vector<TraceIndex::Entry> TraceIndex::query(const Query& query) const {
+    vector<Entry> result;
+    if(!data)
+        return result;
+
+    const uint8_t* entriesData = data + indexHeaderSize + keys * keySize;
+    auto entryTime = [entriesData](size_t i) { return uint32_t(read(entriesData + i * entrySize, 4)); };
+
+    for(size_t k = 0; k < keys; ++k) {
+        const uint8_t* key = data + indexHeaderSize + k * keySize;
+        if(query.source >= 0 && read(key, 2) != uint64_t(query.source))
+            continue;
+        if(query.type >= 0 && read(key + 2, 2) != uint64_t(query.type))
+            continue;
+        const size_t first = read(key + 8, 8);
+        const size_t last = first + read(key + 4, 4);
+        if(last > entries)
+            continue;
+
+        // entries of a key are sorted by time, look for the first one in range
+        size_t begin = first, end = last;
+        while(begin < end) {
+            const size_t middle = begin + (end - begin) / 2;
+            if(entryTime(middle) < query.from)
+                begin = middle + 1;
+            else
+                end = middle;
+        }
+        for(size_t i = begin; i < last && entryTime(i) <= query.to; ++i)
+            result.push_back({entryTime(i), read(entriesData + i * entrySize + 4, 8)});
+    }
+
+    // merge the messages of the different keys
+    sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+        return a.time < b.time || (a.time == b.time && a.offset < b.offset);
+    });
+    return result;
+}
+
+}  // namespace Aseba
@@ -0,0 +1,94 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_MSG_TRACE_INDEX
+#define ASEBA_MSG_TRACE_INDEX
+
+#include "Trace.h"
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup msg */
+/*@{*/
+
+//! Call f(time, offset, message) for every record of a trace held in memory, return false if data is not a trace
+bool forEachTraceRecord(const uint8_t* data, size_t size,
+                        const std::function<void(uint32_t, uint64_t, const MessageView&)>& f);
+
+/**
+    Index of the messages of a trace by source and type, stored beside the trace.
+    All integers are little-endian.
+
+    - header (24 bytes): "ATIX", version (uint16), reserved (uint16),
+      size of the indexed trace (uint64), number of keys (uint32), reserved (uint32)
+    - keys (16 bytes each), sorted by source then type: source (uint16), type (uint16),
+      number of entries (uint32), index of the first entry (uint64)
+    - entries (12 bytes each), sorted by time for each key: time (uint32),
+      offset of the record in the trace (uint64)
+
+    The index works on memory, so that both the trace and the index can be mapped
+    and queried without being read.
+*/
+class TraceIndex {
+public:
+    //! A message of the trace
+    struct Entry {
+        //! time of reception, in ms since the start of the recording
+        uint32_t time;
+        //! offset of the record in the trace
+        uint64_t offset;
+    };
+
+    //! Messages to look for, negative source or type match any
+    struct Query {
+        int source = -1;
+        int type = -1;
+        uint32_t from = 0;
+        uint32_t to = std::numeric_limits<uint32_t>::max();
+    };
+
+    //! Build the index of the trace held in data into index, return false if data is not a trace
+    static bool build(const uint8_t* data, size_t size, std::vector<uint8_t>& index);
+    //! Return the message of the record at offset in trace data
+    static MessageView messageAt(const uint8_t* data, size_t size, uint64_t offset);
+
+    //! Use the index held in data, which must outlive this object; return false if it does not index a trace of
+    //! traceSize bytes
+    bool open(const uint8_t* data, size_t size, uint64_t traceSize);
+
+    //! Return the messages matching query, ordered by time
+    std::vector<Entry> query(const Query& query) const;
+
+    //! Return the number of distinct source and type pairs
+    size_t keysCount() const {
+        return keys;
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t keys = 0;
+    size_t entries = 0;
+};
+
+/*@}*/
+}  // namespace Aseba
+
+#endif  // ASEBA_MSG_TRACE_INDEX
@@ -40,6 +40,19 @@
 #    define bswap16(v) (v)
 #endif
 
+/* Storage of the global state of the VM natives and send buffer, such as the random seed. Hosts
+   running VMs on several threads define ASEBA_VM_THREAD_LOCAL to give each thread its own; other
+   targets, such as firmwares, keep plain static storage. */
+#ifdef ASEBA_VM_THREAD_LOCAL
+#    ifdef _MSC_VER
+#        define ASEBA_VM_GLOBAL_STORAGE static __declspec(thread)
+#    else
+#        define ASEBA_VM_GLOBAL_STORAGE static __thread
+#    endif
+#else
+#    define ASEBA_VM_GLOBAL_STORAGE static
+#endif
+
 /*@}*/
 
 #endif
@@ -0,0 +1,62 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "arena.h"
+#include <algorithm>
+#include <cassert>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+thread_local Arena* Arena::currentArena = nullptr;
+
+//! Return size bytes aligned on alignment, which must be a power of two no larger than the one of
+//! std::max_align_t
+void* Arena::allocate(size_t size, size_t alignment) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    assert(alignment <= alignof(std::max_align_t));
+
+    // blocks are allocated by new[], hence aligned for any type
+    for(; currentBlock < blocks.size(); ++currentBlock, offset = 0) {
+        const size_t start((offset + alignment - 1) & ~(alignment - 1));
+        if(start + size <= blocks[currentBlock].size) {
+            offset = start + size;
+            allocated += size;
+            return blocks[currentBlock].data.get() + start;
+        }
+    }
+
+    const size_t newBlockSize(std::max(blockSize, size));
+    blocks.push_back(Block{std::unique_ptr<char[]>(new char[newBlockSize]), newBlockSize});
+    offset = size;
+    allocated += size;
+    return blocks[currentBlock].data.get();
+}
+
+//! Free all allocations at once, keeping the blocks for the next ones
+void Arena::reset() {
+    currentBlock = 0;
+    offset = 0;
+    allocated = 0;
+}
+
+/*@}*/
+
+}  // namespace Aseba
@@ -0,0 +1,129 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ASEBA_COMPILER_ARENA_H
+#define __ASEBA_COMPILER_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+//! Bump allocator for the nodes and tokens of one compilation.
+//! Its memory is not given back piece by piece, but all at once by reset() or when it is destroyed;
+//! the blocks are kept by reset() for the next compilation.
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+    //! Return the number of bytes allocated since the last reset
+    size_t allocatedSize() const {
+        return allocated;
+    }
+
+    //! Return the arena of the compilation running in this thread, nullptr if there is none
+    static Arena* current() {
+        return currentArena;
+    }
+
+    //! Make an arena the current one of this thread until the end of the scope
+    class Scope {
+    public:
+        explicit Scope(Arena& arena) : previous(currentArena) {
+            currentArena = &arena;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            currentArena = previous;
+        }
+
+    private:
+        Arena* previous;
+    };
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;  //!< blocks of memory, the ones after currentBlock are free
+    size_t blockSize;           //!< size of the blocks, unless an allocation is larger
+    size_t currentBlock{0};     //!< block being filled
+    size_t offset{0};           //!< first free byte in the block being filled
+    size_t allocated{0};        //!< bytes allocated since the last reset
+
+    static thread_local Arena* currentArena;
+};
+
+//! Allocator for standard containers, taking memory from the arena current at its construction, or
+//! from the heap if there was none
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept : arena(Arena::current()) {}
+    explicit ArenaAllocator(Arena* arena) noexcept : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        if(arena)
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) noexcept {
+        if(!arena)
+            ::operator delete(p);
+    }
+    //! Copies belong to the compilation making them
+    ArenaAllocator select_on_container_copy_construction() const {
+        return ArenaAllocator();
+    }
+
+    Arena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena == rhs.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena != rhs.arena;
+}
+
+/*@}*/
+
+}  // namespace Aseba
+
+#endif
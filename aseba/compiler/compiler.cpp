@@ -64,6 +64,11 @@ Compiler::Compiler() {
     commonDefinitions = nullptr;
     freeVariableIndex = 0;
     endVariableIndex = 0;
+    vectorLoops = VectorLoops::NEVER;
+    vectorLoopCandidates = 0;
+    peepholeSavedWords = 0;
+    incrementalCompilation = false;
+    reusedBlocksCount = 0;
     TranslatableError::setTranslateCB(ErrorMessages::defaultCallback);
 }
 
@@ -99,6 +104,17 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         errorDescription = TranslatableError(SourcePos(), ERROR_BROKEN_TARGET).toError();
         return false;
     }
+    freeTemporaryMemory();
+    peepholeSavedWords = 0;
+    reusedBlocksCount = 0;
+    const unsigned firstUserVariable(freeVariableIndex);
+
+    // the tokens and the syntax tree of the previous compilation are gone, reuse their memory for
+    // the ones of this compilation, which are all freed at once by the next one
+    tokens = TokensDeque(ArenaAllocator<Token>(nullptr));
+    arena.reset();
+    tokens = TokensDeque(ArenaAllocator<Token>(&arena));
+    Arena::Scope arenaScope(arena);
 
     // tokenization
     try {
@@ -114,6 +130,12 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         *dump << "\n\n";
     }
 
+    // events and subroutines unchanged since the last successful compilation are not compiled again
+    const bool incremental(incrementalCompilation && !dump);
+    TokensBlocks blocks;
+    if(incremental)
+        prepareIncrementalCompilation(blocks);
+
     // parsing
     std::unique_ptr<Node> program;
     try {
@@ -161,7 +183,12 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         *dump << "Second pass for vectorial operations:\n";
     }
 
+    // choose the assignments between vectors compiled to loops
+    if(vectorLoops == VectorLoops::WHEN_SMALLER)
+        chooseVectorLoops(program.get(), firstUserVariable);
+
     // expand the vectorial nodes into scalar operations
+    vectorLoopCandidates = 0;
     try {
         Node* expandedProgram(program->expandVectorialNodes(dump, this));
         program.release();
@@ -197,6 +224,11 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         Node* optimizedProgram(program->optimize(dump));
         program.release();
         program.reset(optimizedProgram);
+        if(dump)
+            *dump << "\n\n";
+        // all variables are allocated, the memory after them only holds temporaries
+        optimizeDataflow(program.get(), firstUserVariable, freeVariableIndex, targetDescription->variablesSize,
+                         dump);
     } catch(TranslatableError error) {
         errorDescription = error.toError();
         return false;
@@ -225,6 +257,19 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
 
     // fix-up (add of missing STOP and RET bytecodes at code generation)
     preLinkBytecode.fixup(subroutineTable);
+    if(incremental)
+        measureCompiledBlocks(blocks, preLinkBytecode);
+
+    // peephole optimization
+    if(dump)
+        *dump << "Peephole optimizations:\n";
+    peepholeSavedWords = optimizeBytecode(preLinkBytecode, dump);
+    if(dump)
+        *dump << "\n\n";
+
+    // bytecode of the events and subroutines not compiled again
+    if(incremental)
+        peepholeSavedWords += reuseCompiledBlocks(blocks, preLinkBytecode);
 
     // stack check
     if(!verifyStackCalls(preLinkBytecode)) {
@@ -238,6 +283,9 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         return false;
     }
 
+    if(incremental)
+        keepCompiledBlocks(blocks, preLinkBytecode);
+
     if(dump) {
         *dump << "Bytecode:\n";
         disassemble(bytecode, preLinkBytecode, *dump);
@@ -247,6 +295,68 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
     return true;
 }
 
+//! Return whether the next assignment between vectors that can be compiled to a loop must be
+bool Compiler::isNextVectorLoop() {
+    const unsigned candidate(vectorLoopCandidates++);
+    if(vectorLoops == VectorLoops::ALWAYS)
+        return true;
+    return candidate < vectorLoopsChosen.size() && vectorLoopsChosen[candidate];
+}
+
+//! Choose the assignments between vectors of the vectorial tree program compiled to loops: in order,
+//! each one is compiled to a loop if this makes the bytecode smaller than with the ones chosen so
+//! far. As an assignment only changes the bytecode of its event or subroutine, the choices in one
+//! do not depend on the others, as incremental compilation requires.
+void Compiler::chooseVectorLoops(const Node* program, const unsigned firstUserVariable) {
+    vectorLoopsChosen.clear();
+    unsigned smallestSize;
+    try {
+        if(!hasLoopableAssignments(program))
+            return;
+        smallestSize = bytecodeSize(program, firstUserVariable);
+    } catch(TranslatableError error) {
+        // compile() reports it
+        return;
+    }
+    const unsigned candidates(vectorLoopCandidates);
+    for(unsigned i = 0; i < candidates; ++i) {
+        vectorLoopsChosen.push_back(true);
+        try {
+            const unsigned size(bytecodeSize(program, firstUserVariable));
+            if(size < smallestSize) {
+                smallestSize = size;
+                continue;
+            }
+        } catch(TranslatableError error) {
+            // for instance not enough temporary memory for the counter of the loop
+        }
+        vectorLoopsChosen.back() = false;
+    }
+}
+
+//! Return the size of the bytecode of the vectorial tree program, expanded, optimized and emitted as
+//! by compile(); program is not modified
+unsigned Compiler::bytecodeSize(const Node* program, const unsigned firstUserVariable) {
+    vectorLoopCandidates = 0;
+    std::unique_ptr<Node> expandedProgram(program->deepCopy()->expandVectorialNodes(nullptr, this));
+    expandedProgram->typeCheck(this);
+    std::unique_ptr<Node> optimizedProgram(expandedProgram.release()->optimize(nullptr));
+    optimizeDataflow(optimizedProgram.get(), firstUserVariable, freeVariableIndex, targetDescription->variablesSize,
+                     nullptr);
+
+    PreLinkBytecode preLinkBytecode;
+    optimizedProgram->emit(preLinkBytecode);
+    preLinkBytecode.fixup(subroutineTable);
+    optimizeBytecode(preLinkBytecode, nullptr);
+
+    unsigned size(0);
+    for(const auto& event : preLinkBytecode.events)
+        size += event.second.size();
+    for(const auto& subroutine : preLinkBytecode.subroutines)
+        size += subroutine.second.size();
+    return size;
+}
+
 //! Create the final bytecode for a microcontroller
 bool Compiler::link(const PreLinkBytecode& preLinkBytecode, BytecodeVector& bytecode) {
     bytecode.clear();
@@ -28,8 +28,10 @@
 #include <set>
 #include <utility>
 #include <istream>
+#include <atomic>
 
 #include "errors_code.h"
+#include "arena.h"
 #include "common/types.h"
 #include "common/msg/TargetDescription.h"
 #include "common/utils/FormatableString.h"
@@ -139,7 +141,7 @@ struct TranslatableError : public Error {
     Error toError();
     static void setTranslateCB(ErrorMessages::ErrorCallback newCB);
 
-    static ErrorMessages::ErrorCallback translateCB;
+    static std::atomic<ErrorMessages::ErrorCallback> translateCB;
     WFormatableString message;
 };
 
@@ -191,6 +193,9 @@ class Compiler {
 public:
     //! A token is a parsed element of inputs
     struct Token {
+        //! String held in the arena of the compilation
+        using String = std::basic_string<wchar_t, std::char_traits<wchar_t>, ArenaAllocator<wchar_t>>;
+
         enum Type {
             TOKEN_END_OF_STREAM = 0,
             TOKEN_STR_when,
@@ -261,7 +266,7 @@ public:
             TOKEN_OP_MINUS_MINUS
 
         } type{TOKEN_END_OF_STREAM};  //!< type of this token
-        std::wstring sValue;          //!< string version of the value
+        String sValue;                //!< string version of the value
         int iValue{0};                //!< int version of the value, 0 if not applicable
         SourcePos pos;                //!< position of token in source code
 
@@ -269,10 +274,16 @@ public:
         Token(Type type, SourcePos pos = SourcePos(), const std::wstring& value = L"");
         const std::wstring typeName() const;
         std::wstring toWString() const;
+        //! Return a copy of the string version of the value that outlives the compilation
+        std::wstring stringValue() const {
+            return std::wstring(sValue.begin(), sValue.end());
+        }
         operator Type() const {
             return type;
         }
     };
+    //! Tokens of a program, held in the arena of the compilation
+    using TokensDeque = std::deque<Token, ArenaAllocator<Token>>;
 
     //! Description of a subroutine
     struct SubroutineDescriptor {
@@ -294,6 +305,7 @@ public:
     //! Lookup table for event name => id
     typedef std::map<std::wstring, unsigned> EventsMap;
 
+    friend struct ProgramNode;
     friend struct AssignmentNode;
     friend struct CallSubNode;
 
@@ -316,9 +328,36 @@ public:
         TranslatableError::setTranslateCB(newCB);
     }
     static std::wstring translate(ErrorCode error) {
-        return TranslatableError::translateCB(error);
+        return TranslatableError::translateCB.load()(error);
     }
     static bool isKeyword(const std::wstring& word);
+    //! How assignments between vectors computed element by element are compiled
+    enum class VectorLoops {
+        NEVER,         //!< one assignment per element
+        WHEN_SMALLER,  //!< to a loop when this makes the bytecode smaller than expanding and optimizing it
+        ALWAYS         //!< to a loop
+    };
+    //! Set how assignments between vectors are compiled, NEVER by default.
+    //! WHEN_SMALLER compiles the program once more per assignment that could be a loop, to compare
+    //! the sizes of the resulting bytecode; loops take more VM steps than expanded assignments
+    void setVectorLoops(VectorLoops mode) {
+        vectorLoops = mode;
+    }
+    VectorLoops getVectorLoops() const {
+        return vectorLoops;
+    }
+    //! Return the number of words removed from the bytecode by the peephole optimizer at the last compilation
+    unsigned getPeepholeSavedWords() const {
+        return peepholeSavedWords;
+    }
+    void setIncrementalCompilation(bool enabled);
+    bool getIncrementalCompilation() const {
+        return incrementalCompilation;
+    }
+    //! Return the number of events and subroutines whose bytecode was reused at the last compilation
+    unsigned getReusedBlocksCount() const {
+        return reusedBlocksCount;
+    }
 
 protected:
     void internalCompilerError() const;
@@ -343,6 +382,9 @@ protected:
     void freeTemporaryMemory();
     unsigned allocateTemporaryMemory(const SourcePos varPos, const unsigned size);
     AssignmentNode* allocateTemporaryVariable(const SourcePos varPos, Node* rValue);
+    bool isNextVectorLoop();
+    void chooseVectorLoops(const Node* program, unsigned firstUserVariable);
+    unsigned bytecodeSize(const Node* program, unsigned firstUserVariable);
 
     VariablesMap::const_iterator findVariable(const std::wstring& name, const SourcePos& pos) const;
     FunctionsMap::const_iterator findFunction(const std::wstring& name, const SourcePos& pos) const;
@@ -357,9 +399,38 @@ protected:
     bool testNextCharacter(std::wistream& source, SourcePos& pos, wchar_t test, Token::Type tokenIfTrue);
     void dumpTokens(std::wostream& dest) const;
     bool verifyStackCalls(PreLinkBytecode& preLinkBytecode);
+    unsigned optimizeBytecode(PreLinkBytecode& preLinkBytecode, std::wostream* dump) const;
     bool link(const PreLinkBytecode& preLinkBytecode, BytecodeVector& bytecode);
     void disassemble(BytecodeVector& bytecode, const PreLinkBytecode& preLinkBytecode, std::wostream& dump) const;
 
+protected:
+    //! Bytecode of an event or a subroutine kept from a previous compilation
+    struct CompiledBlock {
+        BytecodeVector bytecode;         //!< with lines relative to the declaration, empty for an event without code
+        unsigned peepholeSavedWords{0};  //!< words removed from it by the peephole optimizer
+    };
+    //! Kept bytecode of events and subroutines, by their tokens
+    using CompiledBlocks = std::map<std::wstring, CompiledBlock>;
+    //! An event or a subroutine in the tokens of the program being compiled
+    struct TokensBlock {
+        size_t begin{0};                         //!< index of its first token, onevent or sub
+        size_t end{0};                           //!< index past its last token
+        bool isEvent{true};                      //!< whether this is an event or a subroutine
+        std::wstring name;                       //!< name of the event or subroutine
+        unsigned row{0};                         //!< line of its declaration
+        std::wstring key;                        //!< its tokens, with lines relative to the declaration
+        const CompiledBlock* compiled{nullptr};  //!< kept bytecode, nullptr if it must be compiled
+        unsigned emittedSize{0};                 //!< size of its bytecode before peephole optimization
+    };
+    using TokensBlocks = std::vector<TokensBlock>;
+
+    void prepareIncrementalCompilation(TokensBlocks& blocks);
+    unsigned blockId(const TokensBlock& block) const;
+    BytecodeVector* findBlockBytecode(const TokensBlock& block, PreLinkBytecode& preLinkBytecode) const;
+    void measureCompiledBlocks(TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode) const;
+    unsigned reuseCompiledBlocks(const TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode);
+    void keepCompiledBlocks(const TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode);
+
 protected:
     Node* parseProgram();
 
@@ -404,7 +475,8 @@ protected:
     int expectConstantExpression(SourcePos pos, Node* tree);
 
 protected:
-    std::deque<Token> tokens;                       //!< parsed tokens
+    Arena arena;                                    //!< memory of the tokens and nodes of the current compilation
+    TokensDeque tokens;                             //!< parsed tokens
     VariablesMap variablesMap;                      //!< variables lookup
     ImplementedEvents implementedEvents;            //!< list of implemented events
     FunctionsMap functionsMap;                      //!< functions lookup
@@ -416,6 +488,14 @@ protected:
     unsigned freeVariableIndex;                     //!< index pointing to the first free variable
     unsigned endVariableIndex;                      //!< (endMemory - endVariableIndex) is pointing to the first free
                                                     //!< variable at the end
+    VectorLoops vectorLoops;                        //!< how assignments between vectors are compiled
+    std::vector<bool> vectorLoopsChosen;            //!< with WHEN_SMALLER, which assignments are compiled to loops
+    unsigned vectorLoopCandidates;                  //!< assignments that could be loops met in the current expansion
+    unsigned peepholeSavedWords;                    //!< words removed by the peephole optimizer at the last compilation
+    bool incrementalCompilation;                    //!< whether the bytecode of events and subroutines is kept
+    CompiledBlocks compiledBlocks;                  //!< blocks of the last successful compilation
+    std::wstring compiledBlocksContext;             //!< what the kept bytecode depends on besides its tokens
+    unsigned reusedBlocksCount;                     //!< events and subroutines reused at the last compilation
     const TargetDescription* targetDescription;     //!< description of the target VM
     const CommonDefinitions* commonDefinitions;     //!< common definitions, such as events or some constants
 
@@ -19,6 +19,7 @@
 
 #include "errors_code.h"
 #include "compiler.h"
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -28,7 +29,7 @@ namespace Aseba {
 
 static const wchar_t* error_map[ERROR_END];
 
-ErrorMessages::ErrorMessages() {
+static void fillErrorMap() {
     // compiler.cpp
     error_map[ERROR_BROKEN_TARGET] = L"Broken target description: not enough room for internal variables";
     error_map[ASEBA_ERROR_STACK_OVERFLOW] = L"Execution stack will overflow, check for any recursive "
@@ -191,6 +192,12 @@ ErrorMessages::ErrorMessages() {
     error_map[ERROR_UNKNOWN_ERROR] = L"Unknown error";
 }
 
+ErrorMessages::ErrorMessages() {
+    // compilers may be created concurrently from several threads
+    static std::once_flag errorMapFilled;
+    std::call_once(errorMapFilled, fillErrorMap);
+}
+
 const std::wstring ErrorMessages::defaultCallback(ErrorCode error) {
     if(error >= ERROR_END)
         return std::wstring(error_map[ERROR_UNKNOWN_ERROR]);
@@ -208,11 +215,11 @@ std::wstring Error::toWString() const {
     return oss.str();
 }
 
-ErrorMessages::ErrorCallback TranslatableError::translateCB = nullptr;
+std::atomic<ErrorMessages::ErrorCallback> TranslatableError::translateCB{nullptr};
 
 TranslatableError::TranslatableError(const SourcePos& pos, ErrorCode error) {
     this->pos = pos;
-    message = translateCB(error);
+    message = translateCB.load()(error);
 }
 
 Error TranslatableError::toError() {
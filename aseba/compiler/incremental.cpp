@@ -0,0 +1,228 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "compiler.h"
+#include <cassert>
+#include <string>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+/*
+ * Incremental compilation, at the granularity of events and subroutines
+ *   - A program is made of a header (constants, variables and initialization code) followed by
+ * blocks, each starting with onevent or sub. The code of a block only depends on its own tokens,
+ * on the header, on the names of all subroutines and on the target and common definitions: this
+ * is its context. Temporary variables only live within a statement.
+ *   - After a successful compilation, the bytecode of each block is kept, after peephole
+ * optimization, with lines relative to its declaration. At the next compilation in the same
+ * context, the blocks with the same tokens, wherever they are in the source, are parsed as
+ * declarations only and their kept bytecode replaces the empty one generated, before linking.
+ *   - The header is always compiled; when the context changes, the kept bytecode is dropped.
+ *   - Compilations with a dump are complete and do not change the kept bytecode.
+ */
+
+namespace {
+    void appendName(std::wstring& key, const std::wstring& name) {
+        key += name;
+        key += L'\n';
+    }
+
+    void appendValue(std::wstring& key, int value) {
+        key += std::to_wstring(value);
+        key += L'\n';
+    }
+
+    void appendToken(std::wstring& key, const Compiler::Token& token) {
+        appendValue(key, token.type);
+        key.append(token.sValue.begin(), token.sValue.end());
+        key += L'\n';
+    }
+}  // namespace
+
+//! Keep the bytecode of the events and subroutines of successful compilations, and only compile the
+//! ones that changed in the next compilations
+void Compiler::setIncrementalCompilation(bool enabled) {
+    incrementalCompilation = enabled;
+    if(!enabled) {
+        compiledBlocks.clear();
+        compiledBlocksContext.clear();
+    }
+}
+
+//! Split the tokens into the header and the blocks of the program, and remove the bodies of the
+//! blocks whose bytecode is kept from the previous compilations
+void Compiler::prepareIncrementalCompilation(TokensBlocks& blocks) {
+    // blocks
+    for(size_t i = 0; i < tokens.size(); ++i) {
+        if(tokens[i] != Token::TOKEN_STR_onevent && tokens[i] != Token::TOKEN_STR_sub)
+            continue;
+        if(!blocks.empty())
+            blocks.back().end = i;
+        TokensBlock block;
+        block.begin = i;
+        block.end = tokens.size() - 1;
+        block.isEvent = tokens[i] == Token::TOKEN_STR_onevent;
+        block.row = tokens[i].pos.row;
+        if(i + 1 < tokens.size() && tokens[i + 1] == Token::TOKEN_STRING_LITERAL)
+            block.name = tokens[i + 1].stringValue();
+        blocks.push_back(block);
+    }
+    const size_t headerEnd(blocks.empty() ? tokens.size() - 1 : blocks.front().begin);
+
+    // context
+    std::wstring context;
+    appendName(context, targetDescription->name);
+    appendValue(context, targetDescription->protocolVersion);
+    appendValue(context, targetDescription->bytecodeSize);
+    appendValue(context, targetDescription->variablesSize);
+    appendValue(context, targetDescription->stackSize);
+    for(const auto& variable : targetDescription->namedVariables) {
+        appendName(context, variable.name);
+        appendValue(context, variable.size);
+    }
+    for(const auto& event : targetDescription->localEvents)
+        appendName(context, event.name);
+    for(const auto& function : targetDescription->nativeFunctions) {
+        appendName(context, function.name);
+        for(const auto& parameter : function.parameters) {
+            appendName(context, parameter.name);
+            appendValue(context, parameter.size);
+        }
+    }
+    for(const auto& event : commonDefinitions->events) {
+        appendName(context, event.name);
+        appendValue(context, event.value);
+    }
+    for(const auto& constant : commonDefinitions->constants) {
+        appendName(context, constant.name);
+        appendValue(context, constant.value);
+    }
+    appendValue(context, int(vectorLoops));
+    for(size_t i = 0; i < headerEnd; ++i)
+        appendToken(context, tokens[i]);
+    for(const auto& block : blocks)
+        if(!block.isEvent)
+            appendName(context, block.name);
+    if(context != compiledBlocksContext) {
+        compiledBlocks.clear();
+        compiledBlocksContext = context;
+    }
+
+    // keys of the blocks, and their kept bytecode
+    for(auto& block : blocks) {
+        for(size_t i = block.begin; i < block.end; ++i) {
+            appendValue(block.key, tokens[i].pos.row - block.row);
+            appendToken(block.key, tokens[i]);
+        }
+        const auto compiledIt(compiledBlocks.find(block.key));
+        if(compiledIt != compiledBlocks.end())
+            block.compiled = &compiledIt->second;
+    }
+
+    // only keep the declaration of the blocks which are not compiled
+    const ArenaAllocator<Token> allocator(&arena);
+    TokensDeque toCompile(allocator);
+    toCompile.insert(toCompile.end(), tokens.begin(), tokens.begin() + headerEnd);
+    for(const auto& block : blocks) {
+        if(block.compiled)
+            toCompile.insert(toCompile.end(), tokens.begin() + block.begin, tokens.begin() + block.begin + 2);
+        else
+            toCompile.insert(toCompile.end(), tokens.begin() + block.begin, tokens.begin() + block.end);
+    }
+    toCompile.push_back(tokens.back());
+    tokens.swap(toCompile);
+}
+
+//! Return the identifier of the event or subroutine of block, once the program has been parsed
+unsigned Compiler::blockId(const TokensBlock& block) const {
+    if(block.isEvent) {
+        const auto eventIt(allEventsMap.find(block.name));
+        assert(eventIt != allEventsMap.end());
+        return eventIt->second;
+    }
+    const auto subroutineIt(subroutineReverseTable.find(block.name));
+    assert(subroutineIt != subroutineReverseTable.end());
+    return subroutineIt->second;
+}
+
+//! Return the bytecode of block in preLinkBytecode, nullptr for an event without code
+BytecodeVector* Compiler::findBlockBytecode(const TokensBlock& block, PreLinkBytecode& preLinkBytecode) const {
+    auto& bytecodes(block.isEvent ? preLinkBytecode.events : preLinkBytecode.subroutines);
+    const auto it(bytecodes.find(blockId(block)));
+    return it == bytecodes.end() ? nullptr : &it->second;
+}
+
+//! Record the size of the bytecode of the compiled blocks, before peephole optimization
+void Compiler::measureCompiledBlocks(TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode) const {
+    for(auto& block : blocks) {
+        if(block.compiled)
+            continue;
+        const BytecodeVector* bytecode(findBlockBytecode(block, preLinkBytecode));
+        block.emittedSize = bytecode ? bytecode->size() : 0;
+    }
+}
+
+//! Replace the bytecode generated for the declarations of the blocks not compiled by the one kept,
+//! at their current lines; return the number of words the peephole optimizer saved in it
+unsigned Compiler::reuseCompiledBlocks(const TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode) {
+    unsigned savedWords(0);
+    for(const auto& block : blocks) {
+        if(!block.compiled)
+            continue;
+        // events without code have no bytecode, neither have their declarations
+        if(!block.compiled->bytecode.empty()) {
+            auto& bytecodes(block.isEvent ? preLinkBytecode.events : preLinkBytecode.subroutines);
+            BytecodeVector& bytecode(bytecodes[blockId(block)]);
+            bytecode = block.compiled->bytecode;
+            for(auto& element : bytecode)
+                element.line += block.row;
+            bytecode.lastLine = (unsigned short)(bytecode.lastLine + block.row);
+        }
+        savedWords += block.compiled->peepholeSavedWords;
+        ++reusedBlocksCount;
+    }
+    return savedWords;
+}
+
+//! Keep the bytecode of the blocks of a successful compilation for the next ones
+void Compiler::keepCompiledBlocks(const TokensBlocks& blocks, PreLinkBytecode& preLinkBytecode) {
+    CompiledBlocks kept;
+    for(const auto& block : blocks) {
+        CompiledBlock& compiled(kept[block.key]);
+        if(block.compiled) {
+            compiled = *block.compiled;
+            continue;
+        }
+        const BytecodeVector* bytecode(findBlockBytecode(block, preLinkBytecode));
+        if(bytecode) {
+            compiled.bytecode = *bytecode;
+            for(auto& element : compiled.bytecode)
+                element.line -= block.row;
+            compiled.bytecode.lastLine = (unsigned short)(compiled.bytecode.lastLine - block.row);
+        }
+        compiled.peepholeSavedWords = block.emittedSize - compiled.bytecode.size();
+    }
+    compiledBlocks.swap(kept);
+}
+
+/*@}*/
+
+}  // namespace Aseba
@@ -49,7 +49,8 @@ long int wcstol_fix(const wchar_t* str, wchar_t** endptr, int base) {
 #endif  // ANDROID
 
 //! Construct a new token of given type and value
-Compiler::Token::Token(Type type, SourcePos pos, const std::wstring& value) : type(type), sValue(value), pos(pos) {
+Compiler::Token::Token(Type type, SourcePos pos, const std::wstring& value)
+    : type(type), sValue(value.begin(), value.end()), pos(pos) {
     if(type == TOKEN_INT_LITERAL) {
         long int decode;
         bool wasUnsigned = false;
@@ -161,6 +162,8 @@ void Compiler::tokenize(std::wistream& source) {
     tokens.clear();
     SourcePos pos(0, 0, 0);
     const unsigned tabSize = 4;
+    // buffer for identifiers and numbers, reused to avoid an allocation per token
+    std::wstring s;
 
     // tokenize text source
     while(source.good()) {
@@ -341,8 +344,7 @@ void Compiler::tokenize(std::wistream& source) {
                     throw TranslatableError(pos, ERROR_INVALID_IDENTIFIER).arg((unsigned)c, 0, 16);
 
                 // get a string
-                std::wstring s;
-                s += c;
+                s.assign(1, c);
                 wchar_t nextC = source.peek();
                 int posIncrement = 0;
                 while((source.good()) && (is_utf8_alpha_num(nextC) || (nextC == '_') || (nextC == '.'))) {
@@ -89,26 +89,26 @@ int Compiler::expectAbsoluteInt16Literal(bool negative) const {
 //! Check if next toxen is a valid positive part of a 16 bits signed integer constant
 unsigned Compiler::expectPositiveConstant() const {
     expect(Token::TOKEN_STRING_LITERAL);
-    const std::wstring name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
     const SourcePos pos = tokens.front().pos;
     const ConstantsMap::const_iterator constIt(findConstant(name, pos));
 
     const int value = constIt->second;
     if(value < 0 || value > 32767)
-        throw TranslatableError(tokens.front().pos, ERROR_PCONSTANT_OUT_OF_RANGE).arg(tokens.front().sValue).arg(value);
+        throw TranslatableError(tokens.front().pos, ERROR_PCONSTANT_OUT_OF_RANGE).arg(name).arg(value);
     return value;
 }
 
 //! Check if next toxen is a valid 16 bits signed integer constant
 int Compiler::expectConstant() const {
     expect(Token::TOKEN_STRING_LITERAL);
-    const std::wstring name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
     const SourcePos pos = tokens.front().pos;
     const ConstantsMap::const_iterator constIt(findConstant(name, pos));
 
     const int value = constIt->second;
     if(value < -32768 || value > 32767)
-        throw TranslatableError(tokens.front().pos, ERROR_CONSTANT_OUT_OF_RANGE).arg(tokens.front().sValue).arg(value);
+        throw TranslatableError(tokens.front().pos, ERROR_CONSTANT_OUT_OF_RANGE).arg(name).arg(value);
     return value;
 }
 
@@ -149,7 +149,7 @@ unsigned Compiler::expectGlobalEventId() const {
 
     expect(Token::TOKEN_STRING_LITERAL);
 
-    const std::wstring& name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
     const SourcePos pos = tokens.front().pos;
     const EventsMap::const_iterator eventIt(findGlobalEvent(name, pos));
 
@@ -162,7 +162,7 @@ unsigned Compiler::expectAnyEventId() const {
 
     expect(Token::TOKEN_STRING_LITERAL);
 
-    const std::wstring& name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
     const SourcePos pos = tokens.front().pos;
     const EventsMap::const_iterator eventIt(findAnyEvent(name, pos));
 
@@ -228,7 +228,7 @@ unsigned Compiler::allocateTemporaryMemory(const SourcePos varPos, const unsigne
 }
 
 AssignmentNode* Compiler::allocateTemporaryVariable(const SourcePos varPos, Node* rValue) {
-    static unsigned uid = 0;
+    static std::atomic<unsigned> uid{0};
 
     // allocate the temporary variable
     const unsigned size = rValue->getVectorSize();
@@ -307,7 +307,7 @@ void Compiler::parseConstDef() {
     if(tokens.front() != Token::TOKEN_STRING_LITERAL)
         throw TranslatableError(tokens.front().pos, ERROR_EXPECTING_IDENTIFIER).arg(tokens.front().toWString());
 
-    std::wstring constName = tokens.front().sValue;
+    std::wstring constName = tokens.front().stringValue();
     SourcePos constPos = tokens.front().pos;
     tokens.pop_front();
 
@@ -334,7 +334,7 @@ Node* Compiler::parseVarDef() {
         throw TranslatableError(tokens.front().pos, ERROR_EXPECTING_IDENTIFIER).arg(tokens.front().toWString());
 
     // save variable
-    std::wstring varName = tokens.front().sValue;
+    std::wstring varName = tokens.front().stringValue();
     SourcePos varPos = tokens.front().pos;
     unsigned varSize = Node::E_NOVAL;
     unsigned varAddr = freeVariableIndex;
@@ -490,7 +490,10 @@ Node* Compiler::parseIfWhen(bool edgeSensitive) {
         }
         // if elseif, queue new if directly after and return before parsing trailing end
         if(tokens.front() == Token::TOKEN_STR_elseif) {
-            ifNode->children.push_back(parseIfWhen(false));
+            auto* elseIfNode = static_cast<IfWhenNode*>(parseIfWhen(false));
+            ifNode->children.push_back(elseIfNode);
+            // both end at the same keyword
+            ifNode->endLine = elseIfNode->endLine;
             return ifNode.release();
         }
     }
@@ -705,7 +708,7 @@ Node* Compiler::parseSubDecl() {
 
     expect(Token::TOKEN_STRING_LITERAL);
 
-    const std::wstring& name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
     const SubroutineReverseTable::const_iterator it = subroutineReverseTable.find(name);
     if(it != subroutineReverseTable.end())
         throw TranslatableError(tokens.front().pos, ERROR_SUBROUTINE_ALREADY_DEF).arg(name);
@@ -726,7 +729,7 @@ Node* Compiler::parseCallSub() {
 
     expect(Token::TOKEN_STRING_LITERAL);
 
-    const std::wstring name = tokens.front().sValue;
+    const std::wstring name = tokens.front().stringValue();
 
     tokens.pop_front();
 
@@ -1062,7 +1065,7 @@ TupleVectorNode* Compiler::parseTupleVector(bool compatibility) {
 
 Node* Compiler::parseConstantAndVariable() {
     expect(Token::TOKEN_STRING_LITERAL);
-    std::wstring varName = tokens.front().sValue;
+    std::wstring varName = tokens.front().stringValue();
     if(constantExists(varName)) {
         std::unique_ptr<TupleVectorNode> arrayCtor(new TupleVectorNode(tokens.front().pos));
         arrayCtor->addImmediateValue(expectConstant());
@@ -1075,7 +1078,7 @@ Node* Compiler::parseConstantAndVariable() {
 
 MemoryVectorNode* Compiler::parseVariable() {
     expect(Token::TOKEN_STRING_LITERAL);
-    std::wstring varName = tokens.front().sValue;
+    std::wstring varName = tokens.front().stringValue();
     SourcePos varPos = tokens.front().pos;
     auto varIt(findVariable(varName, varPos));
 
@@ -1227,7 +1230,7 @@ Node* Compiler::parseFunctionCall() {
 
     expect(Token::TOKEN_STRING_LITERAL);
 
-    std::wstring funcName = tokens.front().sValue;
+    std::wstring funcName = tokens.front().stringValue();
     auto funcIt(findFunction(funcName, pos));
 
     const TargetDescription::NativeFunction& function = targetDescription->nativeFunctions[funcIt->second];
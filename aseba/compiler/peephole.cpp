@@ -0,0 +1,361 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "compiler.h"
+#include "common/consts.h"
+#include <cassert>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+/*
+ * Peephole optimizations, performed on the bytecode of each event and subroutine once it has
+ * been fixed up, before linking
+ *   - Jumps are decoded to the instruction they reach; when an instruction is removed, the jumps
+ * to it reach the next instruction instead, so only instructions which have no effect where they
+ * are, or which are never executed, may be removed.
+ *   - The kept instructions keep their source lines, for the debugger.
+ *   - The maximum stack depth computed at emission is kept, as it can only decrease.
+ *
+ * Ex:                                            ->
+ *       LOAD 5                                         SMALL_IMMEDIATE 2
+ *       STORE 5                                        CALL 3
+ *       SMALL_IMMEDIATE 2                              STOP
+ *       SMALL_IMMEDIATE 0
+ *       BINARY_ARITHMETIC +
+ *       CALL 3
+ *       STOP
+ *       STOP
+ */
+
+namespace {
+    //! An instruction of a bytecode vector, with its operands
+    struct Instruction {
+        std::vector<BytecodeElement> elements;  //!< the words of the instruction
+        size_t target{0};                       //!< instruction reached by a jump or a false condition
+        bool removed{false};                    //!< whether the instruction was removed
+
+        unsigned short type() const {
+            return elements[0].bytecode >> 12;
+        }
+        bool isJump() const {
+            return type() == ASEBA_BYTECODE_JUMP || type() == ASEBA_BYTECODE_CONDITIONAL_BRANCH;
+        }
+        bool isTerminal() const {
+            return type() == ASEBA_BYTECODE_STOP || type() == ASEBA_BYTECODE_SUB_RET;
+        }
+        unsigned short line() const {
+            return elements[0].line;
+        }
+    };
+
+    class PeepholeOptimizer {
+    public:
+        PeepholeOptimizer(BytecodeVector& bytecode, std::wostream* dump) : bytecode(bytecode), dump(dump) {}
+
+        //! Optimize the bytecode, return the number of words saved
+        unsigned run() {
+            if(!decode())
+                return 0;
+
+            // every pass might give new opportunities to the others
+            bool changed;
+            do {
+                changed = false;
+                changed |= removeUnreachable();
+                changed |= threadJumps();
+                changed |= removeNoOperations();
+            } while(changed);
+
+            const unsigned oldSize(bytecode.size());
+            encode();
+            return oldSize - bytecode.size();
+        }
+
+    private:
+        //! Split the bytecode into instructions, return false if a jump does not reach one
+        bool decode() {
+            std::vector<size_t> instructionAt(bytecode.size() + 1, SIZE_MAX);
+            std::vector<size_t> targetAddress;
+            for(size_t pc = 0; pc < bytecode.size();) {
+                Instruction instruction;
+                const unsigned size(bytecode[pc].getWordSize());
+                if(pc + size > bytecode.size())
+                    return false;
+                instruction.elements.assign(bytecode.begin() + pc, bytecode.begin() + pc + size);
+                instructionAt[pc] = instructions.size();
+                if(instruction.type() == ASEBA_BYTECODE_JUMP)
+                    targetAddress.push_back(pc + ((signed short)(bytecode[pc] << 4) >> 4));
+                else if(instruction.type() == ASEBA_BYTECODE_CONDITIONAL_BRANCH)
+                    targetAddress.push_back(pc + (signed short)bytecode[pc + 1]);
+                else
+                    targetAddress.push_back(SIZE_MAX);
+                instructions.push_back(instruction);
+                pc += size;
+            }
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                if(targetAddress[i] == SIZE_MAX)
+                    continue;
+                if(targetAddress[i] >= bytecode.size() || instructionAt[targetAddress[i]] == SIZE_MAX)
+                    return false;
+                instructions[i].target = instructionAt[targetAddress[i]];
+            }
+            return true;
+        }
+
+        //! Write back the instructions which were not removed, with their jumps relocated
+        void encode() {
+            std::vector<size_t> address(instructions.size() + 1);
+            size_t pc = 0;
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                address[i] = pc;
+                if(!instructions[i].removed)
+                    pc += instructions[i].elements.size();
+            }
+            address[instructions.size()] = pc;
+
+            const unsigned lastLine(bytecode.lastLine);
+            bytecode.clear();
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                Instruction& instruction(instructions[i]);
+                if(instruction.removed)
+                    continue;
+                if(instruction.isJump()) {
+                    const int displacement(int(address[resolve(instruction.target)]) - int(address[i]));
+                    if(instruction.type() == ASEBA_BYTECODE_JUMP) {
+                        assert(displacement >= -2048 && displacement < 2048);
+                        instruction.elements[0].bytecode &= 0xf000;
+                        instruction.elements[0].bytecode |= displacement & 0x0fff;
+                    } else
+                        instruction.elements[1].bytecode = (unsigned short)displacement;
+                }
+                for(const auto& element : instruction.elements)
+                    bytecode.push_back(element);
+            }
+            bytecode.lastLine = lastLine;
+        }
+
+        //! Return the first instruction not removed from i on, or the number of instructions
+        size_t resolve(size_t i) const {
+            while(i < instructions.size() && instructions[i].removed)
+                ++i;
+            return i;
+        }
+
+        //! Return the instruction executed after i when it does not jump
+        size_t next(size_t i) const {
+            return resolve(i + 1);
+        }
+
+        //! Mark the instructions which can be executed and count the jumps reaching each of them
+        void analyse() {
+            reachable.assign(instructions.size(), false);
+            jumpsTo.assign(instructions.size() + 1, 0);
+            std::vector<size_t> toVisit(1, resolve(0));
+            while(!toVisit.empty()) {
+                const size_t i(toVisit.back());
+                toVisit.pop_back();
+                if(i >= instructions.size() || reachable[i])
+                    continue;
+                reachable[i] = true;
+                const Instruction& instruction(instructions[i]);
+                if(instruction.isJump()) {
+                    const size_t target(resolve(instruction.target));
+                    ++jumpsTo[target];
+                    toVisit.push_back(target);
+                }
+                if(!instruction.isTerminal() && instruction.type() != ASEBA_BYTECODE_JUMP)
+                    toVisit.push_back(next(i));
+            }
+        }
+
+        //! Remove the instructions which are never executed
+        bool removeUnreachable() {
+            analyse();
+            bool changed(false);
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                if(instructions[i].removed || reachable[i])
+                    continue;
+                report(i, L"unreachable code removed");
+                remove(i);
+                changed = true;
+            }
+            return changed;
+        }
+
+        //! Retarget jumps to jumps, replace jumps to the end by the end, remove jumps to the next instruction
+        bool threadJumps() {
+            // addresses before this pass, retargeted jumps must stay in range after removals
+            std::vector<int> address(instructions.size() + 1);
+            int pc(0);
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                address[i] = pc;
+                if(!instructions[i].removed)
+                    pc += instructions[i].elements.size();
+            }
+            address[instructions.size()] = pc;
+
+            bool changed(false);
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                Instruction& instruction(instructions[i]);
+                if(instruction.removed || !instruction.isJump())
+                    continue;
+                const size_t target(resolve(instruction.target));
+                if(target >= instructions.size())
+                    continue;
+                const Instruction& destination(instructions[target]);
+                if(destination.type() == ASEBA_BYTECODE_JUMP && target != i) {
+                    const size_t finalTarget(resolve(destination.target));
+                    const int displacement(address[finalTarget] - address[i]);
+                    const bool inRange(instruction.type() == ASEBA_BYTECODE_CONDITIONAL_BRANCH ||
+                                       (displacement >= -2048 && displacement < 2048));
+                    if(finalTarget != target && inRange) {
+                        report(i, L"jump to jump retargeted");
+                        instruction.target = finalTarget;
+                        changed = true;
+                        continue;
+                    }
+                }
+                if(instruction.type() != ASEBA_BYTECODE_JUMP)
+                    continue;
+                if(destination.isTerminal()) {
+                    report(i, L"jump to end replaced by end");
+                    instruction.elements[0].bytecode = destination.elements[0].bytecode;
+                    changed = true;
+                } else if(target == next(i)) {
+                    report(i, L"jump to next instruction removed");
+                    remove(i);
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        //! Remove sequences of instructions which leave the stack and the memory unchanged
+        bool removeNoOperations() {
+            analyse();
+            bool changed(false);
+            for(size_t i = 0; i < instructions.size(); ++i) {
+                const Instruction& first(instructions[i]);
+                if(first.removed)
+                    continue;
+                const size_t j(next(i));
+                if(j >= instructions.size())
+                    break;
+                const Instruction& second(instructions[j]);
+
+                if(first.isTerminal() && second.elements[0].bytecode == first.elements[0].bytecode) {
+                    report(i, L"duplicated end removed");
+                    remove(i);
+                    changed = true;
+                    analyse();
+                    continue;
+                }
+
+                // a jump to the second instruction would not find the value of the first one on the stack
+                if(jumpsTo[j] != 0)
+                    continue;
+                if(first.type() == ASEBA_BYTECODE_LOAD && second.type() == ASEBA_BYTECODE_STORE &&
+                   (first.elements[0].bytecode & 0x0fff) == (second.elements[0].bytecode & 0x0fff)) {
+                    report(i, L"store of loaded value to the same variable removed");
+                    remove(i);
+                    remove(j);
+                    changed = true;
+                    analyse();
+                } else if(isNeutralImmediate(first, second)) {
+                    report(i, L"arithmetic with neutral immediate removed");
+                    remove(i);
+                    remove(j);
+                    changed = true;
+                    analyse();
+                }
+            }
+            return changed;
+        }
+
+        //! Return whether the immediate pushed by first leaves the left operand of operation unchanged
+        static bool isNeutralImmediate(const Instruction& first, const Instruction& operation) {
+            if(first.type() != ASEBA_BYTECODE_SMALL_IMMEDIATE || operation.type() != ASEBA_BYTECODE_BINARY_ARITHMETIC)
+                return false;
+            const int value(((signed short)(first.elements[0].bytecode << 4) >> 4));
+            switch(operation.elements[0].bytecode & ASEBA_BINARY_OPERATOR_MASK) {
+                case ASEBA_OP_SHIFT_LEFT:
+                case ASEBA_OP_SHIFT_RIGHT:
+                case ASEBA_OP_ADD:
+                case ASEBA_OP_SUB:
+                case ASEBA_OP_BIT_OR:
+                case ASEBA_OP_BIT_XOR: return value == 0;
+                case ASEBA_OP_MULT:
+                case ASEBA_OP_DIV: return value == 1;
+                case ASEBA_OP_BIT_AND: return value == -1;
+                default: return false;
+            }
+        }
+
+        void remove(size_t i) {
+            instructions[i].removed = true;
+        }
+
+        void report(size_t i, const wchar_t* message) const {
+            if(dump)
+                *dump << L"    line " << std::setw(4) << std::left << instructions[i].line() + 1 << L" " << message
+                      << L"\n";
+        }
+
+        BytecodeVector& bytecode;
+        std::wostream* dump;
+        std::vector<Instruction> instructions;
+        std::vector<bool> reachable;
+        std::vector<unsigned> jumpsTo;
+    };
+}  // namespace
+
+//! Remove redundant instructions and jumps from the bytecode of events and subroutines
+//! \param preLinkBytecode the fixed-up bytecode
+//! \param dump stream to send dump messages to
+//! \return the number of words saved
+unsigned Compiler::optimizeBytecode(PreLinkBytecode& preLinkBytecode, std::wostream* dump) const {
+    unsigned savedWords(0);
+    for(auto& event : preLinkBytecode.events) {
+        if(dump) {
+            if(event.first == ASEBA_EVENT_INIT)
+                *dump << L"init:\n";
+            else
+                *dump << L"event " << eventName(event.first) << L":\n";
+        }
+        savedWords += PeepholeOptimizer(event.second, dump).run();
+    }
+    for(auto& subroutine : preLinkBytecode.subroutines) {
+        if(dump)
+            *dump << L"sub " << subroutineTable[subroutine.first].name << L":\n";
+        savedWords += PeepholeOptimizer(subroutine.second, dump).run();
+    }
+    if(dump)
+        *dump << L"Saved " << savedWords << L" words\n";
+    return savedWords;
+}
+
+/*@}*/
+
+}  // namespace Aseba
@@ -51,6 +51,29 @@ Node::~Node() {
     }
 }
 
+// nodes are preceded by the arena holding them, nullptr if they are on the heap; this keeps the
+// alignment of std::max_align_t
+static const size_t nodeHeaderSize = alignof(std::max_align_t);
+
+void* Node::operator new(size_t size) {
+    Arena* arena(Arena::current());
+    char* block;
+    if(arena)
+        block = static_cast<char*>(arena->allocate(nodeHeaderSize + size));
+    else
+        block = static_cast<char*>(::operator new(nodeHeaderSize + size));
+    *reinterpret_cast<Arena**>(block) = arena;
+    return block + nodeHeaderSize;
+}
+
+void Node::operator delete(void* p) {
+    if(!p)
+        return;
+    char* block(static_cast<char*>(p) - nodeHeaderSize);
+    if(!*reinterpret_cast<Arena**>(block))
+        ::operator delete(block);
+}
+
 Node* Node::deepCopy() const {
     Node* newCopy = shallowCopy();
     for(size_t i = 0; i < children.size(); i++)
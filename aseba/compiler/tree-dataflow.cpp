@@ -0,0 +1,682 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tree.h"
+#include "power-of-two.h"
+#include "common/utils/FormatableString.h"
+#include "common/utils/utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <typeinfo>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+/*
+ * Dataflow optimizations, performed on the tree once it has been optimized node by node
+ *   - They work on segments: sequences of assignments to variables (StoreNode) or to array
+ * elements (ArrayWriteNode) executed one after the other, through nested blocks. Any other
+ * statement (conditional, loop, emit, function or subroutine call, return, event or subroutine
+ * declaration) ends the segment and is considered to read and write all the memory; the blocks
+ * of conditionals and loops form their own segments.
+ *   - The variables of the target might be changed by the target at any time, so their values are
+ * never tracked and stores to them never removed.
+ *   - Temporaries, at the end of the memory, are not used past the end of an event or subroutine.
+ *   - Expressions that might fail at run time, by an array access out of bounds or a division by
+ * zero, are neither removed nor moved past other statements, so that the error is still reported.
+ *   - Constants are computed on 16 bits, as by the VM.
+ *   - Removed nodes are set to nullptr in their parent until the end, so that the addresses of
+ * the statements of the segments stay valid.
+ *
+ * Ex: in an event, with temporaries t1 and t2:
+ *       i = 2                                  i = 2
+ *       t1 = a[i] * 8                          x = (a[2] << 3) + b
+ *       x = t1 + b                             y = x - b + 1
+ *       t2 = x - b                   ->
+ *       y = t2 + 1
+ */
+
+namespace {
+    //! A set of memory ranges read by an expression
+    struct Reads {
+        std::vector<std::pair<unsigned, unsigned>> ranges;  //!< [begin, end) of the ranges
+        bool all{false};                                     //!< the expression might read anything
+
+        void add(unsigned begin, unsigned end) {
+            ranges.emplace_back(begin, end);
+        }
+        bool overlaps(unsigned begin, unsigned end) const {
+            if(all)
+                return true;
+            for(const auto& range : ranges)
+                if(range.first < end && begin < range.second)
+                    return true;
+            return false;
+        }
+        bool contains(unsigned addr) const {
+            return overlaps(addr, addr + 1);
+        }
+    };
+
+    //! What follows a segment
+    enum class SegmentEnd {
+        OTHER,        //!< a statement that might use anything, or the end of a block
+        END_OF_CODE,  //!< the end of an event or a subroutine
+    };
+
+    //! A sequence of assignments executed one after the other
+    struct Segment {
+        std::vector<Node**> statements;         //!< slots holding the assignments in their parent
+        SegmentEnd end{SegmentEnd::OTHER};      //!< what follows the segment
+        Node* next{nullptr};                    //!< the statement ending the segment, if any
+    };
+
+    //! Return whether node is an assignment to a variable or to an array element
+    bool isSegmentStatement(const Node* node) {
+        if(!dynamic_cast<const AssignmentNode*>(node) || node->children.size() != 2)
+            return false;
+        return dynamic_cast<const StoreNode*>(node->children[0]) ||
+            dynamic_cast<const ArrayWriteNode*>(node->children[0]);
+    }
+
+    //! Add the memory read by expression to reads
+    void collectReads(const Node* expression, Reads& reads) {
+        if(dynamic_cast<const ImmediateNode*>(expression))
+            return;
+        auto* load = dynamic_cast<const LoadNode*>(expression);
+        if(load) {
+            reads.add(load->varAddr, load->varAddr + 1);
+            return;
+        }
+        auto* arrayRead = dynamic_cast<const ArrayReadNode*>(expression);
+        if(arrayRead)
+            reads.add(arrayRead->arrayAddr, arrayRead->arrayAddr + arrayRead->arraySize);
+        else if(!dynamic_cast<const BinaryArithmeticNode*>(expression) &&
+                !dynamic_cast<const UnaryArithmeticNode*>(expression)) {
+            reads.all = true;
+            return;
+        }
+        for(const auto child : expression->children)
+            collectReads(child, reads);
+    }
+
+    //! Return the memory read by an assignment, including the index of an array element
+    Reads statementReads(const Node* statement) {
+        Reads reads;
+        collectReads(statement->children[1], reads);
+        auto* arrayWrite = dynamic_cast<const ArrayWriteNode*>(statement->children[0]);
+        if(arrayWrite)
+            collectReads(arrayWrite->children[0], reads);
+        return reads;
+    }
+
+    //! Return a string identifying the computation of expression, or an empty string if not supported
+    std::wstring expressionKey(const Node* expression) {
+        auto* immediate = dynamic_cast<const ImmediateNode*>(expression);
+        if(immediate)
+            return WFormatableString(L"#%0").arg(immediate->value);
+        auto* load = dynamic_cast<const LoadNode*>(expression);
+        if(load)
+            return WFormatableString(L"@%0").arg(load->varAddr);
+
+        std::wstring key;
+        auto* arrayRead = dynamic_cast<const ArrayReadNode*>(expression);
+        auto* binary = dynamic_cast<const BinaryArithmeticNode*>(expression);
+        auto* unary = dynamic_cast<const UnaryArithmeticNode*>(expression);
+        if(arrayRead)
+            key = WFormatableString(L"[%0:%1]").arg(arrayRead->arrayAddr).arg(arrayRead->arraySize);
+        else if(binary)
+            key = WFormatableString(L"b%0").arg(binary->op);
+        else if(unary)
+            key = WFormatableString(L"u%0").arg(unary->op);
+        else
+            return std::wstring();
+
+        key += L"(";
+        for(const auto child : expression->children) {
+            const std::wstring childKey(expressionKey(child));
+            if(childKey.empty())
+                return std::wstring();
+            key += childKey + L" ";
+        }
+        return key + L")";
+    }
+
+    //! Return whether expression is a computation worth keeping the result of
+    bool isComputation(const Node* expression) {
+        return dynamic_cast<const BinaryArithmeticNode*>(expression) ||
+            dynamic_cast<const UnaryArithmeticNode*>(expression) || dynamic_cast<const ArrayReadNode*>(expression);
+    }
+
+    //! Return value as held in a word of the VM, which computes on 16 bits
+    int wordValue(int value) {
+        return int16_t(value);
+    }
+
+    //! Return whether evaluating expression might raise an error at run time, such as an array
+    //! access out of bounds or a division by zero
+    bool mightFail(const Node* expression) {
+        auto* arrayRead = dynamic_cast<const ArrayReadNode*>(expression);
+        if(arrayRead && !dynamic_cast<const ImmediateNode*>(arrayRead->children[0]))
+            return true;
+        auto* binary = dynamic_cast<const BinaryArithmeticNode*>(expression);
+        if(binary && (binary->op == ASEBA_OP_DIV || binary->op == ASEBA_OP_MOD)) {
+            auto* divisor = dynamic_cast<const ImmediateNode*>(binary->children[1]);
+            if(!divisor || wordValue(divisor->value) == 0)
+                return true;
+        }
+        if(!arrayRead && !binary && !dynamic_cast<const UnaryArithmeticNode*>(expression) &&
+           !dynamic_cast<const ImmediateNode*>(expression) && !dynamic_cast<const LoadNode*>(expression))
+            return true;
+        for(const auto child : expression->children)
+            if(mightFail(child))
+                return true;
+        return false;
+    }
+
+    //! Return whether the value of expression is known to be positive or zero
+    bool isNonNegative(const Node* expression) {
+        auto* immediate = dynamic_cast<const ImmediateNode*>(expression);
+        if(immediate)
+            return immediate->value >= 0;
+        auto* unary = dynamic_cast<const UnaryArithmeticNode*>(expression);
+        if(unary)
+            return unary->op == ASEBA_UNARY_OP_NOT;
+        auto* binary = dynamic_cast<const BinaryArithmeticNode*>(expression);
+        if(!binary)
+            return false;
+        // comparisons and logic operations return 0 or 1
+        if(binary->op >= ASEBA_OP_EQUAL && binary->op <= ASEBA_OP_AND)
+            return true;
+        if(binary->op == ASEBA_OP_BIT_AND)
+            return isNonNegative(binary->children[0]) || isNonNegative(binary->children[1]);
+        return false;
+    }
+
+    //! Return the number of loads of variable addr in node, or -1 if addr might be read through an array
+    int countLoads(const Node* node, unsigned addr) {
+        auto* load = dynamic_cast<const LoadNode*>(node);
+        if(load)
+            return load->varAddr == addr ? 1 : 0;
+        auto* arrayRead = dynamic_cast<const ArrayReadNode*>(node);
+        if(arrayRead && arrayRead->arrayAddr <= addr && addr < arrayRead->arrayAddr + arrayRead->arraySize)
+            return -1;
+        int count = 0;
+        for(const auto child : node->children) {
+            const int childCount(countLoads(child, addr));
+            if(childCount < 0)
+                return -1;
+            count += childCount;
+        }
+        return count;
+    }
+
+    //! Replace the first load of variable addr in node by expression, return whether it was found
+    bool replaceLoad(Node*& node, unsigned addr, Node* expression) {
+        auto* load = dynamic_cast<LoadNode*>(node);
+        if(load && load->varAddr == addr) {
+            delete node;
+            node = expression;
+            return true;
+        }
+        for(auto& child : node->children)
+            if(replaceLoad(child, addr, expression))
+                return true;
+        return false;
+    }
+
+    class DataflowOptimizer {
+    public:
+        DataflowOptimizer(unsigned firstUserVariable, unsigned firstTemporary, unsigned variablesSize,
+                          std::wostream* dump)
+            : firstUserVariable(firstUserVariable)
+            , firstTemporary(firstTemporary)
+            , variablesSize(variablesSize)
+            , dump(dump) {}
+
+        void run(Node* program) {
+            Segment current;
+            for(auto& child : program->children)
+                collect(child, current);
+            current.end = SegmentEnd::END_OF_CODE;
+            segments.push_back(current);
+
+            if(dump)
+                *dump << L"Constant propagation:\n";
+            for(auto& segment : segments)
+                propagateConstants(segment);
+            if(dump)
+                *dump << L"\nCommon subexpression elimination:\n";
+            for(auto& segment : segments)
+                eliminateCommonSubexpressions(segment);
+            if(dump)
+                *dump << L"\nDead store elimination:\n";
+            for(auto& segment : segments) {
+                forwardTemporaries(segment);
+                eliminateDeadStores(segment);
+            }
+            if(dump)
+                *dump << L"\nStrength reduction:\n";
+            reduceStrength(program);
+
+            removeDeleted(program);
+        }
+
+    private:
+        //! Add the statement in slot to the current segment, or end it
+        void collect(Node*& slot, Segment& current) {
+            Node* node = slot;
+            if(!node)
+                return;
+            if(isSegmentStatement(node)) {
+                current.statements.push_back(&slot);
+                return;
+            }
+            if(typeid(*node) == typeid(BlockNode)) {
+                for(auto& child : node->children)
+                    collect(child, current);
+                return;
+            }
+
+            // any other statement ends the segment
+            if(dynamic_cast<EventDeclNode*>(node) || dynamic_cast<SubDeclNode*>(node) ||
+               dynamic_cast<ReturnNode*>(node))
+                current.end = SegmentEnd::END_OF_CODE;
+            current.next = node;
+            segments.push_back(current);
+            current = Segment();
+
+            // the blocks of conditionals and loops form their own segments
+            if(dynamic_cast<FoldedIfWhenNode*>(node)) {
+                for(size_t i = 2; i < node->children.size(); ++i)
+                    collectBlock(node->children[i]);
+            } else if(dynamic_cast<FoldedWhileNode*>(node)) {
+                collectBlock(node->children[2]);
+            }
+        }
+
+        void collectBlock(Node* block) {
+            if(!dynamic_cast<BlockNode*>(block))
+                return;
+            Segment current;
+            for(auto& child : block->children)
+                collect(child, current);
+            segments.push_back(current);
+        }
+
+        //! Return whether the value of variable at addr only changes through the program
+        bool isTracked(unsigned addr) const {
+            return addr >= firstUserVariable;
+        }
+        //! Return whether reads include a variable of the target
+        bool readsTarget(const Reads& reads) const {
+            return reads.overlaps(0, firstUserVariable);
+        }
+
+        //! Re-optimize node after some of its children were replaced by constants; as the VM, compute
+        //! on 16 bits, so that for instance 200 * 200 / 100 gives -255
+        void fold(Node*& node) {
+            for(auto child : node->children) {
+                auto* immediate = dynamic_cast<ImmediateNode*>(child);
+                if(immediate)
+                    immediate->value = wordValue(immediate->value);
+            }
+            try {
+                node = node->optimize(dump);
+            } catch(const TranslatableError&) {
+                // the optimization found an error, such as a division by zero, that happens at run
+                // time only when this code is reached; the node was left unchanged
+            }
+            auto* immediate = dynamic_cast<ImmediateNode*>(node);
+            if(immediate)
+                immediate->value = wordValue(immediate->value);
+        }
+
+        //! Replace the loads of variables of known values in the index of an array access, unless
+        //! the resulting constant index is out of the array
+        void substituteIndex(Node*& index, unsigned arraySize, const std::map<unsigned, int>& values) {
+            std::unique_ptr<Node> newIndex(index->deepCopy());
+            Node* newIndexPtr = newIndex.release();
+            substitute(newIndexPtr, values);
+            newIndex.reset(newIndexPtr);
+            auto* immediate = dynamic_cast<ImmediateNode*>(newIndex.get());
+            if(immediate && (immediate->value < 0 || immediate->value >= int(arraySize)))
+                return;
+            delete index;
+            index = newIndex.release();
+        }
+
+        //! Replace the loads of variables of known values in expression
+        void substitute(Node*& expression, const std::map<unsigned, int>& values) {
+            auto* load = dynamic_cast<LoadNode*>(expression);
+            if(load) {
+                auto it = values.find(load->varAddr);
+                if(it == values.end())
+                    return;
+                if(dump)
+                    *dump << load->sourcePos.toWString() << L" variable at " << load->varAddr
+                          << L" replaced by its value " << it->second << L"\n";
+                const SourcePos pos(load->sourcePos);
+                delete expression;
+                expression = new ImmediateNode(pos, it->second);
+                return;
+            }
+
+            auto* arrayRead = dynamic_cast<ArrayReadNode*>(expression);
+            if(arrayRead) {
+                substituteIndex(arrayRead->children[0], arrayRead->arraySize, values);
+                if(dynamic_cast<ImmediateNode*>(arrayRead->children[0])) {
+                    fold(expression);
+                    substitute(expression, values);
+                }
+                return;
+            }
+
+            if(!dynamic_cast<BinaryArithmeticNode*>(expression) && !dynamic_cast<UnaryArithmeticNode*>(expression))
+                return;
+            bool constantChild(false);
+            for(auto& child : expression->children) {
+                substitute(child, values);
+                constantChild = constantChild || dynamic_cast<ImmediateNode*>(child);
+            }
+            if(constantChild)
+                fold(expression);
+        }
+
+        //! Replace loads of variables whose value is known since an earlier assignment of the segment
+        void propagateConstants(Segment& segment) {
+            std::map<unsigned, int> values;
+            for(auto slot : segment.statements) {
+                Node* statement = *slot;
+                if(!statement)
+                    continue;
+
+                auto* arrayWrite = dynamic_cast<ArrayWriteNode*>(statement->children[0]);
+                if(arrayWrite) {
+                    substituteIndex(arrayWrite->children[0], arrayWrite->arraySize, values);
+                    if(dynamic_cast<ImmediateNode*>(arrayWrite->children[0]))
+                        fold(statement->children[0]);
+                }
+                substitute(statement->children[1], values);
+
+                auto* store = dynamic_cast<StoreNode*>(statement->children[0]);
+                if(store) {
+                    auto* immediate = dynamic_cast<ImmediateNode*>(statement->children[1]);
+                    if(immediate && isTracked(store->varAddr))
+                        values[store->varAddr] = wordValue(immediate->value);
+                    else
+                        values.erase(store->varAddr);
+                } else {
+                    arrayWrite = polymorphic_downcast<ArrayWriteNode*>(statement->children[0]);
+                    values.erase(values.lower_bound(arrayWrite->arrayAddr),
+                                 values.lower_bound(arrayWrite->arrayAddr + arrayWrite->arraySize));
+                }
+            }
+
+            // the condition of an if or when is evaluated right after the segment
+            auto* ifWhen = dynamic_cast<FoldedIfWhenNode*>(segment.next);
+            if(ifWhen) {
+                substitute(ifWhen->children[0], values);
+                substitute(ifWhen->children[1], values);
+            }
+        }
+
+        //! A computation whose result is stored in a variable
+        struct Available {
+            std::wstring key;  //!< computation, see expressionKey()
+            unsigned addr;     //!< variable holding the result
+            Reads reads;       //!< memory read by the computation
+        };
+
+        //! Replace the computations of expression already stored in a variable by a load of it
+        void reuse(Node*& expression, const std::vector<Available>& available) {
+            if(!isComputation(expression))
+                return;
+            const std::wstring key(expressionKey(expression));
+            for(const auto& entry : available) {
+                if(!key.empty() && entry.key == key) {
+                    if(dump)
+                        *dump << expression->sourcePos.toWString() << L" " << expression->toNodeName()
+                              << L" replaced by variable at " << entry.addr << L" holding its result\n";
+                    const SourcePos pos(expression->sourcePos);
+                    delete expression;
+                    expression = new LoadNode(pos, entry.addr);
+                    return;
+                }
+            }
+            for(auto& child : expression->children)
+                reuse(child, available);
+        }
+
+        //! Reuse the computations already stored in variables earlier in the segment
+        void eliminateCommonSubexpressions(Segment& segment) {
+            std::vector<Available> available;
+            for(auto slot : segment.statements) {
+                Node* statement = *slot;
+                if(!statement)
+                    continue;
+
+                auto* arrayWrite = dynamic_cast<ArrayWriteNode*>(statement->children[0]);
+                if(arrayWrite)
+                    reuse(arrayWrite->children[0], available);
+                reuse(statement->children[1], available);
+
+                // forget the computations whose inputs or result change
+                unsigned begin, end;
+                auto* store = dynamic_cast<StoreNode*>(statement->children[0]);
+                if(store) {
+                    begin = store->varAddr;
+                    end = begin + 1;
+                } else {
+                    begin = arrayWrite->arrayAddr;
+                    end = begin + arrayWrite->arraySize;
+                }
+                for(auto it = available.begin(); it != available.end();) {
+                    if(it->reads.overlaps(begin, end) || (it->addr >= begin && it->addr < end))
+                        it = available.erase(it);
+                    else
+                        ++it;
+                }
+
+                if(!store || !isTracked(store->varAddr) || !isComputation(statement->children[1]))
+                    continue;
+                Available entry{expressionKey(statement->children[1]), store->varAddr, Reads()};
+                collectReads(statement->children[1], entry.reads);
+                if(!entry.key.empty() && !entry.reads.all && !entry.reads.contains(entry.addr) &&
+                   !readsTarget(entry.reads))
+                    available.push_back(entry);
+            }
+        }
+
+        //! Move the value of temporaries read once to where they are read
+        void forwardTemporaries(Segment& segment) {
+            auto& statements = segment.statements;
+            for(size_t i = 0; i < statements.size(); ++i) {
+                Node* definition = *statements[i];
+                if(!definition)
+                    continue;
+                auto* store = dynamic_cast<StoreNode*>(definition->children[0]);
+                if(!store || store->varAddr < firstTemporary)
+                    continue;
+                const unsigned addr(store->varAddr);
+                Reads inputs;
+                collectReads(definition->children[1], inputs);
+                if(inputs.all || inputs.contains(addr))
+                    continue;
+                // an expression that might fail must keep its place relative to the other statements
+                const bool mustStayInPlace(mightFail(definition->children[1]));
+
+                // look for the only read of the temporary before it is written again
+                Node* use(nullptr);
+                bool inputsChanged(false);
+                bool useValid(true);
+                bool redefined(false);
+                for(size_t j = i + 1; j < statements.size() && useValid && !redefined; ++j) {
+                    Node* statement = *statements[j];
+                    if(!statement)
+                        continue;
+                    const int count(countLoads(statement, addr));
+                    if(count < 0 || count > 1 || (count == 1 && (use || inputsChanged)))
+                        useValid = false;
+                    else if(count == 0 && !use && mustStayInPlace)
+                        useValid = false;
+                    else if(count == 1)
+                        use = statement;
+
+                    auto* laterStore = dynamic_cast<StoreNode*>(statement->children[0]);
+                    auto* laterArrayWrite = dynamic_cast<ArrayWriteNode*>(statement->children[0]);
+                    if(laterStore) {
+                        redefined = laterStore->varAddr == addr;
+                        inputsChanged = inputsChanged || inputs.contains(laterStore->varAddr);
+                    } else {
+                        const unsigned begin(laterArrayWrite->arrayAddr);
+                        const unsigned end(begin + laterArrayWrite->arraySize);
+                        if(addr >= begin && addr < end)
+                            useValid = false;
+                        inputsChanged = inputsChanged || inputs.overlaps(begin, end);
+                    }
+                }
+                if(!use || !useValid || (!redefined && segment.end != SegmentEnd::END_OF_CODE))
+                    continue;
+
+                if(dump)
+                    *dump << definition->sourcePos.toWString() << L" temporary at " << addr
+                          << L" replaced by its value\n";
+                Node* value(definition->children[1]);
+                definition->children[1] = nullptr;
+                for(auto& child : use->children)
+                    if(replaceLoad(child, addr, value))
+                        break;
+                delete definition;
+                *statements[i] = nullptr;
+            }
+        }
+
+        //! Remove the assignments to variables that are written again or unused before being read
+        void eliminateDeadStores(Segment& segment) {
+            std::set<unsigned> dead;
+            if(segment.end == SegmentEnd::END_OF_CODE)
+                for(unsigned addr = firstTemporary; addr < variablesSize; ++addr)
+                    dead.insert(addr);
+
+            for(auto it = segment.statements.rbegin(); it != segment.statements.rend(); ++it) {
+                Node* statement = **it;
+                if(!statement)
+                    continue;
+
+                auto* store = dynamic_cast<StoreNode*>(statement->children[0]);
+                if(store && isTracked(store->varAddr)) {
+                    // the errors raised at run time, such as array accesses out of bounds, are kept
+                    if(dead.count(store->varAddr) && !mightFail(statement->children[1])) {
+                        if(dump)
+                            *dump << statement->sourcePos.toWString() << L" store to variable at "
+                                  << store->varAddr << L" removed because it is never read\n";
+                        delete statement;
+                        **it = nullptr;
+                        continue;
+                    }
+                    dead.insert(store->varAddr);
+                }
+
+                const Reads reads(statementReads(statement));
+                if(reads.all) {
+                    dead.clear();
+                    continue;
+                }
+                for(const auto& range : reads.ranges)
+                    dead.erase(dead.lower_bound(range.first), dead.lower_bound(range.second));
+            }
+        }
+
+        //! Replace multiplications, and divisions and modulos of non-negative values, by powers of two by
+        //! bitwise operations
+        void reduceStrength(Node* node) {
+            for(auto child : node->children)
+                if(child)
+                    reduceStrength(child);
+
+            auto* binary = dynamic_cast<BinaryArithmeticNode*>(node);
+            if(!binary)
+                return;
+            auto* immediateLeftChild = dynamic_cast<ImmediateNode*>(binary->children[0]);
+            auto* immediateRightChild = dynamic_cast<ImmediateNode*>(binary->children[1]);
+            if(binary->op == ASEBA_OP_MULT && !immediateRightChild && immediateLeftChild &&
+               isPOT(immediateLeftChild->value)) {
+                std::swap(binary->children[0], binary->children[1]);
+                std::swap(immediateLeftChild, immediateRightChild);
+            }
+            if(!immediateRightChild || !isPOT(immediateRightChild->value))
+                return;
+
+            // shifts round towards minus infinity while divisions round towards zero
+            if(binary->op == ASEBA_OP_MULT) {
+                binary->op = ASEBA_OP_SHIFT_LEFT;
+                immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
+                if(dump)
+                    *dump << binary->sourcePos.toWString() << L" multiplication transformed to left shift\n";
+            } else if(binary->op == ASEBA_OP_DIV && isNonNegative(binary->children[0])) {
+                binary->op = ASEBA_OP_SHIFT_RIGHT;
+                immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
+                if(dump)
+                    *dump << binary->sourcePos.toWString() << L" division transformed to right shift\n";
+            } else if(binary->op == ASEBA_OP_MOD && isNonNegative(binary->children[0])) {
+                binary->op = ASEBA_OP_BIT_AND;
+                immediateRightChild->value = immediateRightChild->value - 1;
+                if(dump)
+                    *dump << binary->sourcePos.toWString() << L" modulo transformed to binary and\n";
+            }
+        }
+
+        //! Remove the statements set to nullptr by the passes from their blocks
+        void removeDeleted(Node* node) {
+            if(dynamic_cast<BlockNode*>(node)) {
+                auto& children = node->children;
+                children.erase(std::remove(children.begin(), children.end(), nullptr), children.end());
+            }
+            for(auto child : node->children)
+                if(child)
+                    removeDeleted(child);
+        }
+
+        const unsigned firstUserVariable;
+        const unsigned firstTemporary;
+        const unsigned variablesSize;
+        std::wostream* dump;
+        std::vector<Segment> segments;
+    };
+}  // namespace
+
+//! Optimize the values flowing through assignments between statements of the optimized tree
+//! \param program the optimized tree
+//! \param firstUserVariable address of the first variable of the program, variables before are the target's
+//! \param firstTemporary address of the first temporary variable
+//! \param variablesSize size of the variables memory of the target
+//! \param dump stream to send dump messages to
+void optimizeDataflow(Node* program, unsigned firstUserVariable, unsigned firstTemporary, unsigned variablesSize,
+                      std::wostream* dump) {
+    DataflowOptimizer(firstUserVariable, firstTemporary, variablesSize, dump).run(program);
+}
+
+/*@}*/
+
+}  // namespace Aseba
@@ -182,12 +182,123 @@ static bool matchNameInMemoryVector(const Node* root, std::wstring name) {
     return false;
 }
 
+/*
+ * helper function to know if 'node' is a constant vector with the same value for all its
+ * elements, such as the ones of "v++", and to get this value
+ */
+static bool isUniformConstant(const Node* node, int& value) {
+    auto* immediate = dynamic_cast<const ImmediateNode*>(node);
+    if(immediate) {
+        value = immediate->value;
+        return true;
+    }
+
+    if(!dynamic_cast<const TupleVectorNode*>(node) || node->children.empty())
+        return false;
+    for(const auto child : node->children) {
+        int childValue;
+        if(!isUniformConstant(child, childValue) || (child != node->children[0] && childValue != value))
+            return false;
+        value = childValue;
+    }
+    return true;
+}
+
+/*
+ * helper function to know if the vectorial expression 'node' can be computed element by element
+ * in a loop, i.e. if it only combines arithmetics on vectors of 'size' elements at static
+ * addresses and uniform constant vectors. The assigned vector, 'name' at 'addr', may appear at
+ * the same address, as each element is then read before being written.
+ */
+static bool isLoopable(const Node* node, unsigned size, const std::wstring& name, unsigned addr) {
+    auto* memoryVector = dynamic_cast<const MemoryVectorNode*>(node);
+    if(memoryVector) {
+        if(!memoryVector->isAddressStatic() || memoryVector->getVectorSize() != size)
+            return false;
+        return memoryVector->arrayName != name || memoryVector->getVectorAddr() == addr;
+    }
+
+    auto* tupleVector = dynamic_cast<const TupleVectorNode*>(node);
+    if(tupleVector) {
+        if(tupleVector->children.size() == 1)
+            return isLoopable(tupleVector->children[0], size, name, addr);
+        int value;
+        return tupleVector->getVectorSize() == size && isUniformConstant(tupleVector, value);
+    }
+
+    if(!dynamic_cast<const BinaryArithmeticNode*>(node) && !dynamic_cast<const UnaryArithmeticNode*>(node))
+        return false;
+    for(const auto child : node->children)
+        if(!isLoopable(child, size, name, addr))
+            return false;
+    return true;
+}
+
+/*
+ * helper function to build the scalar expression computing the element of the loopable
+ * expression 'node' at the index stored in 'counterAddr'
+ */
+static Node* loopElement(const Node* node, unsigned counterAddr) {
+    auto* memoryVector = dynamic_cast<const MemoryVectorNode*>(node);
+    if(memoryVector) {
+        std::unique_ptr<Node> array(new ArrayReadNode(node->sourcePos, memoryVector->getVectorAddr(),
+                                                      memoryVector->getVectorSize(), memoryVector->arrayName));
+        array->children.push_back(new LoadNode(node->sourcePos, counterAddr));
+        return array.release();
+    }
+
+    auto* tupleVector = dynamic_cast<const TupleVectorNode*>(node);
+    if(tupleVector) {
+        if(tupleVector->children.size() == 1)
+            return loopElement(tupleVector->children[0], counterAddr);
+        int value = 0;
+        isUniformConstant(tupleVector, value);
+        return new ImmediateNode(node->sourcePos, value);
+    }
+
+    std::unique_ptr<Node> element(node->shallowCopy());
+    element->children.clear();
+    for(const auto child : node->children)
+        element->children.push_back(loopElement(child, counterAddr));
+    return element.release();
+}
+
+/*
+ * helper function to know if the assignment of 'rightVector' to 'leftVector' can be compiled to a
+ * loop instead of one assignment per element
+ */
+static bool isLoopableAssignment(const MemoryVectorNode* leftVector, const Node* rightVector) {
+    return leftVector->getVectorSize() >= 2 && leftVector->isAddressStatic() &&
+           isLoopable(rightVector, leftVector->getVectorSize(), leftVector->arrayName, leftVector->getVectorAddr());
+}
+
+//! Return whether the vectorial tree 'node' has assignments that can be compiled to loops
+bool hasLoopableAssignments(const Node* node) {
+    if(dynamic_cast<const AssignmentNode*>(node)) {
+        auto* leftVector = dynamic_cast<const MemoryVectorNode*>(node->children[0]);
+        return leftVector && isLoopableAssignment(leftVector, node->children[1]);
+    }
+    for(const auto child : node->children)
+        if(hasLoopableAssignments(child))
+            return true;
+    return false;
+}
+
 //! This is the root node, take in charge the tree creation / deletion
 Node* ProgramNode::expandVectorialNodes(std::wostream* dump, Compiler* compiler, unsigned int index) {
-    Node* newMe = Node::expandVectorialNodes(dump, compiler, index);
+    std::unique_ptr<Node> newMe(this->shallowCopy());
+    newMe->children.clear();
+
+    // as when parsing, temporary variables only live within a statement, so that the code of an
+    // event or a subroutine does not depend on the rest of the program
+    for(auto& child : this->children) {
+        if(compiler)
+            compiler->freeTemporaryMemory();
+        newMe->children.push_back(child->expandVectorialNodes(dump, compiler, index));
+    }
 
     delete this;  // delete the whole (obsolete) vectorial tree
-    return newMe;
+    return newMe.release();
 }
 
 //! Generic implementation for non-vectorial nodes
@@ -216,6 +327,42 @@ Node* AssignmentNode::expandVectorialNodes(std::wostream* dump, Compiler* compil
     // right vector can be anything
     Node* rightVector = children[1];
 
+    // large vectors computed element by element are assigned in a loop
+    const unsigned size = leftVector->getVectorSize();
+    if(compiler && compiler->vectorLoops != Compiler::VectorLoops::NEVER &&
+       isLoopableAssignment(leftVector, rightVector) && compiler->isNextVectorLoop()) {
+        // counter = 0
+        // while counter < size do
+        //     left[counter] = right[counter]
+        //     counter = counter + 1
+        // end
+        const unsigned counterAddr = compiler->allocateTemporaryMemory(sourcePos, 1);
+        std::unique_ptr<BlockNode> block(new BlockNode(sourcePos));
+        block->children.push_back(
+            new AssignmentNode(sourcePos, new StoreNode(sourcePos, counterAddr), new ImmediateNode(sourcePos, 0)));
+
+        std::unique_ptr<WhileNode> loop(new WhileNode(sourcePos));
+        loop->children.push_back(new BinaryArithmeticNode(sourcePos, ASEBA_OP_SMALLER_THAN,
+                                                          new LoadNode(sourcePos, counterAddr),
+                                                          new ImmediateNode(sourcePos, int(size))));
+        loop->children.push_back(new BlockNode(sourcePos));
+
+        std::unique_ptr<Node> array(
+            new ArrayWriteNode(sourcePos, leftVector->getVectorAddr(), size, leftVector->arrayName));
+        array->children.push_back(new LoadNode(sourcePos, counterAddr));
+        loop->children[1]->children.push_back(
+            new AssignmentNode(sourcePos, array.release(), loopElement(rightVector, counterAddr)));
+        loop->children[1]->children.push_back(new AssignmentNode(
+            sourcePos, new StoreNode(sourcePos, counterAddr),
+            new BinaryArithmeticNode(sourcePos, ASEBA_OP_ADD, new LoadNode(sourcePos, counterAddr),
+                                     new ImmediateNode(sourcePos, 1))));
+        block->children.push_back(loop.release());
+
+        if(dump)
+            *dump << sourcePos.toWString() << L" assignment of " << size << L" elements compiled to a loop\n";
+        return block.release();
+    }
+
     // check if the left vector appears somewhere on the right side
     if(matchNameInMemoryVector(rightVector, leftVector->arrayName) && leftVector->getVectorSize() > 1) {
         // in such case, there is a risk of involuntary overwriting the content
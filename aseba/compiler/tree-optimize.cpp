@@ -18,7 +18,6 @@
 */
 
 #include "tree.h"
-#include "power-of-two.h"
 #include "common/utils/FormatableString.h"
 #include "common/utils/utils.h"
 #include <cassert>
@@ -343,21 +342,6 @@ Node* BinaryArithmeticNode::optimize(std::wostream* dump) {
         }
     }
 
-    // POT mult/div to shift conversion
-    if(immediateRightChild && isPOT(immediateRightChild->value)) {
-        if(op == ASEBA_OP_MULT) {
-            op = ASEBA_OP_SHIFT_LEFT;
-            immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
-            if(dump)
-                *dump << sourcePos.toWString() << L" multiplication transformed to left shift\n";
-        } else if(op == ASEBA_OP_DIV) {
-            op = ASEBA_OP_SHIFT_RIGHT;
-            immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
-            if(dump)
-                *dump << sourcePos.toWString() << L" division transformed to right shift\n";
-        }
-    }
-
     // detect static division by zero
     if(op == ASEBA_OP_DIV && immediateRightChild && immediateRightChild->value == 0) {
         throw TranslatableError(sourcePos, ERROR_DIVISION_BY_ZERO);
@@ -62,6 +62,10 @@ public:
     Node& operator=(Node&& rhs) = delete;
     //! Destructor, delete all children
     virtual ~Node();
+    //! Allocate a node in the arena of the current compilation, or on the heap if there is none
+    static void* operator new(size_t size);
+    //! Free a node allocated on the heap; nodes in an arena are freed with it
+    static void operator delete(void* p);
     //! Return a shallow copy of the object (children point to the same objects)
     virtual Node* shallowCopy() const = 0;
     //! Return a deep copy of the object (children are also copied)
@@ -99,7 +103,7 @@ public:
     virtual unsigned getVectorSize() const;
 
     //! Vector for children of a node
-    using NodesVector = std::vector<Node*>;
+    using NodesVector = std::vector<Node*, ArenaAllocator<Node*>>;
     NodesVector children;  //!< children of this node
     SourcePos sourcePos;   //!< position is source
 };
@@ -769,6 +773,13 @@ struct UnaryArithmeticAssignmentNode : AbstractTreeNode {
     }
 };
 
+//! Return whether assignments of the vectorial tree can be compiled to loops, see tree-expand.cpp
+bool hasLoopableAssignments(const Node* node);
+
+//! Optimize the values flowing between the assignments of the optimized tree, see tree-dataflow.cpp
+void optimizeDataflow(Node* program, unsigned firstUserVariable, unsigned firstTemporary, unsigned variablesSize,
+                      std::wostream* dump);
+
 /*@}*/
 
 }  // namespace Aseba
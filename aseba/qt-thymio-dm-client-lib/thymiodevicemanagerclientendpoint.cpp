@@ -371,22 +371,24 @@ auto ThymioDeviceManagerClientEndpoint::unlock(const ThymioNode& node) -> Reques
 }
 
 auto ThymioDeviceManagerClientEndpoint::send_code(const ThymioNode& node, const QByteArray& code,
-                                                  fb::ProgrammingLanguage language, fb::CompilationOptions opts)
-    -> CompilationRequest {
+                                                  fb::ProgrammingLanguage language, fb::CompilationOptions opts,
+                                                  fb::VectorLoops vector_loops) -> CompilationRequest {
 
     CompilationRequest r = prepare_request<CompilationRequest>();
     flatbuffers::FlatBufferBuilder builder;
     auto uuidOffset = serialize_uuid(builder, node.uuid());
     auto codedOffset = builder.CreateString(code.data(), code.size());
-    write(wrap_fb(builder, fb::CreateCompileAndLoadCodeOnVM(builder, r.id(), uuidOffset, language, codedOffset, opts)));
+    write(wrap_fb(builder, fb::CreateCompileAndLoadCodeOnVM(builder, r.id(), uuidOffset, language, codedOffset, opts,
+                                                            vector_loops)));
     return r;
 }
 
-Request ThymioDeviceManagerClientEndpoint::set_watch_flags(const ThymioNode& node, int flags) {
+Request ThymioDeviceManagerClientEndpoint::set_watch_flags(const ThymioNode& node, int flags,
+                                                           unsigned variables_update_period) {
     Request r = prepare_request<Request>();
     flatbuffers::FlatBufferBuilder builder;
     auto uuidOffset = serialize_uuid(builder, node.uuid());
-    write(wrap_fb(builder, fb::CreateWatchNode(builder, r.id(), uuidOffset, flags)));
+    write(wrap_fb(builder, fb::CreateWatchNode(builder, r.id(), uuidOffset, flags, variables_update_period)));
     return r;
 }
 
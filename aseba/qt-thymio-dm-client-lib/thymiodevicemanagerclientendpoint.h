@@ -28,8 +28,9 @@ public:
     Request lock(const ThymioNode& node);
     Request unlock(const ThymioNode& node);
     CompilationRequest send_code(const ThymioNode& node, const QByteArray& code, fb::ProgrammingLanguage language,
-                                 fb::CompilationOptions opts);
-    Request set_watch_flags(const ThymioNode& node, int flags);
+                                 fb::CompilationOptions opts,
+                                 fb::VectorLoops vector_loops = fb::VectorLoops::WhenSmaller);
+    Request set_watch_flags(const ThymioNode& node, int flags, unsigned variables_update_period = 0);
     AsebaVMDescriptionRequest fetchAsebaVMDescription(const ThymioNode& node);
     Request setNodeVariabes(const ThymioNode& node, const ThymioNode::VariableMap& vars);
     Request setNodeEventsTable(const ThymioNode& node, const QVector<EventDescription>& events);
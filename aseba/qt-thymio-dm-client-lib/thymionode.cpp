@@ -112,12 +112,16 @@ BreakpointsRequest ThymioNode::setBreakPoints(const QVector<unsigned>& breakpoin
     return m_endpoint->setNodeBreakPoints(*this, breakpoints);
 }
 
-CompilationRequest ThymioNode::compile_aseba_code(const QByteArray& code) {
-    return m_endpoint->send_code(*this, code, fb::ProgrammingLanguage::Aseba, fb::CompilationOptions(0));
+// with vectorLoops, the device manager compiles assignments between vectors to loops where this makes
+// the bytecode smaller
+CompilationRequest ThymioNode::compile_aseba_code(const QByteArray& code, bool vectorLoops) {
+    return m_endpoint->send_code(*this, code, fb::ProgrammingLanguage::Aseba, fb::CompilationOptions(0),
+                                 vectorLoops ? fb::VectorLoops::WhenSmaller : fb::VectorLoops::Never);
 }
 
-CompilationRequest ThymioNode::load_aseba_code(const QByteArray& code) {
-    return m_endpoint->send_code(*this, code, fb::ProgrammingLanguage::Aseba, fb::CompilationOptions::LoadOnTarget);
+CompilationRequest ThymioNode::load_aseba_code(const QByteArray& code, bool vectorLoops) {
+    return m_endpoint->send_code(*this, code, fb::ProgrammingLanguage::Aseba, fb::CompilationOptions::LoadOnTarget,
+                                 vectorLoops ? fb::VectorLoops::WhenSmaller : fb::VectorLoops::Never);
 }
 
 Request ThymioNode::setWatchVariablesEnabled(bool enabled) {
@@ -135,8 +139,13 @@ Request ThymioNode::setWatchVMExecutionStateEnabled(bool enabled) {
     return updateWatchedInfos();
 }
 
+Request ThymioNode::setVariablesUpdatePeriod(unsigned period) {
+    m_variables_update_period = period;
+    return updateWatchedInfos();
+}
+
 Request ThymioNode::updateWatchedInfos() {
-    return m_endpoint->set_watch_flags(*this, int(m_watched_infos));
+    return m_endpoint->set_watch_flags(*this, int(m_watched_infos), m_variables_update_period);
 }
 
 AsebaVMDescriptionRequest ThymioNode::fetchAsebaVMDescription() {
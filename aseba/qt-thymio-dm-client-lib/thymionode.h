@@ -120,8 +120,8 @@ public:
     Q_INVOKABLE Request lock();
     Q_INVOKABLE Request unlock();
 
-    Q_INVOKABLE CompilationRequest compile_aseba_code(const QByteArray& code);
-    Q_INVOKABLE CompilationRequest load_aseba_code(const QByteArray& code);
+    Q_INVOKABLE CompilationRequest compile_aseba_code(const QByteArray& code, bool vectorLoops = true);
+    Q_INVOKABLE CompilationRequest load_aseba_code(const QByteArray& code, bool vectorLoops = true);
 
     Q_INVOKABLE Request stop();
     Q_INVOKABLE Request run();
@@ -135,6 +135,8 @@ public:
     Q_INVOKABLE Request setWatchVariablesEnabled(bool enabled);
     Q_INVOKABLE Request setWatchEventsEnabled(bool enabled);
     Q_INVOKABLE Request setWatchVMExecutionStateEnabled(bool enabled);
+    //! Set the period in milliseconds at which watched variables are refreshed, 0 to use the default one
+    Q_INVOKABLE Request setVariablesUpdatePeriod(unsigned period);
 
     Q_INVOKABLE AsebaVMDescriptionRequest fetchAsebaVMDescription();
 
@@ -160,6 +162,7 @@ private:
     NodeCapabilities m_capabilities;
     NodeType m_type;
     WatchFlags m_watched_infos;
+    unsigned m_variables_update_period = 0;
     QVector<EventDescription> m_events_table;
 
     friend ThymioDeviceManagerClientEndpoint;
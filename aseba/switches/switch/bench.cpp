@@ -0,0 +1,183 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measure the number of messages per second a running switch forwards,
+// depending on the number of peers receiving them, optionally with a peer
+// that never reads what the switch sends to it.
+
+#include <dashel/dashel.h>
+#include "common/consts.h"
+#include "common/msg/MessageView.h"
+#include "transport/dashel_plugins/dashel-plugins.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace Aseba {
+using namespace Dashel;
+using namespace std;
+
+//! One sender floods user messages through the switch to receivers, which count them
+class SwitchBench : public Hub {
+public:
+    SwitchBench(const string& target, unsigned receiversCount) {
+        sender = connect(target);
+        for(unsigned i = 0; i < receiversCount; ++i)
+            received[connect(target)] = 0;
+    }
+
+    //! Send messagesCount messages of words words, return the number of messages forwarded per second
+    double run(unsigned messagesCount, unsigned words) {
+        // let the switch accept all connections
+        const auto settle(chrono::steady_clock::now() + chrono::milliseconds(200));
+        while(chrono::steady_clock::now() < settle)
+            step(10);
+
+        const uint16_t len(uint16_t(words * 2));
+        vector<uint8_t> frame{uint8_t(len), uint8_t(len >> 8), 0, 0, uint8_t(benchEvent), uint8_t(benchEvent >> 8)};
+        frame.resize(frame.size() + len);
+
+        // only a window of messages is in flight, so that the sender never blocks on a full switch
+        const unsigned window(256);
+        unsigned sent(0);
+        const auto start(chrono::steady_clock::now());
+        auto lastProgress(start);
+        unsigned lastReceived(0);
+        while(minReceived() < messagesCount) {
+            while(sent < messagesCount && sent - minReceived() < window) {
+                sender->write(frame.data(), frame.size());
+                ++sent;
+            }
+            sender->flush();
+            step(1);
+
+            const auto now(chrono::steady_clock::now());
+            if(minReceived() != lastReceived) {
+                lastReceived = minReceived();
+                lastProgress = now;
+            } else if(now - lastProgress > chrono::seconds(5)) {
+                cerr << "no progress for 5 s, " << messagesCount - lastReceived << " messages lost" << endl;
+                break;
+            }
+        }
+        const double elapsed(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        return double(minReceived()) * received.size() / elapsed;
+    }
+
+protected:
+    void incomingData(Stream* stream) override {
+        const MessageView message(MessageView::receive(stream, readBuffer));
+        auto it(received.find(stream));
+        if(it != received.end() && message.type() == benchEvent)
+            ++it->second;
+    }
+
+private:
+    unsigned minReceived() const {
+        unsigned count(~0u);
+        for(const auto& r : received)
+            count = min(count, r.second);
+        return received.empty() ? 0 : count;
+    }
+
+    static const uint16_t benchEvent = 0x1234;
+    Stream* sender;
+    unordered_map<Stream*, unsigned> received;
+    vector<uint8_t> readBuffer;
+};
+
+}  // namespace Aseba
+
+//! Show usage
+void dumpHelp(std::ostream& stream, const char* programName) {
+    stream << "Aseba switch bench, measure the throughput of a running switch, usage:\n";
+    stream << programName << " [options] [target]\n";
+    stream << "Options:\n";
+    stream << "--peers LIST    : comma-separated numbers of receiving peers to measure (default: 1,2,4,8,16)\n";
+    stream << "--messages N    : number of messages sent for each measure (default: 20000)\n";
+    stream << "--words N       : number of payload words of each message (default: 8)\n";
+    stream << "--slow          : also connect a peer that never reads from the switch\n";
+    stream << "-h, --help      : shows this help\n";
+    stream << "The target is the switch, " << ASEBA_DEFAULT_TARGET << " by default." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    Dashel::initPlugins();
+    std::vector<unsigned> peers{1, 2, 4, 8, 16};
+    unsigned messages = 20000;
+    unsigned words = 8;
+    bool slow = false;
+    std::string target = ASEBA_DEFAULT_TARGET;
+
+    int argCounter = 1;
+
+    while(argCounter < argc) {
+        const char* arg = argv[argCounter];
+
+        if((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0)) {
+            dumpHelp(std::cout, argv[0]);
+            return 0;
+        } else if(strcmp(arg, "--slow") == 0) {
+            slow = true;
+        } else if((strcmp(arg, "--peers") == 0) || (strcmp(arg, "--messages") == 0) ||
+                  (strcmp(arg, "--words") == 0)) {
+            if(argCounter + 1 >= argc) {
+                dumpHelp(std::cout, argv[0]);
+                return 1;
+            }
+            const char* value = argv[++argCounter];
+            if(strcmp(arg, "--peers") == 0) {
+                peers.clear();
+                std::istringstream list(value);
+                std::string count;
+                while(std::getline(list, count, ','))
+                    peers.push_back(unsigned(atoi(count.c_str())));
+            } else if(strcmp(arg, "--messages") == 0)
+                messages = unsigned(atoi(value));
+            else
+                words = std::min(unsigned(atoi(value)), unsigned(ASEBA_MAX_EVENT_ARG_COUNT));
+        } else {
+            target = arg;
+        }
+        argCounter++;
+    }
+
+    try {
+        // a hub which is never stepped, so that its stream is never read
+        Dashel::Hub slowHub;
+        if(slow)
+            slowHub.connect(target);
+
+        std::cout << "peers\tmessages/s forwarded" << std::endl;
+        for(const auto count : peers) {
+            Aseba::SwitchBench bench(target, count);
+            std::cout << count << "\t" << unsigned(bench.run(messages, words)) << std::endl;
+        }
+    } catch(const Dashel::DashelException& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
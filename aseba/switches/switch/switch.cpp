@@ -31,6 +31,7 @@
 #include "common/utils/utils.h"
 #include "common/utils/FormatableString.h"
 #include "common/msg/msg.h"
+#include "common/msg/MessageView.h"
 #include "common/msg/endian.h"
 #ifdef ZEROCONF_SUPPORT
 #    include "common/zeroconf/zeroconf-dashelhub.h"
@@ -53,8 +54,78 @@ using namespace Dashel;
 /** \addtogroup switch */
 /*@{*/
 
+StreamWriter::StreamWriter(Stream* stream, size_t maxQueued)
+    : stream(stream), maxQueued(maxQueued), thread(&StreamWriter::run, this) {}
+
+StreamWriter::~StreamWriter() {
+    {
+        // the stream is closing, possibly because its peer stopped reading, so what is queued is
+        // dropped rather than written
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        dropped += queued.size();
+        queued.clear();
+    }
+    condition.notify_one();
+    thread.join();
+}
+
+bool StreamWriter::push(const std::vector<uint8_t>& data) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(failed || (!queued.empty() && queued.size() + data.size() > maxQueued)) {
+            dropped += data.size();
+            return false;
+        }
+        queued.insert(queued.end(), data.begin(), data.end());
+    }
+    condition.notify_one();
+    return true;
+}
+
+size_t StreamWriter::droppedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+//! Write the queued data to the stream until stopped.
+//! The hub thread keeps polling and reading the stream meanwhile, without Hub::lock(), which would
+//! block the hub during slow writes again. This is safe with Dashel 1.3: its socket and serial
+//! streams write through their send buffer and descriptor, which reading does not touch; the hub
+//! thread never writes to a stream having a writer; and the hub only deletes a stream after
+//! connectionClosed(), which destroys its writer first.
+void StreamWriter::run() {
+    std::vector<uint8_t> writing;
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        condition.wait(lock, [this] { return stopping || !queued.empty(); });
+        if(stopping)
+            return;
+
+        // write everything queued at once, while new data is queued in the other buffer
+        writing.clear();
+        writing.swap(queued);
+        lock.unlock();
+        bool ok(true);
+        try {
+            stream->write(writing.data(), writing.size());
+            stream->flush();
+        } catch(const DashelException&) {
+            // the hub will call connectionClosed later
+            ok = false;
+        }
+        lock.lock();
+        if(!ok) {
+            failed = true;
+            dropped += queued.size();
+            queued.clear();
+        }
+    }
+}
+
 //! Broadcast messages form any data stream to all others data streams including itself.
-Switch::Switch(unsigned port, std::string name, bool verbose, bool dump, bool forward, bool rawTime)
+Switch::Switch(unsigned port, std::string name, bool verbose, bool dump, bool forward, bool rawTime,
+               size_t writeQueueSize)
     :
 #ifdef DASHEL_VERSION_INT
     Dashel::Hub(verbose || dump)
@@ -68,7 +139,8 @@ Switch::Switch(unsigned port, std::string name, bool verbose, bool dump, bool fo
     verbose(verbose)
     , dump(dump)
     , forward(forward)
-    , rawTime(rawTime) {
+    , rawTime(rawTime)
+    , writeQueueSize(writeQueueSize) {
     ostringstream oss;
     oss << "tcpin:port=" << port;
     auto tcpin = connect(oss.str());
@@ -101,52 +173,75 @@ void Switch::incomingData(Stream* stream) {
     }
 #endif  // ZEROCONF_SUPPORT
 
-    Message* message(Message::receive(stream));
+    // messages are routed from their frame, without deserializing them
+    const MessageView message(MessageView::receive(stream, readBuffer));
 
     // remap source
+    uint16_t source(message.source());
     {
         const IdRemapTable::const_iterator remapIt(idRemapTable.find(stream));
-        if(remapIt != idRemapTable.end() && (message->source == remapIt->second.second))
-            message->source = remapIt->second.first;
+        if(remapIt != idRemapTable.end() && (source == remapIt->second.second))
+            source = remapIt->second.first;
     }
 
     // if requested, dump
     if(dump) {
         dumpTime(cout, rawTime);
         std::cout << "  ";
-        message->dump(std::wcout);
+        std::unique_ptr<Message> fullMessage(message.toMessage());
+        fullMessage->source = source;
+        fullMessage->dump(std::wcout);
         std::wcout << std::endl;
     }
 
-    // write on all connected streams
-    auto* cmdMessage(dynamic_cast<CmdMessage*>(message));
+    // learn through which stream nodes are reachable
+    if(message.isFromNode())
+        nodeRoutingTable[source] = stream;
+
+    // commands to a known node are only written to its stream, other messages on all connected streams
+    const NodeRoutingTable::const_iterator routeIt(message.isCommand() ? nodeRoutingTable.find(message.destination())
+                                                                      : nodeRoutingTable.end());
+    if(routeIt != nodeRoutingTable.end()) {
+        if(!(forward && routeIt->second == stream))
+            sendTo(routeIt->second, message, source);
+        return;
+    }
     for(auto it = dataStreams.begin(); it != dataStreams.end(); ++it) {
         Stream* destStream = *it;
 
         if((forward) && (destStream == stream))
             continue;
 
-        try {
-            const IdRemapTable::const_iterator remapIt(idRemapTable.find(destStream));
-            if(cmdMessage && remapIt != idRemapTable.end()) {
-                if(cmdMessage->dest == remapIt->second.first) {
-                    const uint16_t oldDest(cmdMessage->dest);
-                    cmdMessage->dest = remapIt->second.second;
-                    message->serialize(destStream);
-                    cmdMessage->dest = oldDest;
-                }
-            } else {
-                message->serialize(destStream);
-            }
-            destStream->flush();
-        } catch(DashelException e) {
-            // if this stream has a problem, ignore it for now, and let Hub call connectionClosed
-            // later.
-            std::cerr << "error while writing" << std::endl;
-        }
+        sendTo(destStream, message, source);
     }
+}
 
-    delete message;
+void Switch::sendTo(Stream* destStream, const MessageView& message, uint16_t source) {
+    try {
+        const IdRemapTable::const_iterator remapIt(idRemapTable.find(destStream));
+        writeBuffer.clear();
+        if(message.isCommand() && remapIt != idRemapTable.end()) {
+            if(message.destination() == remapIt->second.first)
+                message.appendTo(writeBuffer, source, remapIt->second.second);
+        } else {
+            message.appendTo(writeBuffer, source, message.destination());
+        }
+        if(writeBuffer.empty())
+            return;
+        if(writeQueueSize) {
+            auto& writer(writers[destStream]);
+            if(!writer)
+                writer.reset(new StreamWriter(destStream, writeQueueSize));
+            writer->push(writeBuffer);
+            return;
+        }
+        destStream->write(writeBuffer.data(), writeBuffer.size());
+        destStream->flush();
+    } catch(DashelException e) {
+        // if this stream has a problem, ignore it for now, and let Hub call connectionClosed
+        // later.
+        std::cerr << "error while writing" << std::endl;
+    }
 }
 
 void Switch::connectionClosed(Stream* stream, bool abnormal) {
@@ -157,6 +252,23 @@ void Switch::connectionClosed(Stream* stream, bool abnormal) {
     }
 #endif  // ZEROCONF_SUPPORT
 
+    // nodes behind this stream are unknown again, commands to them will be broadcast
+    for(auto it = nodeRoutingTable.begin(); it != nodeRoutingTable.end();) {
+        if(it->second == stream)
+            it = nodeRoutingTable.erase(it);
+        else
+            ++it;
+    }
+    idRemapTable.erase(stream);
+
+    // stop writing to this stream before the hub deletes it
+    size_t droppedBytes(0);
+    const auto writerIt(writers.find(stream));
+    if(writerIt != writers.end()) {
+        droppedBytes = writerIt->second->droppedBytes();
+        writers.erase(writerIt);
+    }
+
     if(verbose) {
         dumpTime(cout, rawTime);
         if(abnormal)
@@ -164,6 +276,8 @@ void Switch::connectionClosed(Stream* stream, bool abnormal) {
                  << endl;
         else
             cout << "* Normal connection closed to " << stream->getTargetName() << endl;
+        if(droppedBytes)
+            cout << "* " << droppedBytes << " bytes were dropped as this connection was too slow" << endl;
     }
 }
 
@@ -196,6 +310,8 @@ void dumpHelp(std::ostream& stream, const char* programName) {
     stream << "-p port         : listens to incoming connection on this port\n";
     stream << "-n, --name name : use this name if advertising\n";
     stream << "--rawtime       : shows time in the form of sec:usec since 1970\n";
+    stream << "--write-queue KB: writes to each connection from its own thread, dropping messages\n";
+    stream << "                  when more than KB kilobytes are waiting to be sent to it\n";
     stream << "-h, --help      : shows this help\n";
     stream << "-V, --version   : shows the version number\n";
     stream << "Additional targets are any valid Dashel targets." << std::endl;
@@ -217,6 +333,7 @@ int main(int argc, char* argv[]) {
     bool dump = false;
     bool forward = true;
     bool rawTime = false;
+    size_t writeQueueSize = 0;
     std::vector<std::string> additionalTargets;
 
     int argCounter = 1;
@@ -247,6 +364,13 @@ int main(int argc, char* argv[]) {
             name = arg;
         } else if(strcmp(arg, "--rawtime") == 0) {
             rawTime = true;
+        } else if(strcmp(arg, "--write-queue") == 0) {
+            if(argCounter + 1 >= argc) {
+                std::cerr << "queue size needed" << std::endl;
+                return 1;
+            }
+            arg = argv[++argCounter];
+            writeQueueSize = size_t(atoi(arg)) * 1024;
         } else if((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0)) {
             dumpHelp(std::cout, argv[0]);
             return 0;
@@ -260,7 +384,7 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        Aseba::Switch aswitch(port, name, verbose, dump, forward, rawTime);
+        Aseba::Switch aswitch(port, name, verbose, dump, forward, rawTime, writeQueueSize);
         for(size_t i = 0; i < additionalTargets.size(); i++) {
             const std::string& target(additionalTargets[i]);
             Dashel::Stream* stream = aswitch.connect(target);
@@ -21,8 +21,15 @@
 #define ASEBA_SWITCH
 
 #include <dashel/dashel.h>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "common/types.h"
+#include "common/msg/MessageView.h"
 #ifdef ZEROCONF_SUPPORT
 #    include "common/zeroconf/zeroconf-dashelhub.h"
 #endif  // ZEROCONF_SUPPORT
@@ -33,6 +40,35 @@ namespace Aseba {
 */
 /*@{*/
 
+/*!
+    Write to a stream from a dedicated thread, so that a slow peer only delays itself.
+    Data pushed while more than maxQueued bytes are waiting to be written is dropped.
+*/
+class StreamWriter {
+public:
+    StreamWriter(Dashel::Stream* stream, size_t maxQueued);
+    //! Drop what is still queued and stop the thread, once the write in progress, if any, is done
+    ~StreamWriter();
+
+    //! Queue data to be written, return false if it was dropped
+    bool push(const std::vector<uint8_t>& data);
+    //! Return the number of bytes dropped so far
+    size_t droppedBytes() const;
+
+private:
+    void run();
+
+    Dashel::Stream* stream;
+    const size_t maxQueued;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<uint8_t> queued;  //!< data waiting to be written
+    bool stopping = false;
+    bool failed = false;  //!< the stream could not be written to, data is dropped until it is closed
+    size_t dropped = 0;
+    std::thread thread;
+};
+
 /*!
     Route Aseba messages on the TCP part of the network.
 */
@@ -42,8 +78,10 @@ public:
         @param verbose should we print a notification on each message
         @param dump should we dump content of each message
         @param forward should we only forward messages instead of transmit them back to the sender
+        @param writeQueueSize if not zero, write to each stream from its own thread, queuing at most this number of bytes
     */
-    Switch(unsigned port, std::string name, bool verbose, bool dump, bool forward, bool rawTime);
+    Switch(unsigned port, std::string name, bool verbose, bool dump, bool forward, bool rawTime,
+           size_t writeQueueSize = 0);
 
     /*! Forwards the data received for a connections to the other ones.
         If forward is false, transmit it back to the sender too.
@@ -73,6 +111,9 @@ private:
     void incomingData(Dashel::Stream* stream) override;
     void connectionClosed(Dashel::Stream* stream, bool abnormal) override;
 
+    //! Write message to destStream with the given source, remapping its destination for destStream
+    void sendTo(Dashel::Stream* destStream, const MessageView& message, uint16_t source);
+
 private:
 #ifdef ZEROCONF_SUPPORT
     std::string zeroconfName;  //!< name of this switch, if we want to advertise it
@@ -81,12 +122,23 @@ private:
     bool dump;                 //!< should we dump content of CAN messages
     bool forward;              //!< should we only forward messages instead of transmit them back to the sender
     bool rawTime;              //!< should displayed timestamps be of the form sec:usec since 1970
+    size_t writeQueueSize;     //!< maximum number of bytes queued per stream, 0 to write from the main thread
 
     //! A pair of id: local, target
     typedef std::pair<uint16_t, uint16_t> IdPair;
     //! A table allowing to remap the aseba node id of streams
-    typedef std::map<Dashel::Stream*, IdPair> IdRemapTable;
+    typedef std::unordered_map<Dashel::Stream*, IdPair> IdRemapTable;
     IdRemapTable idRemapTable;  //!< table for remapping id
+
+    //! A table of the stream through which each node was last seen
+    typedef std::unordered_map<uint16_t, Dashel::Stream*> NodeRoutingTable;
+    NodeRoutingTable nodeRoutingTable;  //!< table learned from the messages sent by nodes
+
+    std::vector<uint8_t> readBuffer;   //!< frame of the message being routed, reused across messages
+    std::vector<uint8_t> writeBuffer;  //!< remapped frame being written, reused across streams
+
+    //! Threads writing to streams, when writeQueueSize is not zero
+    std::unordered_map<Dashel::Stream*, std::unique_ptr<StreamWriter>> writers;
 };
 
 /*@}*/
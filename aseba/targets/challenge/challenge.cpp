@@ -148,6 +148,9 @@ public:
     AsebaVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    std::valarray<AsebaVMThreadedInstruction> threadedCode;
+#endif
     struct Variables {
         int16_t productId;  // product id
         int16_t speedL;     // left motor speed
@@ -190,6 +193,10 @@ public:
         bytecode.resize(512);
         vm.bytecode = &bytecode[0];
         vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED_DISPATCH
+        threadedCode.resize(bytecode.size());
+        vm.threadedCode = &threadedCode[0];
+#endif
 
         stack.resize(64);
         vm.stack = &stack[0];
@@ -252,7 +259,7 @@ public:
         if(stream == this->stream) {
             this->stream = nullptr;
             // clear breakpoints
-            vm.breakpointsCount = 0;
+            AsebaVMClearBreakpoints(&vm);
         }
         if(abnormal)
             qDebug() << this << " : Client has disconnected unexpectedly.";
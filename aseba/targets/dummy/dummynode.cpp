@@ -46,6 +46,9 @@ private:
     AsebaVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    std::valarray<AsebaVMThreadedInstruction> threadedCode;
+#endif
     struct Variables {
         int16_t id;
         int16_t source;
@@ -84,6 +87,10 @@ public:
         bytecode.resize(512);
         vm.bytecode = &bytecode[0];
         vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED_DISPATCH
+        threadedCode.resize(bytecode.size());
+        vm.threadedCode = &threadedCode[0];
+#endif
 
         stack.resize(64);
         vm.stack = &stack[0];
@@ -165,7 +172,7 @@ public:
 #endif  // ZEROCONF_SUPPORT
         this->stream = nullptr;
         // clear breakpoints
-        vm.breakpointsCount = 0;
+        AsebaVMClearBreakpoints(&vm);
 
         if(abnormal)
             std::cerr << this << " : Client has disconnected unexpectedly." << std::endl;
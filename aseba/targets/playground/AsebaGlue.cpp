@@ -29,19 +29,35 @@
 #include <cstring>
 #include "AsebaGlue.h"
 #include "EnkiGlue.h"
+#include "VMScheduler.h"
 #include "vm/vm.h"
 #include "common/utils/FormatableString.h"
 
 namespace Aseba {
-// Mapping so that Aseba C callbacks can dispatch to the right objects
-VMStateToEnvironment vmStateToEnvironment;
-
 NamedRobot::NamedRobot(std::string robotName) : robotName(std::move(robotName)) {}
 
 // SingleVMNodeGlue
 
 SingleVMNodeGlue::SingleVMNodeGlue(std::string robotName, int16_t nodeId) : NamedRobot(std::move(robotName)) {
     vm.nodeId = nodeId;
+    vm.glue = this;
+    vmScheduler.add(&vm);
+}
+
+SingleVMNodeGlue::~SingleVMNodeGlue() {
+    vmScheduler.remove(&vm);
+}
+
+// AbstractNodeConnection
+
+void AbstractNodeConnection::linkVM(GluedVMState* vm) {
+    vm->connection = this;
+    linkedVMs.push_back(vm);
+}
+
+void AbstractNodeConnection::unlinkVM(GluedVMState* vm) {
+    vm->connection = nullptr;
+    linkedVMs.erase(std::remove(linkedVMs.begin(), linkedVMs.end(), vm), linkedVMs.end());
 }
 
 // RecvBufferNodeConnection
@@ -65,43 +81,37 @@ extern "C" void AsebaPutVmToSleep(AsebaVMState* vm) {
 }
 
 extern "C" void AsebaSendBuffer(AsebaVMState* vm, const uint8_t* data, uint16_t length) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    Aseba::AbstractNodeConnection* connection(environment.second);
+    Aseba::AbstractNodeConnection* connection(static_cast<Aseba::GluedVMState*>(vm)->connection);
     assert(connection);
     connection->sendBuffer(vm->nodeId, data, length);
 }
 
 extern "C" uint16_t AsebaGetBuffer(AsebaVMState* vm, uint8_t* data, uint16_t maxLength, uint16_t* source) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    Aseba::AbstractNodeConnection* connection(environment.second);
+    Aseba::AbstractNodeConnection* connection(static_cast<Aseba::GluedVMState*>(vm)->connection);
     assert(connection);
     return connection->getBuffer(data, maxLength, source);
 }
 
 extern "C" const AsebaVMDescription* AsebaGetVMDescription(AsebaVMState* vm) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    const Aseba::AbstractNodeGlue* glue(environment.first);
+    const Aseba::AbstractNodeGlue* glue(static_cast<Aseba::GluedVMState*>(vm)->glue);
     assert(glue);
     return glue->getDescription();
 }
 
 extern "C" const AsebaLocalEventDescription* AsebaGetLocalEventsDescriptions(AsebaVMState* vm) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    const Aseba::AbstractNodeGlue* glue(environment.first);
+    const Aseba::AbstractNodeGlue* glue(static_cast<Aseba::GluedVMState*>(vm)->glue);
     assert(glue);
     return glue->getLocalEventsDescriptions();
 }
 
 extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsDescriptions(AsebaVMState* vm) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    const Aseba::AbstractNodeGlue* glue(environment.first);
+    const Aseba::AbstractNodeGlue* glue(static_cast<Aseba::GluedVMState*>(vm)->glue);
     assert(glue);
     return glue->getNativeFunctionsDescriptions();
 }
 
 extern "C" void AsebaNativeFunction(AsebaVMState* vm, uint16_t id) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    Aseba::AbstractNodeGlue* glue(environment.first);
+    Aseba::AbstractNodeGlue* glue(static_cast<Aseba::GluedVMState*>(vm)->glue);
     assert(glue);
     glue->callNativeFunction(id);
 }
@@ -119,8 +129,7 @@ extern "C" int AsebaHandleDeviceInfoMessages(AsebaVMState* vm, uint16_t id, uint
 }
 
 extern "C" void AsebaAssert(AsebaVMState* vm, AsebaAssertReason reason) {
-    const Aseba::NodeEnvironment& environment(Aseba::vmStateToEnvironment.find(vm)->second);
-    const Aseba::AbstractNodeGlue* glue(environment.first);
+    const Aseba::AbstractNodeGlue* glue(static_cast<Aseba::GluedVMState*>(vm)->glue);
     assert(glue);
     std::cerr << Aseba::FormatableString(
                      "\nFatal error: glue %0 with node id %1 of type %2 at has produced exception: ")
@@ -26,7 +26,6 @@
 #include "vm/natives.h"
 #include <valarray>
 #include <vector>
-#include <map>
 #include <string>
 
 namespace Aseba {
@@ -53,26 +52,43 @@ struct NamedRobot {
     NamedRobot(std::string robotName);
 };
 
+struct AbstractNodeConnection;
+
+//! A VM state that knows the objects its C callbacks dispatch to, so that they find them in constant time
+struct GluedVMState : AsebaVMState {
+    AbstractNodeGlue* glue{nullptr};              //!< robot implementing the VM description and native functions
+    AbstractNodeConnection* connection{nullptr};  //!< connection to the external world, set by the connecting robot
+    size_t schedulerSlot{0};                      //!< index of this VM in VMScheduler, managed by the scheduler
+};
+
 struct SingleVMNodeGlue : NamedRobot, AbstractNodeGlue {
     // VM implementation
-    AsebaVMState vm;
+    GluedVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    std::valarray<AsebaVMThreadedInstruction> threadedCode;
+#endif
 
     SingleVMNodeGlue(std::string robotName, int16_t nodeId);
+    ~SingleVMNodeGlue() override;
 };
 
 struct AbstractNodeConnection {
+    // default virtual destructor
+    virtual ~AbstractNodeConnection() = default;
+
     virtual void sendBuffer(uint16_t nodeId, const uint8_t* data, uint16_t length) = 0;
     virtual uint16_t getBuffer(uint8_t* data, uint16_t maxLength, uint16_t* source) = 0;
-};
 
-// Mapping so that Aseba C callbacks can dispatch to the right objects
+    //! VMs linked to this connection, incoming messages are dispatched to all of them
+    std::vector<GluedVMState*> linkedVMs;
 
-typedef std::pair<AbstractNodeGlue*, AbstractNodeConnection*> NodeEnvironment;
-typedef std::map<AsebaVMState*, NodeEnvironment> VMStateToEnvironment;
-
-extern VMStateToEnvironment vmStateToEnvironment;
+    //! Link a VM to this connection, so that it sends through it and receives its messages
+    void linkVM(GluedVMState* vm);
+    //! Unlink a VM previously linked by linkVM()
+    void unlinkVM(GluedVMState* vm);
+};
 
 // Buffer for data reception
 
@@ -20,6 +20,7 @@
 
 #include "DashelAsebaGlue.h"
 #include "EnkiGlue.h"
+#include "VMScheduler.h"
 #include "common/utils/FormatableString.h"
 #include "transport/buffer/vm-buffer.h"
 
@@ -85,16 +86,20 @@ void SimpleDashelConnection::incomingData(Dashel::Stream* stream) {
         stream->read(&temp, 2);
         len = bswap16(temp);
         stream->read(&temp, 2);
-        lastMessageSource = bswap16(temp);
-        lastMessageData.resize(len + 2);
-        stream->read(&lastMessageData[0], lastMessageData.size());
-
-        // execute event on all VM that are linked to this connection
-        for(auto vmStateToEnvironmentKV : vmStateToEnvironment) {
-            if(vmStateToEnvironmentKV.second.second == this) {
-                AsebaProcessIncomingEvents(vmStateToEnvironmentKV.first);
-                AsebaVMRun(vmStateToEnvironmentKV.first, 1000);
-            }
+        const uint16_t source(bswap16(temp));
+        std::valarray<uint8_t> data(len + 2);
+        stream->read(&data[0], data.size());
+
+        // execute event on all VM that are linked to this connection, the scheduler might delay
+        // it after other messages are received, so each execution gets its own copy of the message
+        for(auto vm : linkedVMs) {
+            vmScheduler.post(vm, [this, vm, source, data]() {
+                lastMessageSource = source;
+                lastMessageData.resize(data.size());
+                lastMessageData = data;
+                AsebaProcessIncomingEvents(vm);
+                AsebaVMRun(vm, 1000);
+            });
         }
     } catch(Dashel::DashelException e) {
         SEND_NOTIFICATION(LOG_ERROR, "cannot read from socket", stream->getTargetName(), e.what());
@@ -116,10 +121,8 @@ void SimpleDashelConnection::connectionClosed(Dashel::Stream* stream, bool abnor
 
 //! Clear breakpoints on all VM that are linked to this connection
 void SimpleDashelConnection::clearBreakpoints() {
-    for(auto vmStateToEnvironmentKV : vmStateToEnvironment) {
-        if(vmStateToEnvironmentKV.second.second == this)
-            vmStateToEnvironmentKV.first->breakpointsCount = 0;
-    }
+    for(auto vm : linkedVMs)
+        AsebaVMClearBreakpoints(vm);
 }
 
 //! Disconnect old streams
@@ -74,15 +74,14 @@ public:
         , Aseba::SimpleDashelConnection(port)
 #endif  // ZEROCONF_SUPPORT
     {
-        Aseba::vmStateToEnvironment[&this->vm] =
-            std::make_pair((Aseba::AbstractNodeGlue*)this, (Aseba::AbstractNodeConnection*)this);
+        linkVM(&this->vm);
 #ifdef ZEROCONF_SUPPORT
         updateZeroconfStatus();
 #endif  // ZEROCONF_SUPPORT
     }
 
     ~DashelConnected() override {
-        Aseba::vmStateToEnvironment.erase(&this->vm);
+        unlinkVM(&this->vm);
     }
 
 protected:
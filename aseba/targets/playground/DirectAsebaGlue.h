@@ -26,6 +26,7 @@
 #include "common/msg/msg.h"
 #include "transport/buffer/vm-buffer.h"
 #include "AsebaGlue.h"
+#include "VMScheduler.h"
 
 // Implementation of the connection using direct connection
 
@@ -51,18 +52,22 @@ class DirectlyConnected : public AsebaRobot, public Aseba::DirectConnection {
 public:
     template <typename... Params>
     DirectlyConnected(Params... parameters) : AsebaRobot(parameters...) {
-        Aseba::vmStateToEnvironment[&this->vm] =
-            std::make_pair((Aseba::AbstractNodeGlue*)this, (Aseba::AbstractNodeConnection*)this);
+        linkVM(&this->vm);
     }
 
     ~DirectlyConnected() override {
-        Aseba::vmStateToEnvironment.erase(&this->vm);
+        unlinkVM(&this->vm);
     }
 
 protected:
     // from AbstractNodeGlue
 
     void externalInputStep(double dt) override {
+        if(!inQueue.empty())
+            Aseba::vmScheduler.post(&this->vm, [this]() { processInQueue(); });
+    }
+
+    void processInQueue() {
         while(!inQueue.empty()) {
             // serialize message into reception buffer
             const auto message(inQueue.front().get());
@@ -74,11 +79,9 @@ protected:
             std::copy(&content.rawData[0], &content.rawData[content.rawData.size()], &lastMessageData[2]);
 
             // execute event on all VM that are linked to this connection
-            for(auto vmStateToEnvironmentKV : Aseba::vmStateToEnvironment) {
-                if(vmStateToEnvironmentKV.second.second == this) {
-                    AsebaProcessIncomingEvents(vmStateToEnvironmentKV.first);
-                    AsebaVMRun(vmStateToEnvironmentKV.first, 1000);
-                }
+            for(auto vm : linkedVMs) {
+                AsebaProcessIncomingEvents(vm);
+                AsebaVMRun(vm, 1000);
             }
 
             // delete message
@@ -19,8 +19,17 @@
 */
 
 #include "EnkiGlue.h"
+#include <mutex>
 
 namespace Enki {
 std::unique_ptr<SimulatorEnvironment> simulatorEnvironment;
 
+static std::mutex simulatorEnvironmentMutex;
+
+void notifySimulatorEnvironment(const EnvironmentNotificationType type, const std::string& description,
+                                const strings& arguments) {
+    std::lock_guard<std::mutex> lock(simulatorEnvironmentMutex);
+    simulatorEnvironment->notify(type, description, arguments);
+}
+
 }  // namespace Enki
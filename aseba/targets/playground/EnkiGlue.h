@@ -27,6 +27,7 @@
 #include <enki/PhysicalEngine.h>
 #include "vm/vm.h"
 #include "common/utils/utils.h"
+#include "AsebaGlue.h"
 
 namespace Enki {
 // Interface for Aseba-enabled Enki objects and their native functions
@@ -60,25 +61,19 @@ struct SimulatorEnvironment {
 //! A global pointer to the environment
 extern std::unique_ptr<SimulatorEnvironment> simulatorEnvironment;
 
+//! Notify the environment, serializing calls as VMs might run in parallel (see Aseba::VMScheduler)
+void notifySimulatorEnvironment(const EnvironmentNotificationType type, const std::string& description,
+                                const strings& arguments);
+
 //! Helper macro to write notification sending in a convenient way
 #define SEND_NOTIFICATION(type, description, ...) \
     if(Enki::simulatorEnvironment)                \
-        Enki::simulatorEnvironment->notify(Enki::EnvironmentNotificationType::type, description, {__VA_ARGS__});
+        Enki::notifySimulatorEnvironment(Enki::EnvironmentNotificationType::type, description, {__VA_ARGS__});
 
 //! Return the Enki object of a given type associated with a given vm
 template <typename ObjectType>
 ObjectType* getEnkiObject(AsebaVMState* vm) {
-    if(!Enki::simulatorEnvironment)
-        return nullptr;
-    World* world(Enki::simulatorEnvironment->getWorld());
-    if(!world)
-        return nullptr;
-    for(auto objectIt = world->objects.begin(); objectIt != world->objects.end(); ++objectIt) {
-        auto* enkiObject = dynamic_cast<ObjectType*>(*objectIt);
-        if(enkiObject && (&(enkiObject->vm) == vm))
-            return enkiObject;
-    }
-    return nullptr;
+    return dynamic_cast<ObjectType*>(static_cast<Aseba::GluedVMState*>(vm)->glue);
 }
 
 }  // namespace Enki
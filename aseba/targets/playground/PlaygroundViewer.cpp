@@ -245,6 +245,9 @@ void PlaygroundViewer::timerEvent(QTimerEvent* event) {
         asebaObject->externalInputStep(double(timerPeriodMs) / 1000.);
 
     ViewerWidget::timerEvent(event);
+
+    // run the VMs on the events of this step, if the scheduler has queued them
+    Aseba::vmScheduler.step();
 }
 
 //! Help button or F1 have been pressed, show dialog box
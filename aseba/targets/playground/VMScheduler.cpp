@@ -0,0 +1,151 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VMScheduler.h"
+#include "vm/vm.h"
+#include <cassert>
+
+namespace Aseba {
+VMScheduler vmScheduler;
+
+VMScheduler::~VMScheduler() {
+    stopWorkers();
+}
+
+void VMScheduler::add(GluedVMState* vm) {
+    vm->schedulerSlot = slots.size();
+    slots.push_back({vm, {}, {}});
+}
+
+void VMScheduler::remove(GluedVMState* vm) {
+    const size_t slot(vm->schedulerSlot);
+    assert(slot < slots.size() && slots[slot].vm == vm);
+    // move the last slot in place of the removed one
+    if(slot != slots.size() - 1) {
+        slots[slot] = std::move(slots.back());
+        slots[slot].vm->schedulerSlot = slot;
+    }
+    slots.pop_back();
+}
+
+void VMScheduler::setThreadCount(unsigned count) {
+    // run work queued for the previous configuration
+    step();
+    stopWorkers();
+    quitting = false;
+    threadCount = count;
+    for(unsigned i = 1; i < count; ++i)
+        workers.emplace_back(&VMScheduler::workerLoop, this, generation);
+}
+
+void VMScheduler::post(GluedVMState* vm, Job job) {
+    if(threadCount > 0)
+        slots[vm->schedulerSlot].jobs.push_back(std::move(job));
+    else
+        job();
+}
+
+void VMScheduler::then(GluedVMState* vm, Job job) {
+    if(threadCount > 0)
+        slots[vm->schedulerSlot].thenJobs.push_back(std::move(job));
+    else
+        job();
+}
+
+void VMScheduler::runEvent(GluedVMState* vm, uint16_t event, uint16_t stepsLimit) {
+    post(vm, [vm, event, stepsLimit]() {
+        AsebaVMSetupEvent(vm, event);
+        AsebaVMRun(vm, stepsLimit);
+    });
+}
+
+void VMScheduler::step() {
+    pendingSlots.clear();
+    for(size_t i = 0; i < slots.size(); ++i)
+        if(!slots[i].jobs.empty() || !slots[i].thenJobs.empty())
+            pendingSlots.push_back(i);
+    if(pendingSlots.empty())
+        return;
+
+    nextPendingSlot = 0;
+    if(!workers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++generation;
+            busyWorkers = unsigned(workers.size());
+        }
+        workAvailable.notify_all();
+    }
+
+    runPendingSlots();
+
+    if(!workers.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        workDone.wait(lock, [this] { return busyWorkers == 0; });
+    }
+
+    // all VMs ran, use their outputs; these jobs might post work for the next step
+    for(const size_t slot : pendingSlots) {
+        std::vector<Job> thenJobs;
+        thenJobs.swap(slots[slot].thenJobs);
+        for(auto& job : thenJobs)
+            job();
+    }
+}
+
+//! Run the queues of pending slots until none is left, from any thread
+void VMScheduler::runPendingSlots() {
+    for(size_t i = nextPendingSlot++; i < pendingSlots.size(); i = nextPendingSlot++) {
+        auto& jobs(slots[pendingSlots[i]].jobs);
+        for(auto& job : jobs)
+            job();
+        jobs.clear();
+    }
+}
+
+void VMScheduler::workerLoop(unsigned seenGeneration) {
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&] { return quitting || generation != seenGeneration; });
+            if(quitting)
+                return;
+            seenGeneration = generation;
+        }
+        runPendingSlots();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        workDone.notify_one();
+    }
+}
+
+void VMScheduler::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quitting = true;
+    }
+    workAvailable.notify_all();
+    for(auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+}  // namespace Aseba
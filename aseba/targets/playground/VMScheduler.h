@@ -0,0 +1,103 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PLAYGROUND_VM_SCHEDULER_H
+#define __PLAYGROUND_VM_SCHEDULER_H
+
+#include "AsebaGlue.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Aseba {
+//! Runs the VMs of all simulated robots.
+//! Without threads (the default), work is executed as soon as it is posted, as a robot would do.
+//! With threads, the work posted during a physics step is queued per VM and step() executes the
+//! queues of all VMs in parallel; each queue runs in order, so a VM never runs concurrently with itself.
+//! Robots use the outputs of their VM in a job passed to then(), which step() runs once all VMs ran,
+//! so that robots post their work during the physics step and all VMs run together afterwards.
+//! Robots must only touch their own state from their VM, which is the case of the playground robots.
+class VMScheduler {
+public:
+    //! Some work to be done on a VM, such as executing an event
+    using Job = std::function<void()>;
+
+    ~VMScheduler();
+
+    //! Register a VM, done by SingleVMNodeGlue
+    void add(GluedVMState* vm);
+    //! Unregister a VM, dropping its queued work
+    void remove(GluedVMState* vm);
+
+    //! Set the number of threads running VMs in step(), 0 to run work immediately when posted
+    void setThreadCount(unsigned count);
+    //! Return the number of threads running VMs in step()
+    unsigned getThreadCount() const {
+        return threadCount;
+    }
+
+    //! Run job on vm, now or in the next step(); must be called from the thread calling step()
+    void post(GluedVMState* vm, Job job);
+    //! Run job once the work queued for vm ran, so that it can read the outputs of vm: now without
+    //! threads, otherwise at the end of the next step(), from its thread; must be called from that thread
+    void then(GluedVMState* vm, Job job);
+    //! Execute event on vm, for at most stepsLimit instructions
+    void runEvent(GluedVMState* vm, uint16_t event, uint16_t stepsLimit = 1000);
+
+    //! Execute all queued work, then the jobs passed to then(); call between physics steps
+    void step();
+
+protected:
+    //! A registered VM, its queued work and the jobs using its outputs
+    struct Slot {
+        GluedVMState* vm;
+        std::vector<Job> jobs;
+        std::vector<Job> thenJobs;
+    };
+    //! All registered VMs, contiguous so that step() can go through them quickly
+    std::vector<Slot> slots;
+    //! Indices of slots having work during the current step
+    std::vector<size_t> pendingSlots;
+
+    //! Number of threads running VMs, 0 if running work immediately
+    unsigned threadCount{0};
+    //! Worker threads, the thread calling step() being the first of threadCount
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    unsigned generation{0};   //!< incremented at each step() so that workers know there is new work
+    unsigned busyWorkers{0};  //!< number of workers still running VMs for the current generation
+    bool quitting{false};
+    std::atomic<size_t> nextPendingSlot{0};
+
+    void runPendingSlots();
+    void workerLoop(unsigned seenGeneration);
+    void stopWorkers();
+};
+
+//! The scheduler of all VMs of the simulator
+extern VMScheduler vmScheduler;
+
+}  // namespace Aseba
+
+#endif  // __PLAYGROUND_VM_SCHEDULER_H
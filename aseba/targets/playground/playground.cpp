@@ -30,6 +30,7 @@
 #include "Door.h"
 #include "PlaygroundViewer.h"
 #include "Robots.h"
+#include "VMScheduler.h"
 #include <QtXml>
 #include <QApplication>
 #include <QFileDialog>
@@ -41,6 +42,7 @@
 #include <QHash>
 #include <QHostInfo>
 #include <utility>
+#include <cstdlib>
 
 #ifdef HAVE_DBUS
 #    include "PlaygroundDBusAdaptors.h"
@@ -55,15 +57,26 @@ namespace Enki {
 class PlaygroundSimulatorEnvironment : public SimulatorEnvironment {
 public:
     const QString sceneFileName;
-    PlaygroundViewer& viewer;
+    World& world;
+    PlaygroundViewer* viewer;  //!< nullptr when running headless
 
 public:
-    PlaygroundSimulatorEnvironment(QString sceneFileName, PlaygroundViewer& viewer)
-        : sceneFileName(std::move(sceneFileName)), viewer(viewer) {}
+    PlaygroundSimulatorEnvironment(QString sceneFileName, World& world, PlaygroundViewer* viewer)
+        : sceneFileName(std::move(sceneFileName)), world(world), viewer(viewer) {}
 
     void notify(const EnvironmentNotificationType type, const std::string& description,
                 const strings& arguments) override {
-        viewer.notifyAsebaEnvironment(type, description, arguments);
+        if(viewer) {
+            viewer->notifyAsebaEnvironment(type, description, arguments);
+        } else {
+            std::cerr << description;
+            for(const auto& argument : arguments)
+                std::cerr << " " << argument;
+            std::cerr << std::endl;
+            // as the viewer, which aborts after telling the user
+            if(type == EnvironmentNotificationType::FATAL_ERROR)
+                exit(EXIT_FAILURE);
+        }
     }
 
     std::string getSDFilePath(const std::string& robotName, unsigned fileNumber) const override {
@@ -80,11 +93,53 @@ public:
     }
 
     World* getWorld() const override {
-        return viewer.getWorld();
+        return &world;
     }
 };
 }  // namespace Enki
 
+//! Step the world without display, as fast as possible if speed is 0, otherwise at speed times real time;
+//! run forever if duration is 0, otherwise for duration simulated seconds.
+//! Periodically print the simulated seconds per wall-clock second.
+static int runHeadless(QCoreApplication& app, Enki::World& world, double duration, double speed) {
+    // same step as the viewer, which does 3 physics steps per 30 ms
+    const double dt(0.03);
+    const unsigned physicsOversampling(3);
+    const Aseba::UnifiedTime reportPeriod(10000);
+
+    const Aseba::UnifiedTime startTime;
+    Aseba::UnifiedTime lastReportTime(startTime);
+    double simulatedTime(0);
+    auto report = [&]() {
+        const double wallTime((Aseba::UnifiedTime() - startTime).value / 1000.);
+        std::cout << "simulated " << simulatedTime << " s in " << wallTime << " s, "
+                  << (wallTime > 0 ? simulatedTime / wallTime : 0) << " simulated s per wall s" << std::endl;
+    };
+
+    while(duration <= 0 || simulatedTime < duration) {
+        world.step(dt, physicsOversampling);
+        Aseba::vmScheduler.step();
+        simulatedTime += dt;
+
+        // let Qt process network, zeroconf and external processes
+        app.processEvents();
+
+        const Aseba::UnifiedTime now;
+        if(speed > 0) {
+            const Aseba::UnifiedTime::Value targetMs(simulatedTime * 1000. / speed);
+            const Aseba::UnifiedTime targetTime(startTime + Aseba::UnifiedTime(targetMs));
+            if(targetTime > now)
+                (targetTime - now).sleep();
+        }
+        if(now - lastReportTime >= reportPeriod) {
+            report();
+            lastReportTime = now;
+        }
+    }
+    report();
+    return 0;
+}
+
 //! A function to create a robot of a given type
 #ifdef ZEROCONF_SUPPORT
 using RobotFactory = std::function<Enki::Robot*(Aseba::Zeroconf&, unsigned, std::string, std::string, int16_t)>;
@@ -117,8 +172,39 @@ struct RobotType {
 
 
 int main(int argc, char* argv[]) {
+    // Get cmd line arguments
+    QString sceneFileName;
+    bool ask = true;
+    bool headless = false;
+    double duration = 0;
+    double speed = 0;
+    for(int i = 1; i < argc; ++i) {
+        const QString arg(argv[i]);
+        if(arg == "--vm-threads" && i + 1 < argc) {
+            // run the VMs of robots in parallel between physics steps
+            Aseba::vmScheduler.setThreadCount(QString(argv[++i]).toUInt());
+        } else if(arg == "--headless") {
+            headless = true;
+        } else if(arg == "--duration" && i + 1 < argc) {
+            duration = QString(argv[++i]).toDouble();
+        } else if(arg == "--speed" && i + 1 < argc) {
+            speed = QString(argv[++i]).toDouble();
+        } else {
+            sceneFileName = arg;
+            ask = false;
+        }
+    }
+    if(headless && ask) {
+        std::cerr << "Usage: " << argv[0]
+                  << " --headless [--duration SECONDS] [--speed FACTOR] [--vm-threads COUNT] SCENARIO" << std::endl;
+        return 1;
+    }
+
     Q_INIT_RESOURCE(asebaqtabout);
-    QApplication app(argc, argv);
+    // without display, a core application is enough, and does not require a windowing system
+    std::unique_ptr<QCoreApplication> appPtr(headless ? new QCoreApplication(argc, argv) :
+                                                        new QApplication(argc, argv));
+    QCoreApplication& app(*appPtr);
     QCoreApplication::setOrganizationName(ASEBA_ORGANIZATION_NAME);
     QCoreApplication::setOrganizationDomain(ASEBA_ORGANIZATION_DOMAIN);
     app.setApplicationName("Playground");
@@ -139,14 +225,6 @@ int main(int argc, char* argv[]) {
 
     // create document
     QDomDocument domDocument("aseba-playground");
-    QString sceneFileName;
-
-    // Get cmd line arguments
-    bool ask = true;
-    if(argc > 1) {
-        sceneFileName = argv[1];
-        ask = false;
-    }
 
     // Try to load xml config file
     do {
@@ -165,10 +243,24 @@ int main(int argc, char* argv[]) {
         }
 
         QFile file(sceneFileName);
-        if(file.open(QIODevice::ReadOnly)) {
+        if(!file.open(QIODevice::ReadOnly) && headless) {
+            std::cerr << "Cannot open scenario " << sceneFileName.toStdString() << std::endl;
+            return 1;
+        }
+        if(file.isOpen()) {
             QString errorStr;
             int errorLine, errorColumn;
             if(!domDocument.setContent(&file, false, &errorStr, &errorLine, &errorColumn)) {
+                if(headless) {
+                    std::cerr << app.tr("Parse error at file %1, line %2, column %3:\n%4")
+                                     .arg(sceneFileName)
+                                     .arg(errorLine)
+                                     .arg(errorColumn)
+                                     .arg(errorStr)
+                                     .toStdString()
+                              << std::endl;
+                    return 1;
+                }
                 QMessageBox::information(nullptr, "Aseba Playground",
                                          app.tr("Parse error at file %1, line %2, column %3:\n%4")
                                              .arg(sceneFileName)
@@ -236,11 +328,20 @@ int main(int argc, char* argv[]) {
     }
     Enki::World world(worldE.attribute("w").toDouble(), worldE.attribute("h").toDouble(), worldColor, groundTexture);
 
-    // Create viewer
-    Enki::PlaygroundViewer viewer(&world, worldE.attribute("energyScoringSystemEnabled", "false").toLower() == "true");
+    // Create viewer, unless running headless
+    std::unique_ptr<Enki::PlaygroundViewer> viewer;
+    if(!headless)
+        viewer.reset(new Enki::PlaygroundViewer(
+            &world, worldE.attribute("energyScoringSystemEnabled", "false").toLower() == "true"));
     if(Enki::simulatorEnvironment)
         qDebug() << "A simulator environment already exists, replacing";
-    Enki::simulatorEnvironment.reset(new Enki::PlaygroundSimulatorEnvironment(sceneFileName, viewer));
+    Enki::simulatorEnvironment.reset(new Enki::PlaygroundSimulatorEnvironment(sceneFileName, world, viewer.get()));
+    auto log = [&viewer](const QString& entry, const QColor& color) {
+        if(viewer)
+            viewer->log(entry, color);
+        else
+            std::cout << entry.toStdString() << std::endl;
+    };
 
     // Zeroconf support to advertise targets
 #ifdef ZEROCONF_SUPPORT
@@ -249,9 +350,9 @@ int main(int argc, char* argv[]) {
 
     // Scan for camera
     QDomElement cameraE = domDocument.documentElement().firstChildElement("camera");
-    if(!cameraE.isNull()) {
+    if(viewer && !cameraE.isNull()) {
         const double largestDim(qMax(world.h, world.w));
-        viewer.setCamera(QPointF(cameraE.attribute("x", QString::number(world.w / 2)).toDouble(),
+        viewer->setCamera(QPointF(cameraE.attribute("x", QString::number(world.w / 2)).toDouble(),
                                  cameraE.attribute("y", QString::number(0)).toDouble()),
                          cameraE.attribute("altitude", QString::number(0.85 * largestDim)).toDouble(),
                          cameraE.attribute("yaw", QString::number(-M_PI / 2)).toDouble(),
@@ -396,10 +497,10 @@ int main(int argc, char* argv[]) {
             world.addObject(robot);
 
             // log
-            viewer.log(app.tr("New robot %0 of type %1 on port %2").arg(qRobotNameRaw).arg(qTypeName).arg(port),
+            log(app.tr("New robot %0 of type %1 on port %2").arg(qRobotNameRaw).arg(qTypeName).arg(port),
                        Qt::white);
         } else
-            viewer.log("Error, unknown robot type " + type, Qt::red);
+            log("Error, unknown robot type " + type, Qt::red);
 
         robotE = robotE.nextSiblingElement("robot");
     }
@@ -411,15 +512,21 @@ int main(int argc, char* argv[]) {
         QString command(procssE.attribute("command"));
         // create process
         processes.push_back(new QProcess());
-        processes.back()->setProcessChannelMode(QProcess::MergedChannels);
         processes.back()->setWorkingDirectory(QFileInfo(sceneFileName).canonicalPath());
-        // make sure it is killed when we close the window
-        QObject::connect(processes.back(), SIGNAL(started()), &viewer, SLOT(processStarted()));
-        QObject::connect(processes.back(), SIGNAL(error(QProcess::ProcessError)), &viewer,
-                         SLOT(processError(QProcess::ProcessError)));
-        QObject::connect(processes.back(), SIGNAL(readyReadStandardOutput()), &viewer, SLOT(processReadyRead()));
-        QObject::connect(processes.back(), SIGNAL(finished(int, QProcess::ExitStatus)), &viewer,
-                         SLOT(processFinished(int, QProcess::ExitStatus)));
+        if(viewer) {
+            processes.back()->setProcessChannelMode(QProcess::MergedChannels);
+            // make sure it is killed when we close the window
+            QObject::connect(processes.back(), SIGNAL(started()), viewer.get(), SLOT(processStarted()));
+            QObject::connect(processes.back(), SIGNAL(error(QProcess::ProcessError)), viewer.get(),
+                             SLOT(processError(QProcess::ProcessError)));
+            QObject::connect(processes.back(), SIGNAL(readyReadStandardOutput()), viewer.get(),
+                             SLOT(processReadyRead()));
+            QObject::connect(processes.back(), SIGNAL(finished(int, QProcess::ExitStatus)), viewer.get(),
+                             SLOT(processFinished(int, QProcess::ExitStatus)));
+        } else {
+            // without viewer, the output of processes goes to ours
+            processes.back()->setProcessChannelMode(QProcess::ForwardedChannels);
+        }
         // check whether it is a relative command
         bool isRelative(false);
         if(!command.isEmpty() && command[0] == ':') {
@@ -429,7 +536,7 @@ int main(int argc, char* argv[]) {
         // process the command into its components
         QStringList args(command.split(" ", QString::SkipEmptyParts));
         if(args.size() == 0) {
-            viewer.log(app.tr("Missing program in command"), Qt::red);
+            log(app.tr("Missing program in command"), Qt::red);
         } else {
             const QString program(QDir::toNativeSeparators(args[0]));
             args.pop_front();
@@ -442,19 +549,24 @@ int main(int argc, char* argv[]) {
         procssE = procssE.nextSiblingElement("process");
     }
 
-    // Show and run
-    viewer.setWindowTitle(app.tr("Aseba Playground - Simulate your robots!"));
-    viewer.show();
+    int exitValue;
+    if(viewer) {
+        // Show and run
+        viewer->setWindowTitle(app.tr("Aseba Playground - Simulate your robots!"));
+        viewer->show();
 
 // If D-Bus is used, register the viewer object
 #ifdef HAVE_DBUS
-    new Enki::EnkiWorldInterface(&viewer);
-    QDBusConnection::sessionBus().registerObject("/world", &viewer);
-    QDBusConnection::sessionBus().registerService("ch.epfl.mobots.AsebaPlayground");
+        new Enki::EnkiWorldInterface(viewer.get());
+        QDBusConnection::sessionBus().registerObject("/world", viewer.get());
+        QDBusConnection::sessionBus().registerService("ch.epfl.mobots.AsebaPlayground");
 #endif  // HAVE_DBUS
 
-    // Run the application
-    const int exitValue(app.exec());
+        // Run the application
+        exitValue = app.exec();
+    } else {
+        exitValue = runHeadless(app, world, duration, speed);
+    }
 
     // Stop and delete ongoing processes
     foreach(QProcess* process, processes) {
@@ -21,6 +21,7 @@
 #include "EPuck.h"
 #include "../../Parameters.h"
 #include "../../EnkiGlue.h"
+#include "../../VMScheduler.h"
 #include "common/productids.h"
 #include "common/utils/utils.h"
 
@@ -152,6 +153,10 @@ AsebaFeedableEPuck::AsebaFeedableEPuck(std::string robotName, int16_t nodeId)
     bytecode.resize(1024);
     vm.bytecode = &bytecode[0];
     vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    threadedCode.resize(bytecode.size());
+    vm.threadedCode = &threadedCode[0];
+#endif
 
     stack.resize(32);
     vm.stack = &stack[0];
@@ -190,18 +195,25 @@ void AsebaFeedableEPuck::controlStep(double dt) {
 
     // FIXME: running the VM should be done in a soft timer to be independant of time step
 
-    // run VM
-    AsebaVMRun(&vm, 1000);
-
-    // reschedule a IR sensors and camera events if we are not in step by step
-    if(AsebaMaskIsClear(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) ||
-       AsebaMaskIsClear(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK)) {
-        AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START);
-        AsebaVMRun(&vm, 1000);
-        AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START - 1);
+    Aseba::vmScheduler.post(&vm, [this]() {
+        // run VM
         AsebaVMRun(&vm, 1000);
-    }
 
+        // reschedule a IR sensors and camera events if we are not in step by step
+        if(AsebaMaskIsClear(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) ||
+           AsebaMaskIsClear(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK)) {
+            AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START);
+            AsebaVMRun(&vm, 1000);
+            AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START - 1);
+            AsebaVMRun(&vm, 1000);
+        }
+    });
+
+    // once the VM ran, possibly in parallel with the ones of the other robots
+    Aseba::vmScheduler.then(&vm, [this, dt]() { applyVMOutputs(dt); });
+}
+
+void AsebaFeedableEPuck::applyVMOutputs(double dt) {
     // set physical variables
     leftSpeed = (double)(variables.speedL * 12.8) / 1000.;
     rightSpeed = (double)(variables.speedR * 12.8) / 1000.;
@@ -218,7 +230,8 @@ void AsebaFeedableEPuck::controlStep(double dt) {
 
 extern "C" AsebaVMDescription PlaygroundEPuckVMDescription;
 
-// really ugly and *thread unsafe* hack to have e-puck with different names
+// really ugly and *thread unsafe* hack to have e-puck with different names, with a threaded
+// VMScheduler, e-pucks with different ids describing themselves in the same step might swap names
 static char ePuckName[] = "e-puck0";
 
 const AsebaVMDescription* AsebaFeedableEPuck::getDescription() const {
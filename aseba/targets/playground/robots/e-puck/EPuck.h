@@ -102,6 +102,9 @@ public:
     const AsebaLocalEventDescription* getLocalEventsDescriptions() const override;
     const AsebaNativeFunctionDescription* const* getNativeFunctionsDescriptions() const override;
     void callNativeFunction(uint16_t id) override;
+
+protected:
+    void applyVMOutputs(double dt);
 };
 }  // namespace Enki
 
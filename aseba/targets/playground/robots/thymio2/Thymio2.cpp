@@ -22,6 +22,7 @@
 #include "Thymio2-natives.h"
 #include "../../Parameters.h"
 #include "../../EnkiGlue.h"
+#include "../../VMScheduler.h"
 #include "common/productids.h"
 #include "common/utils/utils.h"
 
@@ -44,6 +45,10 @@ AsebaThymio2::AsebaThymio2(std::string robotName, int16_t nodeId)
     bytecode.resize(766 + 768);
     vm.bytecode = &bytecode[0];
     vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    threadedCode.resize(bytecode.size());
+    vm.threadedCode = &threadedCode[0];
+#endif
 
     stack.resize(32);
     vm.stack = &stack[0];
@@ -148,6 +153,11 @@ void AsebaThymio2::controlStep(double dt) {
     // process external inputs (incoming event from network or environment, etc.)
     externalInputStep(dt);
 
+    // once the VM ran, possibly in parallel with the ones of the other robots
+    vmScheduler.then(&vm, [this, dt]() { applyVMOutputs(dt); });
+}
+
+void AsebaThymio2::applyVMOutputs(double dt) {
     // set physical variables
     leftSpeed = double(variables.motorLeftTarget) * 16.6 / 500.;
     rightSpeed = double(variables.motorRightTarget) * 16.6 / 500.;
@@ -302,15 +312,19 @@ int16_t AsebaThymio2::getSaturatedProxHorizontal(unsigned i) const {
     return static_cast<int16_t>(sensor->getValue());
 }
 
-//! Execute a local event, killing the execution of the current one if not in step-by-step mode
+//! Execute a local event, killing the execution of the current one if not in step-by-step mode;
+//! if the scheduler is threaded, this happens at its next step
 void AsebaThymio2::execLocalEvent(uint16_t number) {
-    // in step-by-step, only setup an event if none is being executed currently
-    if(AsebaMaskIsSet(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) && AsebaMaskIsSet(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK))
-        return;
-
-    variables.source = vm.nodeId;
-    AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START - number);
-    AsebaVMRun(&vm, 1000);
+    vmScheduler.post(&vm, [this, number]() {
+        // in step-by-step, only setup an event if none is being executed currently
+        if(AsebaMaskIsSet(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) &&
+           AsebaMaskIsSet(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK))
+            return;
+
+        variables.source = vm.nodeId;
+        AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START - number);
+        AsebaVMRun(&vm, 1000);
+    });
 }
 
 }  // namespace Enki
@@ -160,6 +160,7 @@ protected:
     void timer1Timeout();
     void timer100HzTimeout();
     int16_t getSaturatedProxHorizontal(unsigned i) const;
+    void applyVMOutputs(double dt);
 };
 
 }  // namespace Enki
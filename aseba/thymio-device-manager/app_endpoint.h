@@ -7,6 +7,7 @@
 #include "flatbuffers_message_writer.h"
 #include "flatbuffers_message_reader.h"
 #include "flatbuffers_messages.h"
+#include "app_outbound_queue.h"
 #include "aseba_node_registery.h"
 #include "tdm.h"
 #include "log.h"
@@ -164,13 +165,29 @@ public:
     }
 
     void write_message(tagged_detached_flatbuffer&& buffer) {
-        m_queue.emplace(std::move(buffer));
-        if(m_queue.size() > 1 || m_protocol_version == 0)
+        write_message(std::make_shared<const tagged_detached_flatbuffer>(std::move(buffer)));
+    }
+
+    // Buffers can be shared by several endpoints, node is set for variables updates
+    void write_message(std::shared_ptr<const tagged_detached_flatbuffer> buffer,
+                       const std::optional<aseba_node_registery::node_id>& node = {}) {
+        const bool writing = !m_queue.empty();
+        if(!m_queue.push(std::move(buffer), node)) {
+            mLogWarn("Disconnecting application too slow to read its messages");
+            boost::system::error_code ec;
+            this->tcp_socket().close(ec);
+            return;
+        }
+        if(writing || m_protocol_version == 0)
             return;
 
         base::do_write_message(m_queue.front().buffer);
     }
 
+    void set_outbound_queue_limits(const app_outbound_queue::limits& limits) {
+        m_queue.set_limits(limits);
+    }
+
 
     void handle_read(boost::system::error_code ec, fb_message_ptr&& msg) {
         if(ec) {
@@ -221,7 +238,7 @@ public:
             case mobsya::fb::AnyMessage::CompileAndLoadCodeOnVM: {
                 auto req = msg.as<fb::CompileAndLoadCodeOnVM>();
                 this->compile_and_send_program(req->request_id(), req->node_id(), vm_language(req->language()),
-                                               req->program()->str(), req->options());
+                                               req->program()->str(), req->options(), req->vector_loops());
                 break;
             }
             case mobsya::fb::AnyMessage::SetVMExecutionState: {
@@ -231,7 +248,8 @@ public:
             }
             case mobsya::fb::AnyMessage::WatchNode: {
                 auto req = msg.as<fb::WatchNode>();
-                this->watch_node(req->request_id(), req->node_id(), req->info_type());
+                this->watch_node(req->request_id(), req->node_id(), req->info_type(),
+                                 std::chrono::milliseconds(req->variables_update_period()));
                 break;
             }
             case mobsya::fb::AnyMessage::SetBreakpoints: {
@@ -251,6 +269,9 @@ public:
             mLogError("handle_write : error {}", ec.message());
         }
         m_queue.pop();
+        for(const auto& id : m_queue.take_nodes_to_resync()) {
+            resync_node_variables(id);
+        }
         if(!m_queue.empty()) {
             base::do_write_message(m_queue.front().buffer);
         }
@@ -258,6 +279,11 @@ public:
 
     ~application_endpoint() {
         mLogInfo("Stopping app endpoint");
+        const auto& stats = m_queue.stats();
+        if(stats.dropped || stats.coalesced) {
+            mLogInfo("{} messages dropped, {} variables updates coalesced, at most {} bytes queued", stats.dropped,
+                     stats.coalesced, stats.max_size);
+        }
 
         /* Disconnecting the node monotoring status before unlocking the nodes,
          * otherwise we would receive node status event during destroying the endpoint, leading to a crash */
@@ -278,21 +304,24 @@ public:
         });
     }
 
-    void node_variables_changed(std::shared_ptr<aseba_node> node, const aseba_node::variables_map& map) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, map]() {
-            that->do_node_variables_changed(node, map);
+    void node_variables_changed(std::shared_ptr<aseba_node> node,
+                                node_notification_ptr<aseba_node::variables_map> notification) {
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, notification]() {
+            that->do_node_variables_changed(node, notification);
         });
     }
 
-    void node_emitted_events(std::shared_ptr<aseba_node> node, const aseba_node::event_changed_payload& payload) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, payload]() {
-            that->do_node_emitted_events(node, payload);
+    void node_emitted_events(std::shared_ptr<aseba_node> node,
+                             node_notification_ptr<aseba_node::event_changed_payload> notification) {
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, notification]() {
+            that->do_node_emitted_events(node, notification);
         });
     }
 
-    void node_execution_state_changed(std::shared_ptr<aseba_node> node, const aseba_node::vm_execution_state& state) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, state]() {
-            that->do_node_execution_state_changed(node, state);
+    void node_execution_state_changed(std::shared_ptr<aseba_node> node,
+                                      node_notification_ptr<aseba_node::vm_execution_state> notification) {
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, notification]() {
+            that->do_node_execution_state_changed(node, notification);
         });
     }
 
@@ -318,37 +347,59 @@ private:
         }
     }
 
-    void do_node_variables_changed(std::shared_ptr<aseba_node> node, const aseba_node::variables_map& map) {
+    void do_node_variables_changed(std::shared_ptr<aseba_node> node,
+                                   node_notification_ptr<aseba_node::variables_map> notification) {
+        if(!node)
+            return;
+        write_message(notification->serialized([&node](const aseba_node::variables_map& map) {
+                          return serialize_changed_variables(*node, map);
+                      }),
+                      node->uuid());
+    }
+
+    // Send all the variables of a node whose updates were coalesced, if still watched
+    void resync_node_variables(const aseba_node_registery::node_id& id) {
+        if(!m_watch_nodes[fb::WatchableInfo::Variables].count(id))
+            return;
+        auto node = registery().node_from_id(id);
         if(!node)
             return;
-        write_message(serialize_changed_variables(*node, map));
+        boost::asio::post(node->strand(), [node, ptr = weak_from_this()]() {
+            if(auto that = ptr.lock())
+                that->node_variables_changed(node, make_node_notification(node->variables()));
+        });
     }
 
-    void do_node_emitted_events(std::shared_ptr<aseba_node> node, const aseba_node::event_changed_payload& payload) {
+    void do_node_emitted_events(std::shared_ptr<aseba_node> node,
+                                node_notification_ptr<aseba_node::event_changed_payload> notification) {
         if(!node)
             return;
-        variant_ns::visit(overloaded{[this, &node](const aseba_node::variables_map& map) {
-                                         write_message(serialize_events(*node, map));
-                                     },
-                                     [this, &node](const aseba_node::events_table& desc) {
-                                         write_message(serialize_events_descriptions(*node, desc));
-                                     }},
-                          payload);
+        write_message(notification->serialized([&node](const aseba_node::event_changed_payload& payload) {
+            return variant_ns::visit(overloaded{[&node](const aseba_node::variables_map& map) {
+                                                    return serialize_events(*node, map);
+                                                },
+                                                [&node](const aseba_node::events_table& desc) {
+                                                    return serialize_events_descriptions(*node, desc);
+                                                }},
+                                     payload);
+        }));
     }
 
     void do_node_execution_state_changed(std::shared_ptr<aseba_node> node,
-                                         const aseba_node::vm_execution_state& state) {
+                                         node_notification_ptr<aseba_node::vm_execution_state> notification) {
         if(!node)
             return;
-        write_message(serialize_execution_state(*node, state));
+        write_message(notification->serialized([&node](const aseba_node::vm_execution_state& state) {
+            return serialize_execution_state(*node, state);
+        }));
     }
 
 
     void send_full_node_list() {
         flatbuffers::FlatBufferBuilder builder;
         std::vector<flatbuffers::Offset<fb::Node>> nodes;
-        auto map = registery().nodes();
-        for(auto& node : map) {
+        const auto map = registery().nodes();
+        for(auto& node : *map) {
             const auto ptr = node.second.lock();
             if(!ptr)
                 continue;
@@ -387,7 +438,7 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        n->rename(new_name);
+        boost::asio::post(n->strand(), [n, new_name] { n->rename(new_name); });
         write_message(create_ack_response(request_id));
     }
 
@@ -433,11 +484,14 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = n->set_node_variables(m, create_device_write_completion_cb(request_id));
-        if(err) {
-            mLogWarn("set_node_variables: invalid variables", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-        }
+        boost::asio::post(n->strand(), [n, m = std::move(m), cb = create_device_write_completion_cb(request_id),
+                                        request_id, ptr = weak_from_this()]() mutable {
+            auto err = n->set_node_variables(m, std::move(cb));
+            if(err) {
+                mLogWarn("set_node_variables: invalid variables");
+                post_message(ptr, create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+            }
+        });
     }
 
     void set_node_events_table(uint32_t request_id, const aseba_node_registery::node_id& id,
@@ -448,13 +502,15 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = n->set_node_events_table(events);
-        if(err) {
-            mLogWarn("set_node_events_table: invalid events", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-        } else {
-            write_message(create_ack_response(request_id));
-        }
+        boost::asio::post(n->strand(), [n, events = std::move(events), request_id, ptr = weak_from_this()]() {
+            auto err = n->set_node_events_table(events);
+            if(err) {
+                mLogWarn("set_node_events_table: invalid events");
+                post_message(ptr, create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+            } else {
+                post_message(ptr, create_ack_response(request_id));
+            }
+        });
     }
 
     void emit_events(uint32_t request_id, const aseba_node_registery::node_id& id, aseba_node::variables_map m) {
@@ -464,15 +520,18 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = n->emit_events(m, create_device_write_completion_cb(request_id));
-        if(err) {
-            mLogWarn("emits_events: invalid variables", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-        }
+        boost::asio::post(n->strand(), [n, m = std::move(m), cb = create_device_write_completion_cb(request_id),
+                                        request_id, ptr = weak_from_this()]() mutable {
+            auto err = n->emit_events(m, std::move(cb));
+            if(err) {
+                mLogWarn("emits_events: invalid variables");
+                post_message(ptr, create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+            }
+        });
     }
 
     void compile_and_send_program(uint32_t request_id, const aseba_node_registery::node_id& id, vm_language language,
-                                  std::string program, fb::CompilationOptions opts) {
+                                  std::string program, fb::CompilationOptions opts, fb::VectorLoops vector_loops) {
         auto n = get_locked_node(id);
         if(!n) {
             mLogWarn("send_aseba_code: node {} not locked", id);
@@ -492,11 +551,13 @@ private:
                 that->write_message(create_compilation_result_response(request_id, result));
             });
         };
-        if((int32_t(opts) & int32_t(fb::CompilationOptions::LoadOnTarget))) {
-            n->compile_and_send_program(language, program, callback);
-        } else {
-            n->compile_program(language, program, callback);
-        }
+        boost::asio::post(n->strand(), [n, language, program = std::move(program), opts, vector_loops, callback]() {
+            if((int32_t(opts) & int32_t(fb::CompilationOptions::LoadOnTarget))) {
+                n->compile_and_send_program(language, program, vector_loops, callback);
+            } else {
+                n->compile_program(language, program, vector_loops, callback);
+            }
+        });
     }
 
     void set_vm_execution_state(uint32_t request_id, aseba_node_registery::node_id id,
@@ -512,7 +573,9 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        n->set_vm_execution_state(cmd, create_device_write_completion_cb(request_id));
+        boost::asio::post(n->strand(), [n, cmd, cb = create_device_write_completion_cb(request_id)]() mutable {
+            n->set_vm_execution_state(cmd, std::move(cb));
+        });
     }
 
     void set_breakpoints(uint32_t request_id, aseba_node_registery::node_id id, std::vector<breakpoint> breakpoints) {
@@ -533,22 +596,27 @@ private:
             });
         };
 
-        n->set_breakpoints(breakpoints, callback);
+        boost::asio::post(n->strand(), [n, breakpoints = std::move(breakpoints), callback]() {
+            n->set_breakpoints(breakpoints, callback);
+        });
     }
 
-    void watch_node(uint32_t request_id, const aseba_node_registery::node_id& id, uint32_t flags) {
+    void watch_node(uint32_t request_id, const aseba_node_registery::node_id& id, uint32_t flags,
+                    std::chrono::milliseconds variables_update_period) {
         auto node = registery().node_from_id(id);
         if(!node) {
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
+        bool send_variables = false;
+        boost::signals2::connection variables_watcher;
         if(flags & uint32_t(fb::WatchableInfo::Variables)) {
-            if(!m_watch_nodes[fb::WatchableInfo::Variables].count(id)) {
-                auto variables = node->variables();
-                this->node_variables_changed(node, variables);
-            }
-            m_watch_nodes[fb::WatchableInfo::Variables][id] = node->connect_to_variables_changes(std::bind(
-                &application_endpoint::node_variables_changed, this, std::placeholders::_1, std::placeholders::_2));
+            send_variables = !m_watch_nodes[fb::WatchableInfo::Variables].count(id);
+            auto& connection = m_watch_nodes[fb::WatchableInfo::Variables][id];
+            if(send_variables)
+                connection = node->connect_to_variables_changes(std::bind(
+                    &application_endpoint::node_variables_changed, this, std::placeholders::_1, std::placeholders::_2));
+            variables_watcher = connection;
         } else {
             m_watch_nodes[fb::WatchableInfo::Variables].erase(id);
         }
@@ -556,7 +624,6 @@ private:
         if(flags & uint32_t(fb::WatchableInfo::Events)) {
             m_watch_nodes[fb::WatchableInfo::Events][id] = node->connect_to_events(std::bind(
                 &application_endpoint::node_emitted_events, this, std::placeholders::_1, std::placeholders::_2));
-            this->node_emitted_events(node, node->events_description());
         } else {
             m_watch_nodes[fb::WatchableInfo::Events].erase(id);
         }
@@ -565,14 +632,27 @@ private:
             m_watch_nodes[fb::WatchableInfo::VMExecutionState][id] =
                 node->connect_to_execution_state_changes(std::bind(&application_endpoint::node_execution_state_changed,
                                                                    this, std::placeholders::_1, std::placeholders::_2));
-            this->node_execution_state_changed(node, node->execution_state());
-
         } else {
             m_watch_nodes[fb::WatchableInfo::VMExecutionState].erase(id);
         }
 
-
-        write_message(create_ack_response(request_id));
+        // Read the current state of the node on its strand, the ack then follows it in our strand
+        boost::asio::post(node->strand(), [node, flags, send_variables, variables_watcher, variables_update_period,
+                                           request_id, ptr = weak_from_this()]() {
+            auto that = ptr.lock();
+            if(!that)
+                return;
+            if(variables_watcher.connected())
+                node->set_variables_update_period(variables_watcher, variables_update_period);
+            if(send_variables)
+                that->node_variables_changed(node, make_node_notification(node->variables()));
+            if(flags & uint32_t(fb::WatchableInfo::Events))
+                that->node_emitted_events(
+                    node, make_node_notification(aseba_node::event_changed_payload(node->events_description())));
+            if(flags & uint32_t(fb::WatchableInfo::VMExecutionState))
+                that->node_execution_state_changed(node, make_node_notification(node->execution_state()));
+            post_message(ptr, create_ack_response(request_id));
+        });
     }
 
     aseba_node_registery& registery() {
@@ -609,6 +689,20 @@ private:
         return callback;
     }
 
+    /*
+     *  Write a message from another strand, typically the strand of a node,
+     *  by posting it in the endpoint strand if the endpoint still exists.
+     */
+    static void post_message(std::weak_ptr<application_endpoint<Socket>> ptr, tagged_detached_flatbuffer&& buffer) {
+        auto that = ptr.lock();
+        if(!that)
+            return;
+        auto strand = that->m_strand;
+        boost::asio::post(strand, [that = std::move(that), buffer = std::move(buffer)]() mutable {
+            that->write_message(std::move(buffer));
+        });
+    }
+
     void handle_handshake(boost::system::error_code ec, fb_message_ptr&& msg) {
         if(ec) {
             mLogError("Network error while reading TDM message {}", ec.message());
@@ -657,7 +751,7 @@ private:
     }
 
     boost::asio::io_context& m_ctx;
-    std::queue<tagged_detached_flatbuffer> m_queue;
+    app_outbound_queue m_queue;
     std::unordered_map<aseba_node_registery::node_id, std::weak_ptr<aseba_node>, boost::hash<boost::uuids::uuid>>
         m_locked_nodes;
     std::unordered_map<fb::WatchableInfo,
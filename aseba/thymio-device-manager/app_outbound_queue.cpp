@@ -0,0 +1,91 @@
+#include "app_outbound_queue.h"
+#include "log.h"
+#include <algorithm>
+
+namespace mobsya {
+
+std::optional<app_outbound_queue::policy> app_outbound_queue::policy_from_string(const std::string& str) {
+    if(str == "coalesce")
+        return policy::coalesce;
+    if(str == "drop")
+        return policy::drop_oldest;
+    if(str == "disconnect")
+        return policy::disconnect;
+    return {};
+}
+
+bool app_outbound_queue::push(buffer_ptr buffer, const std::optional<node_id>& node) {
+    m_size += buffer->buffer.size();
+    m_entries.push_back({std::move(buffer), node});
+    m_stats.max_size = std::max(m_stats.max_size, m_size);
+    if(m_size <= m_limits.max_size)
+        return true;
+
+    if(!m_overflowing) {
+        mLogWarn("Application too slow: {} bytes waiting to be sent", m_size);
+        m_overflowing = true;
+    }
+    auto is_variables = [](const entry& e) { return e.buffer->tag == fb::AnyMessage::NodeVariablesChanged; };
+    auto is_events = [](const entry& e) { return e.buffer->tag == fb::AnyMessage::EventsEmitted; };
+    switch(m_limits.slow_consumer_policy) {
+        case policy::disconnect: return false;
+        case policy::drop_oldest:
+            remove_while_over_limit([&](const entry& e) {
+                if(!is_variables(e) && !is_events(e))
+                    return false;
+                m_stats.dropped++;
+                return true;
+            });
+            break;
+        case policy::coalesce:
+            remove_while_over_limit([&](const entry& e) {
+                if(!is_variables(e) || !e.node)
+                    return false;
+                m_nodes_to_resync.insert(*e.node);
+                m_stats.coalesced++;
+                return true;
+            });
+            remove_while_over_limit([&](const entry& e) {
+                if(!is_events(e))
+                    return false;
+                m_stats.dropped++;
+                return true;
+            });
+            break;
+    }
+    return true;
+}
+
+template <typename Pred>
+void app_outbound_queue::remove_while_over_limit(Pred&& pred) {
+    // The first entry is being written
+    for(auto it = std::next(m_entries.begin()); it != m_entries.end() && m_size > m_limits.max_size;) {
+        if(pred(*it)) {
+            m_size -= it->buffer->buffer.size();
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void app_outbound_queue::pop() {
+    m_size -= m_entries.front().buffer->buffer.size();
+    m_entries.pop_front();
+    if(m_overflowing && m_size <= m_limits.max_size / 2) {
+        mLogInfo("Application caught up: {} messages dropped, {} variables updates coalesced so far", m_stats.dropped,
+                 m_stats.coalesced);
+        m_overflowing = false;
+    }
+}
+
+std::vector<node_id> app_outbound_queue::take_nodes_to_resync() {
+    std::vector<node_id> nodes;
+    if(m_overflowing)
+        return nodes;
+    nodes.assign(m_nodes_to_resync.begin(), m_nodes_to_resync.end());
+    m_nodes_to_resync.clear();
+    return nodes;
+}
+
+}  // namespace mobsya
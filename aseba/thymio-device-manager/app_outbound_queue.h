@@ -0,0 +1,93 @@
+#pragma once
+#include <aseba/flatbuffers/fb_message_ptr.h>
+#include "node_id.h"
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace mobsya {
+
+/*
+ *  Messages waiting to be sent to an application, the first one being the one written.
+ *  The size of the queue is bounded, so that a client not reading its messages (a browser tab in the background,
+ *  for example) does not make the memory grow without limit.
+ *  Past the limit, notifications are coalesced or dropped according to the policy;
+ *  responses to requests are never dropped.
+ */
+class app_outbound_queue {
+public:
+    using buffer_ptr = std::shared_ptr<const tagged_detached_flatbuffer>;
+
+    enum class policy {
+        // Replace the variables updates of a node by a single update of all its variables, sent once the
+        // queue drained, then drop the oldest events
+        coalesce,
+        // Drop the oldest variables updates and events
+        drop_oldest,
+        // Close the connection
+        disconnect
+    };
+    static std::optional<policy> policy_from_string(const std::string& str);
+
+    struct limits {
+        // In bytes
+        std::size_t max_size = 4 * 1024 * 1024;
+        policy slow_consumer_policy = policy::coalesce;
+    };
+
+    struct statistics {
+        std::size_t dropped = 0;
+        std::size_t coalesced = 0;
+        std::size_t max_size = 0;
+    };
+
+    void set_limits(const limits& l) {
+        m_limits = l;
+    }
+
+    /*
+     *  Queue buffer, node being the node whose variables changed for variables updates.
+     *  Returns false if the application should be disconnected.
+     */
+    bool push(buffer_ptr buffer, const std::optional<node_id>& node = {});
+    void pop();
+
+    bool empty() const {
+        return m_entries.empty();
+    }
+    const tagged_detached_flatbuffer& front() const {
+        return *m_entries.front().buffer;
+    }
+    // Size of the queued messages, in bytes
+    std::size_t size() const {
+        return m_size;
+    }
+
+    // Nodes whose variables updates were coalesced, to be sent in full once the queue has room again
+    std::vector<node_id> take_nodes_to_resync();
+
+    const statistics& stats() const {
+        return m_stats;
+    }
+
+private:
+    struct entry {
+        buffer_ptr buffer;
+        std::optional<node_id> node;
+    };
+    // Remove the entries after the first one matching pred, until the queue fits in its limit
+    template <typename Pred>
+    void remove_while_over_limit(Pred&& pred);
+
+    std::deque<entry> m_entries;
+    std::size_t m_size = 0;
+    limits m_limits;
+    statistics m_stats;
+    std::unordered_set<node_id> m_nodes_to_resync;
+    bool m_overflowing = false;
+};
+
+}  // namespace mobsya
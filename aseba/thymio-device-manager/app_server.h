@@ -23,8 +23,14 @@ public:
         return m_acceptor.local_endpoint();
     }
 
+    // Limits of the queue of messages to send to each application
+    void set_outbound_queue_limits(const app_outbound_queue::limits& limits) {
+        m_outbound_queue_limits = limits;
+    }
+
     void accept() {
         auto endpoint = std::make_shared<application_endpoint<socket_type>>(m_acceptor.get_io_context());
+        endpoint->set_outbound_queue_limits(m_outbound_queue_limits);
         m_acceptor.async_accept(endpoint->tcp_socket(), [this, endpoint](const boost::system::error_code& error) {
             mLogInfo("New connection from {} {}", endpoint->tcp_socket().remote_endpoint().address().to_string(),
                      error.message());
@@ -38,5 +44,6 @@ public:
 
 private:
     tcp::acceptor m_acceptor;
+    app_outbound_queue::limits m_outbound_queue_limits;
 };
 }  // namespace mobsya
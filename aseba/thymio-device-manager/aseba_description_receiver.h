@@ -11,13 +11,14 @@ using read_description_message_op_cb_t = void(boost::system::error_code, uint16_
 
 template <class AsyncReadStream, class CompletionToken>
 BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, read_aseba_message_op_cb_t)
-async_read_aseba_description_message(AsyncReadStream& stream, uint16_t node, CompletionToken&& token) {
+async_read_aseba_description_message(AsyncReadStream& stream, aseba_message_reader& reader, uint16_t node,
+                                     CompletionToken&& token) {
     static_assert(boost::beast::is_async_read_stream<AsyncReadStream>::value, "AsyncReadStream requirements not met");
 
     boost::asio::async_completion<CompletionToken, read_description_message_op_cb_t> init{token};
     read_aseba_description_message_op<AsyncReadStream,
                                       BOOST_ASIO_HANDLER_TYPE(CompletionToken, read_aseba_message_op_cb_t)>{
-        stream, node, std::forward<CompletionToken>(init.completion_handler)}();
+        stream, reader, node, std::forward<CompletionToken>(init.completion_handler)}();
 
     return init.result.get();
 }
@@ -27,13 +28,15 @@ template <class AsyncReadStream, class Handler>
 class read_aseba_description_message_op {
     struct state {
         AsyncReadStream& stream;
+        aseba_message_reader& reader;
         uint16_t node;
         Aseba::TargetDescription description;
         struct {
             uint16_t variables{0}, event{0}, functions{0};
         } message_counter;
 
-        explicit state(Handler const&, uint16_t node, AsyncReadStream& stream) : stream(stream), node(node) {}
+        explicit state(Handler const&, uint16_t node, AsyncReadStream& stream, aseba_message_reader& reader)
+            : stream(stream), reader(reader), node(node) {}
     };
     boost::beast::handler_ptr<state, Handler> m_p;
 
@@ -42,8 +45,9 @@ public:
     read_aseba_description_message_op(read_aseba_description_message_op const&) = default;
 
     template <class DeducedHandler, class... Args>
-    read_aseba_description_message_op(AsyncReadStream& stream, uint16_t node, DeducedHandler&& handler)
-        : m_p(std::forward<DeducedHandler>(handler), node, stream) {}
+    read_aseba_description_message_op(AsyncReadStream& stream, aseba_message_reader& reader, uint16_t node,
+                                      DeducedHandler&& handler)
+        : m_p(std::forward<DeducedHandler>(handler), node, stream, reader) {}
 
     using allocator_type = boost::asio::associated_allocator_t<Handler>;
 
@@ -60,7 +64,7 @@ public:
 
     void operator()() {
         auto& state = *m_p;
-        return mobsya::async_read_aseba_message(state.stream, std::move(*this));
+        return mobsya::async_read_aseba_message(state.stream, state.reader, std::move(*this));
     }
 
     void operator()(boost::system::error_code ec, std::shared_ptr<Aseba::Message> msg) {
@@ -78,7 +82,7 @@ public:
 
         // The node was broadcasting a message we do not care for at the moment
         if(msg->source != node) {
-            return mobsya::async_read_aseba_message(s.stream, std::move(*this));
+            return mobsya::async_read_aseba_message(s.stream, s.reader, std::move(*this));
         }
 
         const auto safe_description_update = [](auto&& description, auto& list, uint16_t& counter) {
@@ -116,7 +120,7 @@ public:
             counter.event == desc.localEvents.size() && counter.functions == desc.nativeFunctions.size();
 
         if(!ready) {
-            return mobsya::async_read_aseba_message(s.stream, std::move(*this));
+            return mobsya::async_read_aseba_message(s.stream, s.reader, std::move(*this));
         }
         Aseba::TargetDescription sd = std::move(s.description);
         m_p.invoke(ec, node, sd);
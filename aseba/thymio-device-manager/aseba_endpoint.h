@@ -2,7 +2,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
-#include <queue>
+#include <deque>
 #include <boost/asio.hpp>
 #include <chrono>
 #include "usb_utils.h"
@@ -33,7 +33,9 @@ public:
     enum class endpoint_type { unknown, thymio, simulated_thymio, simulated_dummy_node };
 
     ~aseba_endpoint() {
-        std::for_each(std::begin(m_nodes), std::end(m_nodes), [](auto&& node) { node.second.node->disconnect(); });
+        std::for_each(std::begin(m_nodes), std::end(m_nodes), [](auto&& info) {
+            boost::asio::post(info.second.node->m_strand, [node = info.second.node] { node->disconnect(); });
+        });
     }
 
     using pointer = std::shared_ptr<aseba_endpoint>;
@@ -138,14 +140,16 @@ public:
             return;
         std::unique_lock<std::mutex> _(m_msg_queue_lock);
         for(auto&& m : messages) {
-            m_msg_queue.emplace(std::move(m), write_callback{});
+            m_msg_queue.emplace_back(std::move(m), write_callback{});
         }
         if(cb) {
             m_msg_queue.back().second = std::move(cb);
         }
+        // A write is in progress, the queued messages will follow it
         if(m_msg_queue.size() > messages.size())
             return;
-        do_write_message(*(m_msg_queue.front().first));
+        // Nodes write from their own strand, but the device must only be accessed from ours
+        boost::asio::dispatch(m_strand, [that = shared_from_this()] { that->do_write_messages(); });
     }
 
     template <typename CB = write_callback>
@@ -160,7 +164,9 @@ public:
             [that](boost::system::error_code ec, std::shared_ptr<Aseba::Message> msg) { that->handle_read(ec, msg); });
 
         variant_ns::visit(
-            [&cb](auto& underlying) { return mobsya::async_read_aseba_message(underlying, std::move(cb)); },
+            [this, &cb](auto& underlying) {
+                return mobsya::async_read_aseba_message(underlying, m_reader, std::move(cb));
+            },
             m_endpoint);
     }
 
@@ -187,7 +193,7 @@ public:
             it->second.last_seen = std::chrono::steady_clock::now();
 
         } else if(node) {
-            node->on_message(*msg);
+            boost::asio::post(node->m_strand, [node, msg] { node->on_message(*msg); });
         }
         read_aseba_message();
     }
@@ -287,47 +293,72 @@ private:
                 }
                 auto node = that->find_node(id);
                 that->read_aseba_message();
-                node->on_description(msg);
+                if(node) {
+                    boost::asio::post(node->m_strand,
+                                      [node, msg = std::move(msg)]() mutable { node->on_description(std::move(msg)); });
+                }
             });
 
         mLogInfo("Asking for description of node {}", node);
         write_message(std::make_unique<Aseba::GetNodeDescription>(node));
 
         variant_ns::visit(
-            [&cb, &node](auto& underlying) {
-                return mobsya::async_read_aseba_description_message(underlying, node, std::move(cb));
+            [this, &cb, &node](auto& underlying) {
+                return mobsya::async_read_aseba_description_message(underlying, m_reader, node, std::move(cb));
             },
             m_endpoint);
     }
 
-    void do_write_message(const Aseba::Message& message) {
+    // Maximum number of bytes sent in a single write.
+    // The wireless dongle forwards what it receives over the radio, do not send it more than an Aseba packet at once
+    std::size_t max_write_size() const {
+        return is_wireless() ? ASEBA_MAX_OUTER_PACKET_SIZE : 16 * 1024;
+    }
+
+    // Write as many queued messages as possible at once, each one still completing individually
+    void do_write_messages() {
+        {
+            std::unique_lock<std::mutex> _(m_msg_queue_lock);
+            m_write_buffer.rawData.clear();
+            m_write_batch_size =
+                serialize_aseba_messages(m_msg_queue.begin(), m_msg_queue.end(), max_write_size(), m_write_buffer,
+                                         [](const auto& message) -> const Aseba::Message& { return *message.first; });
+        }
         auto that = shared_from_this();
-        auto cb =
-            boost::asio::bind_executor(m_strand, [that](boost::system::error_code ec) { that->handle_write(ec); });
+        auto cb = boost::asio::bind_executor(
+            m_strand, [that](boost::system::error_code ec, std::size_t) { that->handle_write(ec); });
 
         variant_ns::visit(
-            [&cb, &message](auto& underlying) {
-                return mobsya::async_write_aseba_message(underlying, message, std::move(cb));
+            [this, &cb](auto& underlying) {
+                return boost::asio::async_write(
+                    underlying, boost::asio::buffer(m_write_buffer.rawData.data(), m_write_buffer.rawData.size()),
+                    std::move(cb));
             },
             m_endpoint);
     }
 
     void handle_write(boost::system::error_code ec) {
-        std::unique_lock<std::mutex> _(m_msg_queue_lock);
-        mLogDebug("Message '{}' sent : {}", m_msg_queue.front().first->message_name(), ec.message());
+        std::unique_lock<std::mutex> lock(m_msg_queue_lock);
         if(ec) {
+            mLogDebug("{} messages not sent : {}", m_write_batch_size, ec.message());
             variant_ns::visit([](auto& underlying) { underlying.cancel(); }, m_endpoint);
             m_msg_queue = {};
             return;
         }
 
-        auto cb = m_msg_queue.front().second;
-        if(cb) {
-            boost::asio::post(m_io_context.get_executor(), std::bind(std::move(cb), ec));
+        for(std::size_t i = 0; i < m_write_batch_size; i++) {
+            auto& message = m_msg_queue.front();
+            mLogDebug("Message '{}' sent", message.first->message_name());
+            if(message.second) {
+                boost::asio::post(m_io_context.get_executor(), std::bind(std::move(message.second), ec));
+            }
+            m_msg_queue.pop_front();
         }
-        m_msg_queue.pop();
-        if(!m_msg_queue.empty()) {
-            do_write_message(*(m_msg_queue.front().first));
+        m_write_batch_size = 0;
+        const bool more = !m_msg_queue.empty();
+        lock.unlock();
+        if(more) {
+            do_write_messages();
         }
     }
 
@@ -343,7 +374,12 @@ private:
     endpoint_type m_endpoint_type;
     std::string m_endpoint_name;
     std::mutex m_msg_queue_lock;
-    std::queue<std::pair<std::shared_ptr<Aseba::Message>, write_callback>> m_msg_queue;
+    std::deque<std::pair<std::shared_ptr<Aseba::Message>, write_callback>> m_msg_queue;
+    // All reads go through it, only accessed from the strand
+    aseba_message_reader m_reader;
+    // The messages being written, serialized. Only accessed from the strand
+    Aseba::Message::SerializationBuffer m_write_buffer;
+    std::size_t m_write_batch_size = 0;
 };
 
 }  // namespace mobsya
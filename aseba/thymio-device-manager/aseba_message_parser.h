@@ -3,10 +3,75 @@
 #include <boost/beast.hpp>
 #include <aseba/common/msg/msg.h>
 #include <boost/endian/arithmetic.hpp>
+#include <cstring>
 #include <iostream>
 
 namespace mobsya {
 
+/*
+ *  Holds the bytes read from a stream, so that all the messages received together are decoded
+ *  from a single read, rather than with two reads per message.
+ *  As it may hold bytes of the next messages, all the reads on a stream must go through the same reader.
+ */
+class aseba_message_reader {
+public:
+    // Decode the next complete message, nullptr if more bytes are needed
+    std::shared_ptr<Aseba::Message> next() {
+        const auto available = m_end - m_begin;
+        if(available < header_size)
+            return {};
+        const auto size = frame_size();
+        if(available < size)
+            return {};
+        const uint8_t* frame = m_data.data() + m_begin;
+        const auto source = read_uint16(frame + 2);
+        const auto type = read_uint16(frame + 4);
+        // Reusing the buffer avoids an allocation per message
+        m_payload.rawData.assign(frame + header_size, frame + size);
+        m_payload.readPos = 0;
+        m_begin += size;
+        if(m_begin == m_end)
+            m_begin = m_end = 0;
+        return std::shared_ptr<Aseba::Message>(Aseba::Message::create(source, type, m_payload));
+    }
+
+    // Free space to read into, large enough for the message being received
+    boost::asio::mutable_buffer prepare() {
+        const auto available = m_end - m_begin;
+        const auto needed = std::max(available >= header_size ? frame_size() : header_size, available + min_read_size);
+        if(m_data.size() - m_begin < needed) {
+            std::memmove(m_data.data(), m_data.data() + m_begin, available);
+            m_begin = 0;
+            m_end = available;
+            if(m_data.size() < needed)
+                m_data.resize(needed);
+        }
+        return boost::asio::buffer(m_data.data() + m_end, m_data.size() - m_end);
+    }
+
+    void commit(std::size_t bytes) {
+        m_end += bytes;
+    }
+
+private:
+    static constexpr std::size_t header_size = 6;
+    static constexpr std::size_t min_read_size = 512;
+
+    static uint16_t read_uint16(const uint8_t* data) {
+        uint16_t v;
+        std::memcpy(&v, data, sizeof(v));
+        return boost::endian::little_to_native(v);
+    }
+    std::size_t frame_size() const {
+        return header_size + read_uint16(m_data.data() + m_begin);
+    }
+
+    std::vector<uint8_t> m_data = std::vector<uint8_t>(4096);
+    std::size_t m_begin = 0;
+    std::size_t m_end = 0;
+    Aseba::Message::SerializationBuffer m_payload;
+};
+
 template <class AsyncReadStream, class Handler>
 class read_aseba_message_op;
 
@@ -14,12 +79,12 @@ using read_aseba_message_op_cb_t = void(boost::system::error_code, std::shared_p
 
 template <class AsyncReadStream, class CompletionToken>
 BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, read_aseba_message_op_cb_t)
-async_read_aseba_message(AsyncReadStream& stream, CompletionToken&& token) {
+async_read_aseba_message(AsyncReadStream& stream, aseba_message_reader& reader, CompletionToken&& token) {
     static_assert(boost::beast::is_async_read_stream<AsyncReadStream>::value, "AsyncReadStream requirements not met");
 
     boost::asio::async_completion<CompletionToken, read_aseba_message_op_cb_t> init{token};
     read_aseba_message_op<AsyncReadStream, BOOST_ASIO_HANDLER_TYPE(CompletionToken, read_aseba_message_op_cb_t)>{
-        stream, std::forward<CompletionToken>(init.completion_handler)}();
+        stream, reader, std::forward<CompletionToken>(init.completion_handler)}();
 
     return init.result.get();
 }
@@ -29,13 +94,10 @@ template <class AsyncReadStream, class Handler>
 class read_aseba_message_op {
     struct state {
         AsyncReadStream& stream;
-        uint16_t size = 0;
-        uint16_t source = 0;
-        uint16_t type = 0;
-        char headerBuffer[6];
-        Aseba::Message::SerializationBuffer dataBuffer;
+        aseba_message_reader& reader;
 
-        explicit state(Handler const& handler, AsyncReadStream& stream) : stream(stream) {}
+        explicit state(Handler const& handler, AsyncReadStream& stream, aseba_message_reader& reader)
+            : stream(stream), reader(reader) {}
     };
     boost::beast::handler_ptr<state, Handler> m_p;
 
@@ -44,8 +106,8 @@ public:
     read_aseba_message_op(read_aseba_message_op const&) = default;
 
     template <class DeducedHandler, class... Args>
-    read_aseba_message_op(AsyncReadStream& stream, DeducedHandler&& handler)
-        : m_p(std::forward<DeducedHandler>(handler), stream) {}
+    read_aseba_message_op(AsyncReadStream& stream, aseba_message_reader& reader, DeducedHandler&& handler)
+        : m_p(std::forward<DeducedHandler>(handler), stream, reader) {}
 
     using allocator_type = boost::asio::associated_allocator_t<Handler>;
 
@@ -62,39 +124,29 @@ public:
 
     void operator()() {
         auto& state = *m_p;
-        return boost::asio::async_read(state.stream, boost::asio::buffer(state.headerBuffer),
-                                       boost::asio::transfer_exactly(6), std::move(*this));
+        // A message was received with the previous ones, complete without reading,
+        // but not from within the initiating function
+        if(auto msg = state.reader.next()) {
+            auto executor = get_executor();
+            return boost::asio::post(executor, [op = std::move(*this), msg = std::move(msg)]() mutable {
+                op.m_p.invoke(boost::system::error_code{}, std::move(msg));
+            });
+        }
+        state.stream.async_read_some(state.reader.prepare(), std::move(*this));
     }
 
     void operator()(boost::system::error_code ec, std::size_t bytes_transferred) {
         auto& state = *m_p;
-        if(!ec && bytes_transferred == 0)
-            return state.size == 0 ?
-                boost::asio::async_read(state.stream, boost::asio::buffer(state.headerBuffer),
-                                        boost::asio::transfer_exactly(6), std::move(*this)) :
-                boost::asio::async_read(state.stream, boost::asio::buffer(state.dataBuffer.rawData),
-                                        boost::asio::transfer_exactly(state.size), std::move(*this));
-
-        if(!ec && state.size == 0) {
-            assert(bytes_transferred == 6);
-            state.size = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer));
-            state.source = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer + 2));
-            state.type = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer + 4));
-            state.dataBuffer.rawData.resize(state.size);
-            if(state.size != 0)
-                return boost::asio::async_read(state.stream, boost::asio::buffer(state.dataBuffer.rawData),
-                                               boost::asio::transfer_exactly(state.size), std::move(*this));
-            // support empty messages
-            bytes_transferred = 0;
+        if(ec) {
+            m_p.invoke(ec, std::shared_ptr<Aseba::Message>{});
+            return;
         }
-        if(!ec && bytes_transferred == state.size) {
-            Aseba::Message::SerializationBuffer& b = state.dataBuffer;
-            auto msg =
-                std::shared_ptr<Aseba::Message>(Aseba::Message::create(state.source, state.type, state.dataBuffer));
+        state.reader.commit(bytes_transferred);
+        if(auto msg = state.reader.next()) {
             m_p.invoke(ec, std::move(msg));
             return;
         }
-        m_p.invoke(ec, std::shared_ptr<Aseba::Message>{});
+        state.stream.async_read_some(state.reader.prepare(), std::move(*this));
     }
 };
 }  // namespace mobsya
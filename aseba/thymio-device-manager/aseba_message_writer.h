@@ -3,6 +3,7 @@
 #include <boost/beast.hpp>
 #include <aseba/common/msg/msg.h>
 #include <boost/endian/arithmetic.hpp>
+#include <cstring>
 #include <iostream>
 
 namespace mobsya {
@@ -10,6 +11,41 @@ namespace mobsya {
 template <class AsyncWriteStream, class Handler>
 class write_aseba_message_op;
 
+/*
+ *  Append msg to buffer, framed as it is sent on the wire
+ */
+inline void serialize_aseba_message(const Aseba::Message& msg, Aseba::Message::SerializationBuffer& buffer) {
+    const auto start = buffer.rawData.size();
+    buffer.add(uint16_t{0});
+    buffer.add(msg.source);
+    buffer.add(msg.type);
+    msg.serializeSpecific(buffer);
+    const uint16_t size =
+        boost::endian::native_to_little(static_cast<uint16_t>(buffer.rawData.size() - start - 6));
+    std::memcpy(buffer.rawData.data() + start, &size, sizeof(size));
+}
+
+/*
+ *  Append to buffer, in order, the messages of [first, last) as long as buffer fits in max_size bytes,
+ *  message_of returning the message of an element. The first message is always appended, whatever its size.
+ *  Returns the number of messages appended
+ */
+template <typename Iterator, typename MessageOf>
+std::size_t serialize_aseba_messages(Iterator first, Iterator last, std::size_t max_size,
+                                     Aseba::Message::SerializationBuffer& buffer, MessageOf&& message_of) {
+    std::size_t count = 0;
+    for(; first != last; ++first) {
+        const auto size = buffer.rawData.size();
+        serialize_aseba_message(message_of(*first), buffer);
+        if(count > 0 && buffer.rawData.size() > max_size) {
+            buffer.rawData.resize(size);
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
 
 using write_aseba_message_op_cb_t = void(boost::system::error_code, std::shared_ptr<Aseba::Message>);
 
@@ -34,12 +70,7 @@ class write_aseba_message_op {
         Aseba::Message::SerializationBuffer buffer;
 
         explicit state(Handler const&, AsyncWriteStream& stream, const Aseba::Message& msg) : stream(stream) {
-            buffer.add(uint16_t{0});
-            buffer.add(msg.source);
-            buffer.add(msg.type);
-            msg.serializeSpecific(buffer);
-            uint16_t& size = *(reinterpret_cast<uint16_t*>(buffer.rawData.data()));
-            size = boost::endian::native_to_little(static_cast<uint16_t>(buffer.rawData.size()) - 6);
+            serialize_aseba_message(msg, buffer);
         }
     };
     boost::beast::handler_ptr<state, Handler> m_p;
@@ -1,10 +1,13 @@
 #include "aseba_node.h"
 #include "aseba_endpoint.h"
 #include "aseba_node_registery.h"
+#include "compilation_cache.h"
+#include "compilation_service.h"
 #include <aseba/common/utils/utils.h>
 #include <aseba/compiler/compiler.h>
 #include <fmt/format.h>
 #include "aesl_parser.h"
+#include <optional>
 
 namespace mobsya {
 
@@ -17,6 +20,14 @@ namespace detail {
             return property();
         return property(property::list::from_range(std::forward<Rng>(rng)));
     }
+
+    static Aseba::Compiler::VectorLoops compiler_vector_loops(fb::VectorLoops vector_loops) {
+        switch(vector_loops) {
+            case fb::VectorLoops::Never: return Aseba::Compiler::VectorLoops::NEVER;
+            case fb::VectorLoops::Always: return Aseba::Compiler::VectorLoops::ALWAYS;
+            default: return Aseba::Compiler::VectorLoops::WHEN_SMALLER;
+        }
+    }
 }  // namespace detail
 
 const std::string& aseba_node::status_to_string(aseba_node::status s) {
@@ -35,6 +46,8 @@ aseba_node::aseba_node(boost::asio::io_context& ctx, node_id_t id, std::weak_ptr
     , m_connected_app(nullptr)
     , m_endpoint(std::move(endpoint))
     , m_io_ctx(ctx)
+    , m_strand(ctx.get_executor())
+    , m_incremental_compiler(std::make_shared<incremental_compiler>())
     , m_variables_timer(ctx) {}
 
 std::shared_ptr<aseba_node> aseba_node::create(boost::asio::io_context& ctx, node_id_t id,
@@ -116,19 +129,20 @@ bool aseba_node::lock(void* app) {
     if(m_connected_app == app) {
         return true;
     }
-    if(m_connected_app != nullptr || m_status != status::available) {
+    // Several applications may try to lock the node at the same time from different threads
+    void* expected = nullptr;
+    if(m_status != status::available || !m_connected_app.compare_exchange_strong(expected, app)) {
         return false;
     }
-    m_connected_app = app;
     set_status(status::busy);
     return true;
 }
 
 bool aseba_node::unlock(void* app) {
-    if(m_connected_app != app) {
+    void* expected = app;
+    if(!m_connected_app.compare_exchange_strong(expected, nullptr)) {
         return false;
     }
-    m_connected_app = nullptr;
     mLogDebug("Unlocking node");
     set_status(status::available);
     return true;
@@ -147,56 +161,116 @@ void aseba_node::write_messages(std::vector<std::shared_ptr<Aseba::Message>>&& m
 }
 
 void aseba_node::compile_program(fb::ProgrammingLanguage language, const std::string& program,
-                                 compilation_callback&& cb) {
-    Aseba::CommonDefinitions defs = m_defs;
-    Aseba::TargetDescription desc = m_description;
-
-    Aseba::Compiler compiler;
-    compiler.setTargetDescription(&desc);
-    compiler.setCommonDefinitions(&defs);
-
-
-    Aseba::BytecodeVector bytecode;
-    auto result = do_compile_program(compiler, defs, language, program, bytecode);
-    if(!result)
-        boost::asio::post(m_io_ctx.get_executor(), std::bind(std::move(cb), result.error(), compilation_result{}));
-    else
-        boost::asio::post(m_io_ctx.get_executor(),
-                          std::bind(std::move(cb), boost::system::error_code{}, result.value()));
+                                 fb::VectorLoops vector_loops, compilation_callback&& cb) {
+    auto job = std::make_shared<compilation_job>(m_description, m_defs, language, program, vector_loops);
+    compile_async(std::move(job), [cb = std::move(cb)](std::shared_ptr<compilation_job> job) {
+        const auto& result = job->output->result;
+        if(!result)
+            cb(result.error(), compilation_result{});
+        else
+            cb(boost::system::error_code{}, result.value());
+    });
 }
 
 void aseba_node::compile_and_send_program(fb::ProgrammingLanguage language, const std::string& program,
-                                          compilation_callback&& cb) {
+                                          fb::VectorLoops vector_loops, compilation_callback&& cb) {
     m_breakpoints.clear();
     cancel_pending_step_request();
     cancel_pending_breakpoint_request();
-    Aseba::Compiler compiler;
-    compiler.setTargetDescription(&m_description);
-    compiler.setCommonDefinitions(&m_defs);
-    auto result = do_compile_program(compiler, m_defs, language, program, m_bytecode);
-    if(!result) {
-        cb(result.error(), {});
+    auto job = std::make_shared<compilation_job>(m_description, m_defs, language, program, vector_loops);
+    const auto generation = ++m_program_generation;
+    compile_async(std::move(job), [that = shared_from_this(), generation,
+                                   cb = std::move(cb)](std::shared_ptr<compilation_job> job) mutable {
+        // Another program was sent while this one was compiling
+        if(generation != that->m_program_generation) {
+            cb(boost::system::errc::make_error_code(boost::system::errc::operation_canceled), {});
+            return;
+        }
+        that->send_compiled_program(*job, std::move(cb));
+    });
+}
+
+void aseba_node::compile_async(std::shared_ptr<compilation_job> job, compilation_job_callback&& cb) {
+    auto& cache = boost::asio::use_service<compilation_cache>(m_io_ctx);
+    job->key =
+        compilation_cache::make_key(job->description, job->defs, job->language, job->vector_loops, job->program);
+    auto completion = [job, cb]() { cb(job); };
+
+    bool compile = false;
+    auto cached = cache.find(job->key,
+                             [job, completion, strand = m_strand](compilation_cache::program_ptr program) {
+                                 job->output = std::move(program);
+                                 boost::asio::post(strand, completion);
+                             },
+                             compile);
+    if(cached) {
+        job->output = std::move(cached);
+        boost::asio::post(m_strand, completion);
+        return;
+    }
+    // An identical program is being compiled, the waiter will complete the job
+    if(!compile)
         return;
+
+    auto& service = boost::asio::use_service<compilation_service>(m_io_ctx);
+    auto compile_job = [that = shared_from_this(), job, &cache, incremental = m_incremental_compiler]() {
+        auto program = std::make_shared<compiled_program>();
+        program->defs = job->defs;
+        std::unique_lock<std::mutex> lock(incremental->mutex, std::try_to_lock);
+        std::optional<Aseba::Compiler> own_compiler;
+        if(!lock.owns_lock())
+            own_compiler.emplace();
+        Aseba::Compiler& compiler = lock.owns_lock() ? incremental->compiler : *own_compiler;
+        compiler.setTargetDescription(&job->description);
+        compiler.setCommonDefinitions(&program->defs);
+        compiler.setVectorLoops(detail::compiler_vector_loops(job->vector_loops));
+        program->result =
+            that->do_compile_program(compiler, program->defs, job->language, job->program, program->bytecode);
+        program->variables = *compiler.getVariablesMap();
+        if(compiler.getIncrementalCompilation())
+            mLogTrace("Compiled program for node {}, reusing {} events and subroutines", that->native_id(),
+                      compiler.getReusedBlocksCount());
+        job->output = program;
+        cache.insert(job->key, std::move(program));
+    };
+    if(!service.post(std::move(compile_job), m_strand, completion)) {
+        auto program = std::make_shared<compiled_program>();
+        program->result = make_unexpected(error_code::too_many_compilations);
+        job->output = program;
+        // Do not keep the rejection, the next lookup will try again
+        cache.abandon(job->key, std::move(program));
+        boost::asio::post(m_strand, completion);
     }
+}
+
+void aseba_node::send_compiled_program(compilation_job& job, compilation_callback&& cb) {
+    const auto& program = *job.output;
+    if(!program.result) {
+        cb(program.result.error(), {});
+        return;
+    }
+    auto result = program.result;
+    m_defs = program.defs;
+    m_bytecode = program.bytecode;
     std::vector<std::shared_ptr<Aseba::Message>> messages;
     Aseba::sendBytecode(messages, native_id(), std::vector<uint16_t>(m_bytecode.begin(), m_bytecode.end()));
-    reset_known_variables(*compiler.getVariablesMap());
+    reset_known_variables(program.variables);
     write_messages(std::move(messages),
-                   [that = shared_from_this(), cb = std::move(cb), result](boost::system::error_code ec) {
+                   on_strand([that = shared_from_this(), cb = std::move(cb), result](boost::system::error_code ec) {
                        if(ec)
                            cb(ec, result.value());
                        else
                            that->m_callbacks_pending_execution_state_change.push(std::bind(cb, ec, result.value()));
-                   });
+                   }));
 
     send_events_table();
-    m_variables_changed_signal(shared_from_this(), this->variables());
+    m_variables_changed_signal(shared_from_this(), make_node_notification(this->variables()));
 }
 
 tl::expected<aseba_node::compilation_result, boost::system::error_code>
 aseba_node::do_compile_program(Aseba::Compiler& compiler, Aseba::CommonDefinitions& defs,
                                fb::ProgrammingLanguage language, const std::string& program,
-                               Aseba::BytecodeVector& bytecode) {
+                               Aseba::BytecodeVector& bytecode) const {
     std::wstring code;
 
     if(language == fb::ProgrammingLanguage::Aesl) {
@@ -312,7 +386,7 @@ void aseba_node::on_execution_state_message(const Aseba::ExecutionStateChanged&
     if(m_pending_step_request)
         return;
 
-    m_vm_state_watch_signal(shared_from_this(), state);
+    m_vm_state_watch_signal(shared_from_this(), make_node_notification(state));
 }
 
 void aseba_node::on_vm_runtime_error(const Aseba::Message& msg) {
@@ -349,7 +423,7 @@ void aseba_node::on_vm_runtime_error(const Aseba::Message& msg) {
     state.state = m_vm_state.state;
     state.line = m_vm_state.line;
 
-    m_vm_state_watch_signal(shared_from_this(), state);
+    m_vm_state_watch_signal(shared_from_this(), make_node_notification(state));
 }
 
 unsigned aseba_node::line_from_pc(unsigned pc) const {
@@ -389,7 +463,7 @@ void aseba_node::handle_step_request() {
         data->error = ec;
         that->cancel_pending_step_request();
     };
-    write_message(std::make_shared<Aseba::Step>(native_id()), std::move(write_cb));
+    write_message(std::make_shared<Aseba::Step>(native_id()), on_strand(std::move(write_cb)));
 };
 
 void aseba_node::cancel_pending_step_request() {
@@ -462,7 +536,7 @@ void aseba_node::set_breakpoints(std::vector<breakpoint> breakpoints, breakpoint
         m_pending_breakpoint_request.reset();
         boost::asio::post(m_io_ctx.get_executor(), std::bind(std::move(cb_data->cb), cb_data->error, cb_data->set));
     }
-    write_messages(std::move(messages), std::move(write_cb));
+    write_messages(std::move(messages), on_strand(std::move(write_cb)));
 }
 
 void aseba_node::on_breakpoint_set_result(const Aseba::BreakpointSetResult& res) {
@@ -507,7 +581,7 @@ aseba_node::vm_execution_state aseba_node::execution_state() const {
 }
 
 void aseba_node::send_events_table() {
-    m_events_signal(shared_from_this(), events_description());
+    m_events_signal(shared_from_this(), make_node_notification(event_changed_payload(events_description())));
 }
 
 static tl::expected<std::vector<int16_t>, boost::system::error_code> to_aseba_variable(const property& p,
@@ -569,12 +643,11 @@ boost::system::error_code aseba_node::set_node_variables(const aseba_node::varia
                 return make_error_code(error_code::incompatible_variable_type);
             }
 
-            auto it = std::find_if(m_variables.begin(), m_variables.end(),
-                                   [name = var.first](const aseba_vm_variable& v) { return v.name == name; });
-            if(it == std::end(m_variables)) {
+            const auto object_ptr = m_variables.find(var.first);
+            if(!object_ptr) {
                 return make_error_code(error_code::no_such_variable);
             }
-            const auto& object = *it;
+            const auto& object = *object_ptr;
             auto bytes = to_aseba_variable(var.second, object.size);
             if(!bytes) {
                 return bytes.error();
@@ -585,7 +658,7 @@ boost::system::error_code aseba_node::set_node_variables(const aseba_node::varia
     }
     write_messages(std::move(messages), std::move(cb));
     if(!modified.empty()) {
-        m_variables_changed_signal(shared_from_this(), modified);
+        m_variables_changed_signal(shared_from_this(), make_node_notification(std::move(modified)));
     }
     return {};
 }
@@ -633,7 +706,9 @@ void aseba_node::on_description(Aseba::TargetDescription description) {
              description.namedVariables.size(), description.nativeFunctions.size(), description.localEvents.size(),
              description.protocolVersion);
     {
+        std::unique_lock<std::mutex> lock(m_info_mutex);
         m_description = std::move(description);
+        lock.unlock();
         unsigned count;
         reset_known_variables(m_description.getVariablesMap(count));
         schedule_variables_update();
@@ -675,70 +750,41 @@ void aseba_node::request_variables() {
             m_resend_all_variables = false;
         }
     }
+    m_variables_schedule.requested(messages.size());
     write_messages(std::move(messages));
 }
 
 void aseba_node::reset_known_variables(const Aseba::VariablesMap& variables) {
-    m_variables.clear();
-    for(const auto& var : variables) {
-        const auto name = Aseba::WStringToUTF8(var.first);
-        const auto start = var.second.first;
-        const auto size = var.second.second;
-        auto insert_point =
-            std::lower_bound(m_variables.begin(), m_variables.end(), start,
-                             [](const aseba_vm_variable& v, unsigned start) { return v.start < start; });
-        if(insert_point == m_variables.end() || insert_point->start != start) {
-            m_variables.emplace(insert_point, name, start, size);
-        }
-    }
+    m_variables.reset(variables);
     m_resend_all_variables = true;
 }
 
 void aseba_node::on_variables_message(const Aseba::Variables& msg) {
-    std::unordered_map<std::string, variable> changed;
-    set_variables(msg.start, msg.variables, changed);
-    m_variables_changed_signal(shared_from_this(), changed);
+    m_variables.set(msg.start, msg.variables);
+    auto changed = take_changed_variables();
+    m_variables_schedule.received(!changed.empty());
+    m_variables_changed_signal(shared_from_this(), make_node_notification(std::move(changed)));
 }
 
 void aseba_node::on_variables_message(const Aseba::ChangedVariables& msg) {
-    std::unordered_map<std::string, variable> changed;
     for(const auto& area : msg.variables) {
-        set_variables(area.start, area.variables, changed);
+        m_variables.set(area.start, area.variables);
     }
-    m_variables_changed_signal(shared_from_this(), changed);
+    auto changed = take_changed_variables();
+    m_variables_schedule.received(!changed.empty());
+    m_variables_changed_signal(shared_from_this(), make_node_notification(std::move(changed)));
 }
 
-void aseba_node::set_variables(uint16_t start, const std::vector<int16_t>& data,
-                               std::unordered_map<std::string, variable>& vars) {
-
-    auto data_it = std::begin(data);
-    auto it = m_variables.begin();
-    while(data_it != std::end(data)) {
-        it = std::find_if(it, m_variables.end(), [start](const aseba_vm_variable& var) {
-            return start >= var.start && start < var.start + var.size;
-        });
-        if(it == std::end(m_variables))
-            return;
-        auto& var = *it;
-        const auto var_start = start - var.start;
-        bool force_change = var.size != var.value.size();
-        var.value.resize(var.size, 0);
-        const auto count = std::min(std::ptrdiff_t(var.size - var_start), std::distance(data_it, std::end(data)));
-        if(count < 0)
-            break;
-        if(force_change ||
-           !std::equal(std::begin(var.value) + var_start, std::begin(var.value) + var_start + count, data_it,
-                       data_it + count)) {
-            std::copy(data_it, data_it + count, std::begin(var.value) + var_start);
-            vars.insert(std::pair{var.name, detail::aseba_variable_from_range(var.value)});
-            mLogTrace("Variable changed {} : {}", var.name, detail::aseba_variable_from_range(var.value));
-        }
-        data_it = data_it + count;
-        start += count;
-    }
+aseba_node::variables_map aseba_node::take_changed_variables() {
+    variables_map vars;
+    m_variables.take_changed([&vars](const vm_variables::variable& var) {
+        auto value = detail::aseba_variable_from_range(var.value);
+        mLogTrace("Variable changed {} : {}", var.name, value);
+        vars.emplace(var.name, std::move(value));
+    });
+    return vars;
 }
 
-
 aseba_node::variables_map aseba_node::variables() const {
     variables_map map;
     map.reserve(m_variables.size());
@@ -751,10 +797,40 @@ aseba_node::variables_map aseba_node::variables() const {
     return map;
 }
 
+void aseba_node::set_variables_update_period(boost::signals2::connection watcher, std::chrono::milliseconds period) {
+    period = variables_update_schedule::watcher_period(period);
+    auto it = std::find_if(m_variables_watchers.begin(), m_variables_watchers.end(),
+                           [&watcher](const variables_watcher& w) { return w.connection == watcher; });
+    if(it != m_variables_watchers.end())
+        it->period = period;
+    else
+        m_variables_watchers.push_back({std::move(watcher), period});
+    m_variables_schedule.reset_backoff();
+
+    // Do not wait for a slower update already scheduled, if any
+    const auto remaining = m_variables_timer.expires_from_now();
+    if(!remaining.is_special() && remaining > boost::posix_time::milliseconds(variables_update_period().count()))
+        schedule_variables_update();
+}
+
+std::chrono::milliseconds aseba_node::variables_update_period() {
+    m_variables_watchers.erase(std::remove_if(m_variables_watchers.begin(), m_variables_watchers.end(),
+                                              [](const variables_watcher& w) { return !w.connection.connected(); }),
+                               m_variables_watchers.end());
+    // The fastest period requested, watchers that did not ask for one getting the default period
+    std::chrono::milliseconds period = std::chrono::milliseconds::max();
+    for(const auto& w : m_variables_watchers)
+        period = std::min(period, w.period);
+    if(m_variables_watchers.empty() || m_variables_changed_signal.num_slots() > m_variables_watchers.size())
+        period = std::min(period, variables_update_schedule::DEFAULT_PERIOD);
+
+    return m_variables_schedule.next_period(period);
+}
+
 void aseba_node::schedule_variables_update() {
-    m_variables_timer.expires_from_now(boost::posix_time::milliseconds(100));
+    m_variables_timer.expires_from_now(boost::posix_time::milliseconds(variables_update_period().count()));
     std::weak_ptr<aseba_node> ptr = shared_from_this();
-    m_variables_timer.async_wait([ptr](boost::system::error_code ec) {
+    m_variables_timer.async_wait(boost::asio::bind_executor(m_strand, [ptr](boost::system::error_code ec) {
         if(ec)
             return;
         auto that = ptr.lock();
@@ -762,36 +838,48 @@ void aseba_node::schedule_variables_update() {
             return;
 
         // Only ask variables if we have at least 1 watcher
-        if(!that->m_variables_changed_signal.empty())
-            that->request_variables();
+        if(!that->m_variables_changed_signal.empty()) {
+            if(!that->m_variables_schedule.should_request()) {
+                mLogTrace("Variables of {} not received yet, next update in {}ms", that->native_id(),
+                          that->variables_update_period().count());
+            } else {
+                that->request_variables();
+            }
+        }
         that->schedule_variables_update();
-    });
+    }));
 }
 
 void aseba_node::on_device_info(const Aseba::DeviceInfo& info) {
     mLogTrace("Got info for {} [{} : {}]", native_id(), info.info, info.data.size());
     if(info.info == DEVICE_INFO_UUID) {
+        node_id uuid = m_uuid;
         if(info.data.size() == 16) {
-            std::copy(info.data.begin(), info.data.end(), m_uuid.begin());
+            std::copy(info.data.begin(), info.data.end(), uuid.begin());
         }
-        if(m_uuid.is_nil()) {
-            m_uuid = boost::uuids::random_generator()();
+        if(uuid.is_nil()) {
+            uuid = boost::uuids::random_generator()();
             std::vector<uint8_t> data;
-            std::copy(m_uuid.begin(), m_uuid.end(), std::back_inserter(data));
+            std::copy(uuid.begin(), uuid.end(), std::back_inserter(data));
             write_message(std::make_shared<Aseba::SetDeviceInfo>(native_id(), DEVICE_INFO_UUID, data));
         }
-        mLogInfo("Persistent uuid for {} is now {} ", native_id(), boost::uuids::to_string(m_uuid));
+        {
+            std::unique_lock<std::mutex> _(m_info_mutex);
+            m_uuid = uuid;
+        }
+        mLogInfo("Persistent uuid for {} is now {} ", native_id(), boost::uuids::to_string(uuid));
         auto& registery = boost::asio::use_service<aseba_node_registery>(m_io_ctx);
-        registery.set_node_uuid(shared_from_this(), m_uuid);
+        registery.set_node_uuid(shared_from_this(), uuid);
         set_status(status::available);
 
     } else if(info.info == DEVICE_INFO_NAME) {
         {
+            std::unique_lock<std::mutex> _(m_info_mutex);
             m_friendly_name.clear();
             m_friendly_name.reserve(info.data.size());
             std::copy(info.data.begin(), info.data.end(), std::back_inserter(m_friendly_name));
-            set_status(m_status);
         }
+        set_status(m_status);
         mLogInfo("Persistent name for {} is now \"{}\"", native_id(), friendly_name());
     }
 }
@@ -802,7 +890,7 @@ void aseba_node::on_event(const Aseba::UserMessage& event, const Aseba::EventDes
     if((p.is_integral() && def.value != 1) || p.size() != def.value)
         return;
     events.insert(std::pair{Aseba::WStringToUTF8(def.name), p});
-    m_events_signal(shared_from_this(), events);
+    m_events_signal(shared_from_this(), make_node_notification(event_changed_payload(std::move(events))));
 }
 
 aseba_node::node_type aseba_node::type() const {
@@ -821,11 +909,14 @@ aseba_node::node_type aseba_node::type() const {
 }
 
 std::string aseba_node::friendly_name() const {
+    std::unique_lock<std::mutex> lock(m_info_mutex);
     if(m_friendly_name.empty()) {
+        lock.unlock();
         auto ep = m_endpoint.lock();
         if(ep) {
             return ep->endpoint_name();
         }
+        return {};
     }
     return m_friendly_name;
 }
@@ -837,11 +928,13 @@ void aseba_node::set_friendly_name(const std::string& str) {
     data.reserve(str.size());
     std::copy(str.begin(), str.end(), std::back_inserter(data));
     write_message(std::make_shared<Aseba::SetDeviceInfo>(native_id(), DEVICE_INFO_NAME, data));
+    std::unique_lock<std::mutex> _(m_info_mutex);
     m_friendly_name = str;
 }
 
 bool aseba_node::can_be_renamed() const {
     auto ep = m_endpoint.lock();
+    std::unique_lock<std::mutex> _(m_info_mutex);
     return ep && ep->type() == aseba_endpoint::endpoint_type::thymio && m_description.protocolVersion >= 6;
 }
 
@@ -7,9 +7,14 @@
 #include "node_id.h"
 #include "property.h"
 #include "events.h"
+#include "node_notification.h"
+#include "variables_update_schedule.h"
+#include "vm_variables.h"
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <atomic>
+#include <chrono>
 #include <aseba/flatbuffers/thymio_generated.h>
 #include <boost/signals2.hpp>
 #include <unordered_map>
@@ -18,6 +23,7 @@
 
 namespace mobsya {
 class aseba_endpoint;
+struct compiled_program;
 
 struct breakpoint {
     uint32_t line;
@@ -92,14 +98,19 @@ public:
     using breakpoints = std::unordered_set<breakpoint>;
 
     using variables_map = std::unordered_map<std::string, variable>;
-    using variables_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, variables_map)>;
+    // Watchers receive changes as shared notifications, serialized once for all of them
+    using variables_watch_signal_t =
+        boost::signals2::signal<void(std::shared_ptr<aseba_node>, node_notification_ptr<variables_map>)>;
 
     using events_table = std::vector<mobsya::event>;
     using event_changed_payload = variant_ns::variant<events_table, variables_map>;
-    using events_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, event_changed_payload)>;
+    using events_watch_signal_t =
+        boost::signals2::signal<void(std::shared_ptr<aseba_node>, node_notification_ptr<event_changed_payload>)>;
 
-    using vm_state_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, vm_execution_state)>;
+    using vm_state_watch_signal_t =
+        boost::signals2::signal<void(std::shared_ptr<aseba_node>, node_notification_ptr<vm_execution_state>)>;
     using vm_execution_state_command = fb::VMExecutionStateCommand;
+    using strand_type = boost::asio::strand<boost::asio::io_context::executor_type>;
 
 
     aseba_node(boost::asio::io_context& ctx, node_id_t id, std::weak_ptr<mobsya::aseba_endpoint> endpoint);
@@ -122,9 +133,16 @@ public:
     }
 
     node_id uuid() const {
+        std::unique_lock<std::mutex> _(m_info_mutex);
         return m_uuid;
     }
 
+    // The state of a node is only accessed from that strand,
+    // except for its status, uuid, name and description that can be read from anywhere
+    strand_type& strand() {
+        return m_strand;
+    }
+
     node_type type() const;
 
     std::string friendly_name() const;
@@ -134,9 +152,11 @@ public:
     bool is_wirelessly_connected() const;
 
     Aseba::TargetDescription vm_description() const {
+        std::unique_lock<std::mutex> _(m_info_mutex);
         return m_description;
     }
 
+    // The following functions must be invoked from the strand of the node
     variables_map variables() const;
     events_table events_description() const;
     vm_execution_state execution_state() const;
@@ -146,10 +166,12 @@ public:
     // Write a message to the enpoint owning that node, then invoke cb
     void write_message(std::shared_ptr<Aseba::Message> message, write_callback&& cb = {});
 
-    // Compile a program and send it to the node, invoking cb once the assossiated message is written out
-    void compile_program(fb::ProgrammingLanguage language, const std::string& program, compilation_callback&& cb = {});
+    // Compile a program on the compilation service and send it to the node,
+    // invoking cb once the assossiated message is written out
+    void compile_program(fb::ProgrammingLanguage language, const std::string& program, fb::VectorLoops vector_loops,
+                         compilation_callback&& cb = {});
     void compile_and_send_program(fb::ProgrammingLanguage language, const std::string& program,
-                                  compilation_callback&& cb = {});
+                                  fb::VectorLoops vector_loops, compilation_callback&& cb = {});
     void set_vm_execution_state(vm_execution_state_command state, write_callback&& cb = {});
     void set_breakpoints(std::vector<breakpoint> breakpoints, breakpoints_callback&& cb = {});
 
@@ -158,6 +180,8 @@ public:
 
     boost::system::error_code emit_events(const aseba_node::variables_map& map, write_callback&& cb = {});
     void rename(const std::string& new_name);
+
+    // Locking and watching can be done from any thread
     bool lock(void* app);
     bool unlock(void* app);
 
@@ -167,6 +191,14 @@ public:
         return m_variables_changed_signal.connect(std::forward<ConnectionArgs>(args)...);
     }
 
+    /*
+     *  Ask for the variables to be updated every period for watcher, a connection to the variables changes.
+     *  The node is polled at the fastest period requested by the watchers still connected,
+     *  and more slowly while the variables do not change or while the node does not answer in time.
+     *  Must be called from the strand of the node.
+     */
+    void set_variables_update_period(boost::signals2::connection watcher, std::chrono::milliseconds period);
+
     template <typename... ConnectionArgs>
     auto connect_to_events(ConnectionArgs... args) {
         return m_events_signal.connect(std::forward<ConnectionArgs>(args)...);
@@ -180,9 +212,33 @@ public:
 private:
     friend class aseba_endpoint;
     void set_status(status);
+
+    // A compilation running on the compilation service, working on copies of the state of the node
+    struct compilation_job {
+        compilation_job(Aseba::TargetDescription description, Aseba::CommonDefinitions defs,
+                        fb::ProgrammingLanguage language, std::string program, fb::VectorLoops vector_loops)
+            : description(std::move(description))
+            , defs(std::move(defs))
+            , language(language)
+            , program(std::move(program))
+            , vector_loops(vector_loops) {}
+        Aseba::TargetDescription description;
+        Aseba::CommonDefinitions defs;
+        fb::ProgrammingLanguage language;
+        std::string program;
+        fb::VectorLoops vector_loops;
+        // Key of the program in the compilation cache
+        std::string key;
+        std::shared_ptr<const compiled_program> output;
+    };
+    using compilation_job_callback = std::function<void(std::shared_ptr<compilation_job>)>;
+    // Look job up in the compilation cache or run it on the compilation service, then invoke cb on the node strand
+    void compile_async(std::shared_ptr<compilation_job> job, compilation_job_callback&& cb);
+    void send_compiled_program(compilation_job& job, compilation_callback&& cb);
+    // Runs on the compilation service: must not access the state of the node
     tl::expected<compilation_result, boost::system::error_code>
     do_compile_program(Aseba::Compiler& compiler, Aseba::CommonDefinitions& defs, fb::ProgrammingLanguage language,
-                       const std::string& program, Aseba::BytecodeVector& bytecode);
+                       const std::string& program, Aseba::BytecodeVector& bytecode) const;
 
     // Must be called before destructor !
     void disconnect();
@@ -195,9 +251,9 @@ private:
     void request_variables();
     void on_variables_message(const Aseba::Variables& msg);
     void on_variables_message(const Aseba::ChangedVariables& msg);
-    void set_variables(uint16_t start, const std::vector<int16_t>& data,
-                       std::unordered_map<std::string, variable>& vars);
+    variables_map take_changed_variables();
     void schedule_variables_update();
+    std::chrono::milliseconds variables_update_period();
     void send_events_table();
     void on_execution_state_message(const Aseba::ExecutionStateChanged&);
     void on_vm_runtime_error(const Aseba::Message&);
@@ -210,6 +266,13 @@ private:
     void handle_step_request();
     void cancel_pending_step_request();
 
+    // Write callbacks are invoked by the endpoint, wrap them so that they run on the node strand
+    template <typename CB>
+    write_callback on_strand(CB&& cb) {
+        return [strand = m_strand, cb = std::forward<CB>(cb)](boost::system::error_code ec) {
+            boost::asio::post(strand, std::bind(cb, ec));
+        };
+    }
 
     std::optional<std::pair<Aseba::EventDescription, std::size_t>> get_event(const std::string& name) const;
     std::optional<std::pair<Aseba::EventDescription, std::size_t>> get_event(uint16_t id) const;
@@ -224,7 +287,23 @@ private:
     Aseba::CommonDefinitions m_defs;
     Aseba::BytecodeVector m_bytecode;
     breakpoints m_breakpoints;
+    // Incremented for each program sent, so that the result of older compilations can be dropped
+    unsigned m_program_generation = 0;
     boost::asio::io_context& m_io_ctx;
+    strand_type m_strand;
+    // Protects the uuid, name and description, written on the strand but read by application endpoints
+    mutable std::mutex m_info_mutex;
+    // Compiler keeping the bytecode of the events and subroutines of the last program compiled for
+    // the node, so that the next one only compiles those that changed. Used by one compilation at a
+    // time, the others use a compiler of their own
+    struct incremental_compiler {
+        incremental_compiler() {
+            compiler.setIncrementalCompilation(true);
+        }
+        std::mutex mutex;
+        Aseba::Compiler compiler;
+    };
+    std::shared_ptr<incremental_compiler> m_incremental_compiler;
 
     struct {
         int pc = 0;
@@ -233,17 +312,14 @@ private:
         fb::VMExecutionState state = fb::VMExecutionState::Stopped;
     } m_vm_state;
 
-    struct aseba_vm_variable {
-        std::string name;
-        uint16_t start;
-        uint16_t size;
-        std::vector<int16_t> value;
-
-        aseba_vm_variable(const std::string& name, uint16_t start, uint16_t size)
-            : name(name), start(start), size(size) {}
-    };
-    std::vector<aseba_vm_variable> m_variables;
+    vm_variables m_variables;
     boost::asio::deadline_timer m_variables_timer;
+    struct variables_watcher {
+        boost::signals2::connection connection;
+        std::chrono::milliseconds period;
+    };
+    std::vector<variables_watcher> m_variables_watchers;
+    variables_update_schedule m_variables_schedule;
     variables_watch_signal_t m_variables_changed_signal;
     events_watch_signal_t m_events_signal;
     vm_state_watch_signal_t m_vm_state_watch_signal;
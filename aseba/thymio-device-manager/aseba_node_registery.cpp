@@ -2,6 +2,8 @@
 #include "log.h"
 #include <aware/aware.hpp>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/asio/ip/host_name.hpp>
@@ -11,6 +13,7 @@ namespace mobsya {
 aseba_node_registery::aseba_node_registery(boost::asio::execution_context& io_context)
     : boost::asio::detail::service_base<aseba_node_registery>(static_cast<boost::asio::io_context&>(io_context))
     , m_uid(boost::uuids::random_generator()())
+    , m_aseba_nodes(std::make_shared<node_map>())
     , m_discovery_socket(static_cast<boost::asio::io_context&>(io_context))
     , m_nodes_service_desc("mobsya") {
     m_nodes_service_desc.name(fmt::format("Thymio Device Manager on {}", boost::asio::ip::host_name()));
@@ -21,12 +24,14 @@ aseba_node_registery::aseba_node_registery(boost::asio::execution_context& io_co
 void aseba_node_registery::add_node(std::shared_ptr<aseba_node> node) {
     std::unique_lock<std::mutex> lock(m_nodes_mutex);
 
-    auto it = find(node);
-    if(it == std::end(m_aseba_nodes)) {
+    auto map = *std::atomic_load(&m_aseba_nodes);
+    auto it = find(map, node);
+    if(it == std::end(map)) {
         node_id id = node->uuid();
         if(id.is_nil())
             id = m_id_generator();
-        it = m_aseba_nodes.insert({id, node}).first;
+        map.insert({id, node});
+        publish(std::move(map));
         lock.unlock();
         m_node_status_changed_signal(node, id, aseba_node::status::connected);
 
@@ -36,48 +41,59 @@ void aseba_node_registery::add_node(std::shared_ptr<aseba_node> node) {
 
 void aseba_node_registery::set_node_uuid(const std::shared_ptr<aseba_node>& node, const node_id& id) {
     std::unique_lock<std::mutex> lock(m_nodes_mutex);
-    auto it = find(node);
-    if(it != std::end(m_aseba_nodes)) {
-        m_node_status_changed_signal(node, it->first, aseba_node::status::disconnected);
-        m_aseba_nodes.erase(it);
+    auto map = *std::atomic_load(&m_aseba_nodes);
+    std::optional<node_id> old_id;
+    auto it = find(map, node);
+    if(it != std::end(map)) {
+        old_id = it->first;
+        map.erase(it);
     }
-    m_aseba_nodes.insert({id, node});
+    map.insert({id, node});
+    publish(std::move(map));
     lock.unlock();
+    if(old_id)
+        m_node_status_changed_signal(node, *old_id, aseba_node::status::disconnected);
 }
 
 void aseba_node_registery::remove_node(const std::shared_ptr<aseba_node>& node) {
-    {
-        std::unique_lock<std::mutex> lock(m_nodes_mutex);
-
-        mLogTrace("Removing node {}", node->friendly_name());
-        auto it = find(node);
-        if(it != std::end(m_aseba_nodes)) {
-            node_id id = it->first;
-            m_aseba_nodes.erase(it);
-            lock.unlock();
-            m_node_status_changed_signal(node, id, aseba_node::status::disconnected);
-            lock.lock();
-        }
+    std::unique_lock<std::mutex> lock(m_nodes_mutex);
+
+    mLogTrace("Removing node {}", node->friendly_name());
+    auto map = *std::atomic_load(&m_aseba_nodes);
+    auto it = find(map, node);
+    if(it != std::end(map)) {
+        node_id id = it->first;
+        map.erase(it);
+        publish(std::move(map));
+        lock.unlock();
+        m_node_status_changed_signal(node, id, aseba_node::status::disconnected);
     }
 }
 
 void aseba_node_registery::set_node_status(const std::shared_ptr<aseba_node>& node, aseba_node::status status) {
-    {
-        std::unique_lock<std::mutex> lock(m_nodes_mutex);
-        auto it = find(node);
-        if(it != std::end(m_aseba_nodes)) {
-            node_id id = it->first;
-            lock.unlock();
-            mLogInfo("Changing node {} status to {} ", id, aseba_node::status_to_string(status));
-            m_node_status_changed_signal(node, id, status);
-            lock.lock();
-        }
+    // The status is held by the node, the map is unchanged
+    const auto map = nodes();
+    auto it = find(*map, node);
+    if(it != std::end(*map)) {
+        node_id id = it->first;
+        mLogInfo("Changing node {} status to {} ", id, aseba_node::status_to_string(status));
+        m_node_status_changed_signal(node, id, status);
     }
 }
 
-aseba_node_registery::node_map aseba_node_registery::nodes() const {
-    std::unique_lock<std::mutex> _(m_nodes_mutex);
-    return m_aseba_nodes;
+aseba_node_registery::node_map_ptr aseba_node_registery::nodes() const {
+    return std::atomic_load(&m_aseba_nodes);
+}
+
+void aseba_node_registery::publish(node_map map) {
+    // Drop the entries of nodes destroyed without being removed
+    for(auto it = std::begin(map); it != std::end(map);) {
+        if(it->second.expired())
+            it = map.erase(it);
+        else
+            ++it;
+    }
+    std::atomic_store(&m_aseba_nodes, node_map_ptr(std::make_shared<node_map>(std::move(map))));
 }
 
 void aseba_node_registery::set_tcp_endpoint(const boost::asio::ip::tcp::endpoint& endpoint) {
@@ -128,30 +144,21 @@ aware::contact::property_map_type aseba_node_registery::build_discovery_properti
     return map;
 }
 
-auto aseba_node_registery::find(const std::shared_ptr<aseba_node>& node) const -> node_map::const_iterator {
-    for(auto it = std::begin(m_aseba_nodes); it != std::end(m_aseba_nodes); ++it) {
+auto aseba_node_registery::find(const node_map& map, const std::shared_ptr<aseba_node>& node)
+    -> node_map::const_iterator {
+    for(auto it = std::begin(map); it != std::end(map); ++it) {
         if(it->second.expired())
             continue;
         if(it->second.lock() == node)
             return it;
     }
-    return std::end(m_aseba_nodes);
-}
-
-auto aseba_node_registery::find_from_native_id(aseba_node::node_id_t id) const -> node_map::const_iterator {
-    for(auto it = std::begin(m_aseba_nodes); it != std::end(m_aseba_nodes); ++it) {
-        if(it->second.expired())
-            continue;
-        if(it->second.lock()->native_id() == id)
-            return it;
-    }
-    return std::end(m_aseba_nodes);
+    return std::end(map);
 }
 
 std::shared_ptr<aseba_node> aseba_node_registery::node_from_id(const aseba_node_registery::node_id& id) const {
-    std::unique_lock<std::mutex> _(m_nodes_mutex);
-    auto it = m_aseba_nodes.find(id);
-    if(it == std::end(m_aseba_nodes))
+    const auto map = nodes();
+    auto it = map->find(id);
+    if(it == std::end(*map))
         return {};
     return it->second.lock();
 }
@@ -15,6 +15,7 @@ class aseba_node_registery : public boost::asio::detail::service_base<aseba_node
 public:
     using node_id = mobsya::node_id;
     using node_map = std::unordered_map<node_id, std::weak_ptr<aseba_node>>;
+    using node_map_ptr = std::shared_ptr<const node_map>;
 
     aseba_node_registery(boost::asio::execution_context& ctx);
 
@@ -25,7 +26,13 @@ public:
     void set_tcp_endpoint(const boost::asio::ip::tcp::endpoint& endpoint);
     void set_ws_endpoint(const boost::asio::ip::tcp::endpoint& endpoint);
 
-    node_map nodes() const;
+    /*
+     *  The nodes are published as immutable snapshots, replaced on every change,
+     *  so that listing and looking up nodes do not take the registry mutex, held while nodes are
+     *  registered or removed. Loading the snapshot may still briefly lock, as std::atomic_load on a
+     *  shared_ptr is not lock-free on all standard libraries.
+     */
+    node_map_ptr nodes() const;
     std::shared_ptr<aseba_node> node_from_id(const node_id&) const;
 
 
@@ -35,16 +42,20 @@ private:
     aware::contact::property_map_type build_discovery_properties() const;
 
 
-    node_map::const_iterator find(const std::shared_ptr<aseba_node>& node) const;
-    node_map::const_iterator find_from_native_id(aseba_node::node_id_t id) const;
+    // Must be called with m_nodes_mutex held
+    void publish(node_map map);
+
+    static node_map::const_iterator find(const node_map& map, const std::shared_ptr<aseba_node>& node);
     boost::uuids::uuid m_uid;
-    node_map m_aseba_nodes;
+    // Only accessed through std::atomic_load / std::atomic_store
+    node_map_ptr m_aseba_nodes;
     aware::announce_socket m_discovery_socket;
     aware::contact m_nodes_service_desc;
     // Endpoint of the WebSocket - So we can expose the port on zeroconf
     boost::asio::ip::tcp::endpoint m_ws_endpoint;
 
     mutable std::mutex m_discovery_mutex;
+    // Serializes writers, readers only load the current snapshot
     mutable std::mutex m_nodes_mutex;
     bool m_updating_discovery = false;
     bool m_discovery_needs_update = false;
@@ -0,0 +1,149 @@
+#include "compilation_cache.h"
+#include "log.h"
+#include <aseba/common/utils/utils.h>
+
+namespace mobsya {
+
+namespace {
+    /* Append length prefixed fields, so that different inputs never produce the same key */
+    void append(std::string& key, uint32_t v) {
+        key.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+    void append(std::string& key, const std::string& s) {
+        append(key, uint32_t(s.size()));
+        key.append(s);
+    }
+    void append(std::string& key, const std::wstring& s) {
+        append(key, Aseba::WStringToUTF8(s));
+    }
+    void append(std::string& key, const Aseba::NamedValuesVector& values) {
+        append(key, uint32_t(values.size()));
+        for(const auto& v : values) {
+            append(key, v.name);
+            append(key, uint32_t(v.value));
+        }
+    }
+
+    void append(std::string& key, const Aseba::TargetDescription& description) {
+        append(key, description.name);
+        append(key, description.protocolVersion);
+        append(key, description.bytecodeSize);
+        append(key, description.variablesSize);
+        append(key, description.stackSize);
+        append(key, uint32_t(description.namedVariables.size()));
+        for(const auto& v : description.namedVariables) {
+            append(key, v.name);
+            append(key, v.size);
+        }
+        append(key, uint32_t(description.localEvents.size()));
+        for(const auto& e : description.localEvents)
+            append(key, e.name);
+        append(key, uint32_t(description.nativeFunctions.size()));
+        for(const auto& f : description.nativeFunctions) {
+            append(key, f.name);
+            append(key, uint32_t(f.parameters.size()));
+            for(const auto& p : f.parameters) {
+                append(key, p.name);
+                append(key, uint32_t(p.size));
+            }
+        }
+    }
+}  // namespace
+
+compilation_cache::compilation_cache(boost::asio::execution_context& ctx)
+    : boost::asio::detail::service_base<compilation_cache>(static_cast<boost::asio::io_context&>(ctx)) {}
+
+void compilation_cache::set_capacity(std::size_t capacity) {
+    std::unique_lock<std::mutex> _(m_mutex);
+    m_capacity = capacity;
+    while(m_programs.size() > m_capacity) {
+        m_index.erase(m_programs.back().first);
+        m_programs.pop_back();
+        m_stats.evictions++;
+    }
+    m_stats.size = m_programs.size();
+}
+
+std::string compilation_cache::make_key(const Aseba::TargetDescription& description,
+                                        const Aseba::CommonDefinitions& defs, fb::ProgrammingLanguage language,
+                                        fb::VectorLoops vector_loops, const std::string& program) {
+    std::string key;
+    append(key, description);
+    append(key, defs.events);
+    append(key, defs.constants);
+    append(key, uint32_t(language));
+    append(key, uint32_t(vector_loops));
+    append(key, program);
+    return key;
+}
+
+compilation_cache::program_ptr compilation_cache::find(const std::string& key, waiter w, bool& compile) {
+    compile = false;
+    std::unique_lock<std::mutex> _(m_mutex);
+    auto it = m_index.find(key);
+    if(it != m_index.end()) {
+        m_stats.hits++;
+        m_programs.splice(m_programs.begin(), m_programs, it->second);
+        mLogTrace("Compilation cache hit ({} hits, {} misses)", m_stats.hits, m_stats.misses);
+        return it->second->second;
+    }
+    auto pending = m_pending.find(key);
+    if(pending != m_pending.end()) {
+        m_stats.coalesced++;
+        pending->second.push_back(std::move(w));
+        return {};
+    }
+    m_stats.misses++;
+    m_pending.emplace(key, std::vector<waiter>{});
+    compile = true;
+    mLogTrace("Compilation cache miss ({} hits, {} misses)", m_stats.hits, m_stats.misses);
+    return {};
+}
+
+void compilation_cache::insert(const std::string& key, program_ptr program) {
+    {
+        std::unique_lock<std::mutex> _(m_mutex);
+        if(m_capacity > 0 && m_index.find(key) == m_index.end()) {
+            m_programs.emplace_front(key, program);
+            m_index.emplace(key, m_programs.begin());
+            if(m_programs.size() > m_capacity) {
+                m_index.erase(m_programs.back().first);
+                m_programs.pop_back();
+                m_stats.evictions++;
+            }
+            m_stats.size = m_programs.size();
+        }
+    }
+    abandon(key, std::move(program));
+}
+
+void compilation_cache::abandon(const std::string& key, program_ptr program) {
+    // Waiters are invoked without holding the lock, as they may look up the cache again
+    for(auto& w : take_waiters(key))
+        w(program);
+}
+
+std::vector<compilation_cache::waiter> compilation_cache::take_waiters(const std::string& key) {
+    std::unique_lock<std::mutex> _(m_mutex);
+    std::vector<waiter> waiters;
+    auto it = m_pending.find(key);
+    if(it != m_pending.end()) {
+        waiters = std::move(it->second);
+        m_pending.erase(it);
+    }
+    return waiters;
+}
+
+compilation_cache::statistics compilation_cache::stats() const {
+    std::unique_lock<std::mutex> _(m_mutex);
+    return m_stats;
+}
+
+void compilation_cache::shutdown() {
+    std::unique_lock<std::mutex> _(m_mutex);
+    m_pending.clear();
+    m_index.clear();
+    m_programs.clear();
+}
+
+}  // namespace mobsya
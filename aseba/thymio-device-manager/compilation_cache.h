@@ -0,0 +1,82 @@
+#pragma once
+#include "aseba_node.h"
+#include <boost/asio/io_service.hpp>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mobsya {
+
+// The output of a compilation, shared by all nodes compiling the same program
+struct compiled_program {
+    // Definitions used by the program, including those declared by an Aesl document
+    Aseba::CommonDefinitions defs;
+    // Linked bytecode, with the line of each word for debugging
+    Aseba::BytecodeVector bytecode;
+    Aseba::VariablesMap variables;
+    tl::expected<aseba_node::compilation_result, boost::system::error_code> result;
+};
+
+/*
+ *  Content-addressed cache of compiled programs, keyed by everything a compilation depends on:
+ *  the description of the target, the common definitions, the language, the compiler options and the source.
+ *  The least recently used programs are evicted past the capacity.
+ *  Concurrent compilations of the same program are coalesced: the first lookup compiles,
+ *  the following ones wait for its result, so that sending a program to many robots compiles it once.
+ */
+class compilation_cache : public boost::asio::detail::service_base<compilation_cache> {
+public:
+    using program_ptr = std::shared_ptr<const compiled_program>;
+    using waiter = std::function<void(program_ptr)>;
+
+    struct statistics {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        // Lookups that waited for an identical compilation in progress
+        std::size_t coalesced = 0;
+        std::size_t evictions = 0;
+        std::size_t size = 0;
+    };
+
+    compilation_cache(boost::asio::execution_context& ctx);
+
+    // Set the maximum number of programs kept, 0 to disable caching
+    void set_capacity(std::size_t capacity);
+
+    static std::string make_key(const Aseba::TargetDescription& description, const Aseba::CommonDefinitions& defs,
+                                fb::ProgrammingLanguage language, fb::VectorLoops vector_loops,
+                                const std::string& program);
+
+    /*
+     *  Return the program cached for key.
+     *  Otherwise return nullptr and, if the same program is being compiled, keep w to be
+     *  invoked with it later. If not, set compile to true: the caller must compile the program then call
+     *  insert or abandon.
+     */
+    program_ptr find(const std::string& key, waiter w, bool& compile);
+    // Store the program compiled for key and pass it to the lookups waiting for it
+    void insert(const std::string& key, program_ptr program);
+    // Pass program to the lookups waiting for key without storing it
+    void abandon(const std::string& key, program_ptr program);
+
+    statistics stats() const;
+
+private:
+    void shutdown() override;
+    std::vector<waiter> take_waiters(const std::string& key);
+
+    using lru_list = std::list<std::pair<std::string, program_ptr>>;
+    mutable std::mutex m_mutex;
+    // Most recently used first
+    lru_list m_programs;
+    std::unordered_map<std::string, lru_list::iterator> m_index;
+    std::unordered_map<std::string, std::vector<waiter>> m_pending;
+    std::size_t m_capacity = 256;
+    statistics m_stats;
+};
+
+}  // namespace mobsya
@@ -0,0 +1,71 @@
+#include "compilation_service.h"
+#include "log.h"
+#include <algorithm>
+#include <thread>
+
+namespace mobsya {
+
+compilation_service::compilation_service(boost::asio::execution_context& ctx)
+    : boost::asio::detail::service_base<compilation_service>(static_cast<boost::asio::io_context&>(ctx))
+    , m_threads_count(std::max(1u, std::thread::hardware_concurrency())) {}
+
+void compilation_service::configure(unsigned threads_count, std::size_t max_queue_depth) {
+    std::unique_lock<std::mutex> _(m_mutex);
+    m_threads_count = std::max(1u, threads_count);
+    m_max_queue_depth = std::max(std::size_t(1), max_queue_depth);
+}
+
+boost::asio::thread_pool& compilation_service::pool() {
+    std::unique_lock<std::mutex> _(m_mutex);
+    if(!m_pool)
+        m_pool = std::make_unique<boost::asio::thread_pool>(m_threads_count);
+    return *m_pool;
+}
+
+void compilation_service::shutdown() {
+    std::unique_ptr<boost::asio::thread_pool> pool;
+    {
+        std::unique_lock<std::mutex> _(m_mutex);
+        pool = std::move(m_pool);
+    }
+    if(pool) {
+        pool->stop();
+        pool->join();
+    }
+}
+
+bool compilation_service::enqueue() {
+    std::unique_lock<std::mutex> _(m_mutex);
+    if(m_stats.queue_depth >= m_max_queue_depth) {
+        m_stats.rejected++;
+        mLogWarn("Compilation rejected: {} compilations pending", m_stats.queue_depth);
+        return false;
+    }
+    m_stats.queue_depth++;
+    m_stats.max_queue_depth = std::max(m_stats.max_queue_depth, m_stats.queue_depth);
+    return true;
+}
+
+void compilation_service::dequeue(clock::time_point queued, clock::time_point started) {
+    const auto now = clock::now();
+    const auto compilation_time = now - started;
+    const auto latency = now - queued;
+    std::unique_lock<std::mutex> _(m_mutex);
+    m_stats.queue_depth--;
+    m_stats.completed++;
+    m_stats.total_compilation_time += compilation_time;
+    m_stats.max_compilation_time = std::max(m_stats.max_compilation_time, compilation_time);
+    m_stats.total_latency += latency;
+    m_stats.max_latency = std::max(m_stats.max_latency, latency);
+    mLogDebug("Compiled in {}ms, {}ms after being queued - {} compilations pending, average latency {}ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(compilation_time).count(),
+              std::chrono::duration_cast<std::chrono::milliseconds>(latency).count(), m_stats.queue_depth,
+              std::chrono::duration_cast<std::chrono::milliseconds>(m_stats.total_latency / m_stats.completed).count());
+}
+
+compilation_service::statistics compilation_service::stats() const {
+    std::unique_lock<std::mutex> _(m_mutex);
+    return m_stats;
+}
+
+}  // namespace mobsya
@@ -0,0 +1,76 @@
+#pragma once
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace mobsya {
+
+/*
+ *  Runs compilations on a dedicated pool of threads, so that they never stall
+ *  the threads handling devices and applications.
+ *  The number of compilations queued or running is bounded, new ones being rejected past that limit.
+ */
+class compilation_service : public boost::asio::detail::service_base<compilation_service> {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct statistics {
+        // Compilations queued or running
+        std::size_t queue_depth = 0;
+        std::size_t max_queue_depth = 0;
+        std::size_t completed = 0;
+        std::size_t rejected = 0;
+        // Time spent compiling
+        clock::duration total_compilation_time{};
+        clock::duration max_compilation_time{};
+        // Time from submission to completion, including queueing
+        clock::duration total_latency{};
+        clock::duration max_latency{};
+    };
+
+    compilation_service(boost::asio::execution_context& ctx);
+
+    // Set the number of threads compiling and the maximum number of compilations queued or running,
+    // must be called before any compilation
+    void configure(unsigned threads_count, std::size_t max_queue_depth);
+
+    /*
+     *  Run job on the pool, then post completion to executor.
+     *  Returns false without running anything if too many compilations are pending.
+     */
+    template <typename Job, typename Executor, typename Completion>
+    bool post(Job&& job, const Executor& executor, Completion&& completion) {
+        if(!enqueue())
+            return false;
+        // The work guard keeps the context of executor running until the completion is posted
+        boost::asio::post(pool(), [this, job = std::forward<Job>(job), work = boost::asio::make_work_guard(executor),
+                                   completion = std::forward<Completion>(completion), queued = clock::now()]() mutable {
+            const auto started = clock::now();
+            job();
+            dequeue(queued, started);
+            boost::asio::post(work.get_executor(), std::move(completion));
+            work.reset();
+        });
+        return true;
+    }
+
+    statistics stats() const;
+
+private:
+    void shutdown() override;
+    bool enqueue();
+    void dequeue(clock::time_point queued, clock::time_point started);
+    boost::asio::thread_pool& pool();
+
+    mutable std::mutex m_mutex;
+    std::unique_ptr<boost::asio::thread_pool> m_pool;
+    unsigned m_threads_count;
+    std::size_t m_max_queue_depth = 128;
+    statistics m_stats;
+};
+
+}  // namespace mobsya
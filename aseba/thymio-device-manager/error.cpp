@@ -17,6 +17,8 @@ std::string tdm_error_category::message(int ev) const {
         case error_code::invalid_object: return "invalid object";
         case error_code::no_such_variable: return "no such variable";
         case error_code::incompatible_variable_type: return "incompatible variable type";
+        case error_code::invalid_aesl: return "invalid aesl";
+        case error_code::too_many_compilations: return "too many compilations pending";
     }
     return {};
 }
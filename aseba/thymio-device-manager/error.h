@@ -12,6 +12,7 @@ enum class error_code {
     no_such_variable,
     incompatible_variable_type,
     invalid_aesl,
+    too_many_compilations,
 };
 
 class tdm_error_category : public boost::system::error_category {
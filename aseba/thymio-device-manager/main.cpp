@@ -5,11 +5,15 @@
 #include <boost/thread.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 #include <errno.h>
+#include <iostream>
+#include <thread>
 #include "log.h"
 #include "interfaces.h"
 #include "aseba_node_registery.h"
 #include "app_server.h"
 #include "app_token_manager.h"
+#include "compilation_cache.h"
+#include "compilation_service.h"
 #include "aseba_endpoint.h"
 #include "aseba_tcpacceptor.h"
 #include <boost/filesystem.hpp>
@@ -23,9 +27,53 @@
 
 static const auto lock_file_path = boost::filesystem::temp_directory_path() / "mobsya-tdm-0accdcbf-eeb2";
 
-int main() {
-    mLogInfo("Starting...");
-    boost::asio::io_context ctx;
+int main(int argc, char** argv) {
+    namespace po = boost::program_options;
+    unsigned threads_count = std::max(1u, std::thread::hardware_concurrency());
+    unsigned compilation_threads_count = threads_count;
+    std::size_t max_pending_compilations = 128;
+    std::size_t compilation_cache_size = 256;
+    mobsya::app_outbound_queue::limits app_queue_limits;
+    std::string slow_app_policy = "coalesce";
+    po::options_description options("Thymio Device Manager");
+    options.add_options()("help,h", "display this help and exit")(
+        "threads,j", po::value<unsigned>(&threads_count)->default_value(threads_count),
+        "number of threads handling devices and applications")(
+        "compilation-threads", po::value<unsigned>(&compilation_threads_count)->default_value(compilation_threads_count),
+        "number of threads compiling programs")(
+        "max-pending-compilations",
+        po::value<std::size_t>(&max_pending_compilations)->default_value(max_pending_compilations),
+        "number of compilations that can be queued before rejecting new ones")(
+        "compilation-cache-size",
+        po::value<std::size_t>(&compilation_cache_size)->default_value(compilation_cache_size),
+        "number of compiled programs kept to be sent again without recompiling, 0 to disable")(
+        "app-queue-size", po::value<std::size_t>(&app_queue_limits.max_size)->default_value(app_queue_limits.max_size),
+        "bytes that can be waiting to be sent to an application before applying the slow application policy")(
+        "slow-app-policy", po::value<std::string>(&slow_app_policy)->default_value(slow_app_policy),
+        "what to do with applications not reading their messages fast enough: coalesce (variables updates, "
+        "then drop events), drop (oldest variables updates and events) or disconnect");
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        po::notify(vm);
+    } catch(const po::error& e) {
+        std::cerr << e.what() << "\n" << options;
+        return EINVAL;
+    }
+    if(vm.count("help")) {
+        std::cout << options;
+        return 0;
+    }
+    threads_count = std::max(1u, threads_count);
+    if(auto policy = mobsya::app_outbound_queue::policy_from_string(slow_app_policy)) {
+        app_queue_limits.slow_consumer_policy = *policy;
+    } else {
+        std::cerr << "Invalid slow application policy: " << slow_app_policy << "\n" << options;
+        return EINVAL;
+    }
+
+    mLogInfo("Starting with {} threads...", threads_count);
+    boost::asio::io_context ctx(int(threads_count));
     boost::asio::signal_set sig(ctx);
     if(!boost::filesystem::exists(lock_file_path)) {
         std::ofstream _(lock_file_path.c_str());
@@ -66,10 +114,14 @@ int main() {
         }
         // Create a server for regular tcp connection
         mobsya::application_server<mobsya::tcp::socket> tcp_server(ctx, 0);
+        tcp_server.set_outbound_queue_limits(app_queue_limits);
         tcp_server.accept();
 
         mobsya::aseba_node_registery& node_registery = boost::asio::make_service<mobsya::aseba_node_registery>(ctx);
         mobsya::app_token_manager& token_manager = boost::asio::make_service<mobsya::app_token_manager>(ctx);
+        mobsya::compilation_service& compilation = boost::asio::make_service<mobsya::compilation_service>(ctx);
+        compilation.configure(compilation_threads_count, max_pending_compilations);
+        boost::asio::make_service<mobsya::compilation_cache>(ctx).set_capacity(compilation_cache_size);
 
         node_registery.set_tcp_endpoint(tcp_server.endpoint());
 
@@ -77,6 +129,7 @@ int main() {
         mobsya::aseba_tcp_acceptor aseba_tcp_acceptor(ctx);
         // Create a server for websocket
         mobsya::application_server<mobsya::websocket_t> websocket_server(ctx, 8597);
+        websocket_server.set_outbound_queue_limits(app_queue_limits);
         websocket_server.accept();
         node_registery.set_ws_endpoint(websocket_server.endpoint());
 
@@ -90,7 +143,14 @@ int main() {
 #endif
         aseba_tcp_acceptor.accept();
 
+        // Nodes, devices and applications are each serialized on their own strand,
+        // so that the context can be run by a pool of threads
+        std::vector<std::thread> pool;
+        for(unsigned i = 1; i < threads_count; i++)
+            pool.emplace_back([&ctx] { ctx.run(); });
         ctx.run();
+        for(auto& t : pool)
+            t.join();
     } catch(boost::system::system_error e) {
         mLogError("Exception thrown: {}", e.what());
         std::exit(e.code().value());
@@ -0,0 +1,45 @@
+#pragma once
+#include <aseba/flatbuffers/fb_message_ptr.h>
+#include <memory>
+#include <mutex>
+
+namespace mobsya {
+
+/*
+ *  A change of a node, shared by all the application endpoints watching the node,
+ *  so that it is serialized once rather than once per endpoint.
+ */
+template <typename Payload>
+class node_notification {
+public:
+    explicit node_notification(Payload payload) : m_payload(std::move(payload)) {}
+
+    const Payload& payload() const {
+        return m_payload;
+    }
+
+    // Return the notification serialized by serialize(payload()), which is only invoked by the first caller.
+    // Can be called from any thread
+    template <typename Serialize>
+    std::shared_ptr<const tagged_detached_flatbuffer> serialized(Serialize&& serialize) const {
+        std::call_once(m_serialized_once, [this, &serialize] {
+            m_serialized = std::make_shared<tagged_detached_flatbuffer>(serialize(m_payload));
+        });
+        return m_serialized;
+    }
+
+private:
+    Payload m_payload;
+    mutable std::once_flag m_serialized_once;
+    mutable std::shared_ptr<const tagged_detached_flatbuffer> m_serialized;
+};
+
+template <typename Payload>
+using node_notification_ptr = std::shared_ptr<const node_notification<Payload>>;
+
+template <typename Payload>
+node_notification_ptr<std::decay_t<Payload>> make_node_notification(Payload&& payload) {
+    return std::make_shared<node_notification<std::decay_t<Payload>>>(std::forward<Payload>(payload));
+}
+
+}  // namespace mobsya
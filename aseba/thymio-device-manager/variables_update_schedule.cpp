@@ -0,0 +1,48 @@
+#include "variables_update_schedule.h"
+#include <algorithm>
+
+namespace mobsya {
+
+constexpr std::chrono::milliseconds variables_update_schedule::DEFAULT_PERIOD;
+constexpr std::chrono::milliseconds variables_update_schedule::MIN_PERIOD;
+constexpr std::chrono::milliseconds variables_update_schedule::MAX_BACKOFF_PERIOD;
+
+std::chrono::milliseconds variables_update_schedule::watcher_period(std::chrono::milliseconds period) {
+    if(period.count() == 0)
+        period = DEFAULT_PERIOD;
+    return std::max(period, MIN_PERIOD);
+}
+
+std::chrono::milliseconds variables_update_schedule::next_period(std::chrono::milliseconds period) const {
+    return std::min(period * m_backoff, std::max(period, MAX_BACKOFF_PERIOD));
+}
+
+bool variables_update_schedule::should_request() {
+    // Rather than piling up requests on a congested link, wait for the previous one to be answered,
+    // unless it got lost
+    if(m_pending_replies > 0 && ++m_skipped_updates < MAX_SKIPPED_VARIABLES_UPDATES) {
+        back_off();
+        return false;
+    }
+    return true;
+}
+
+void variables_update_schedule::requested(unsigned replies) {
+    m_pending_replies = replies;
+    m_skipped_updates = 0;
+}
+
+void variables_update_schedule::received(bool changed) {
+    if(m_pending_replies > 0)
+        m_pending_replies--;
+    if(changed)
+        m_backoff = 1;
+    else if(m_pending_replies == 0)
+        back_off();
+}
+
+void variables_update_schedule::back_off() {
+    m_backoff = std::min(m_backoff * 2, MAX_VARIABLES_BACKOFF);
+}
+
+}  // namespace mobsya
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+
+namespace mobsya {
+
+/*
+ *  When to ask a node for its variables.
+ *  The requested period is slowed down, up to MAX_VARIABLES_BACKOFF times, while the variables do not change
+ *  or while the node does not answer in time; a pending request is not repeated, unless it seems lost.
+ */
+class variables_update_schedule {
+public:
+    static constexpr std::chrono::milliseconds DEFAULT_PERIOD{100};
+    static constexpr std::chrono::milliseconds MIN_PERIOD{10};
+    // Backing off never slows the updates below that, unless a slower period was requested
+    static constexpr std::chrono::milliseconds MAX_BACKOFF_PERIOD{1000};
+    static constexpr unsigned MAX_VARIABLES_BACKOFF = 8;
+    // Past that, the pending request is considered lost
+    static constexpr unsigned MAX_SKIPPED_VARIABLES_UPDATES = 4;
+
+    // The period to use for a watcher asking for period, 0 meaning the default period
+    static std::chrono::milliseconds watcher_period(std::chrono::milliseconds period);
+
+    // The period to wait for before the next update, given the fastest period requested
+    std::chrono::milliseconds next_period(std::chrono::milliseconds period) const;
+
+    // Update at the requested period again
+    void reset_backoff() {
+        m_backoff = 1;
+    }
+
+    // Whether to request the variables when an update is due, backing off if the previous request is pending
+    bool should_request();
+    // The variables were requested, the node sending them in replies messages
+    void requested(unsigned replies);
+    // A reply was received, changed telling whether any variable changed
+    void received(bool changed);
+
+    unsigned pending_replies() const {
+        return m_pending_replies;
+    }
+
+private:
+    void back_off();
+
+    // Multiplies the update period while variables do not change or the node is congested
+    unsigned m_backoff = 1;
+    // Variables requested to the node but not received yet
+    unsigned m_pending_replies = 0;
+    unsigned m_skipped_updates = 0;
+};
+
+}  // namespace mobsya
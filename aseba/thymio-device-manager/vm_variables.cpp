@@ -0,0 +1,70 @@
+#include "vm_variables.h"
+#include <aseba/common/utils/utils.h>
+#include <algorithm>
+
+namespace mobsya {
+
+constexpr uint16_t vm_variables::NO_VARIABLE;
+
+void vm_variables::reset(const Aseba::VariablesMap& variables) {
+    m_variables.clear();
+    m_changed.clear();
+    for(const auto& var : variables) {
+        const auto name = Aseba::WStringToUTF8(var.first);
+        const auto start = var.second.first;
+        const auto size = var.second.second;
+        auto insert_point = std::lower_bound(m_variables.begin(), m_variables.end(), start,
+                                             [](const variable& v, unsigned start) { return v.start < start; });
+        if(insert_point == m_variables.end() || insert_point->start != start) {
+            m_variables.emplace(insert_point, name, start, size);
+        }
+    }
+    m_by_address.clear();
+    for(std::size_t i = 0; i < m_variables.size(); i++) {
+        const auto& var = m_variables[i];
+        if(m_by_address.size() < std::size_t(var.start + var.size))
+            m_by_address.resize(var.start + var.size, NO_VARIABLE);
+        std::fill_n(m_by_address.begin() + var.start, var.size, uint16_t(i));
+    }
+}
+
+void vm_variables::set(uint16_t start, const std::vector<int16_t>& data) {
+    const std::size_t end = std::min(start + data.size(), m_by_address.size());
+    std::size_t address = start;
+    while(address < end) {
+        const auto index = m_by_address[address];
+        // Memory not used by any named variable
+        if(index == NO_VARIABLE) {
+            address++;
+            continue;
+        }
+        auto& var = m_variables[index];
+        const auto var_start = address - var.start;
+        const auto count = std::min(var.size - var_start, end - address);
+        const auto data_it = std::begin(data) + (address - start);
+        bool changed = var.size != var.value.size();
+        var.value.resize(var.size, 0);
+        if(changed ||
+           !std::equal(std::begin(var.value) + var_start, std::begin(var.value) + var_start + count, data_it)) {
+            std::copy(data_it, data_it + count, std::begin(var.value) + var_start);
+            if(!var.changed) {
+                var.changed = true;
+                m_changed.push_back(index);
+            }
+        }
+        address += count;
+    }
+}
+
+const vm_variables::variable* vm_variables::at(uint16_t address) const {
+    if(address >= m_by_address.size() || m_by_address[address] == NO_VARIABLE)
+        return nullptr;
+    return &m_variables[m_by_address[address]];
+}
+
+const vm_variables::variable* vm_variables::find(const std::string& name) const {
+    auto it = std::find_if(m_variables.begin(), m_variables.end(), [&name](const variable& v) { return v.name == name; });
+    return it == m_variables.end() ? nullptr : &*it;
+}
+
+}  // namespace mobsya
@@ -0,0 +1,71 @@
+#pragma once
+#include <aseba/common/msg/TargetDescription.h>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mobsya {
+
+/*
+ *  The known values of the named variables of a VM, remembering those that changed since they were last taken.
+ */
+class vm_variables {
+public:
+    struct variable {
+        std::string name;
+        uint16_t start;
+        uint16_t size;
+        // Empty until the node sent the value
+        std::vector<int16_t> value;
+
+        // Whether the variable is in m_changed
+        bool changed = false;
+
+        variable(const std::string& name, uint16_t start, uint16_t size) : name(name), start(start), size(size) {}
+    };
+    using const_iterator = std::vector<variable>::const_iterator;
+
+    // Forget the values, the variables being now those of the map
+    void reset(const Aseba::VariablesMap& variables);
+
+    // Update the known values from the memory of the VM starting at start, remembering the variables that changed
+    void set(uint16_t start, const std::vector<int16_t>& data);
+
+    // Call visitor on each variable changed since the last call, in the order they changed
+    template <typename Visitor>
+    void take_changed(Visitor&& visitor) {
+        for(auto index : m_changed) {
+            auto& var = m_variables[index];
+            var.changed = false;
+            visitor(std::as_const(var));
+        }
+        m_changed.clear();
+    }
+
+    // The variable at address in the memory of the VM, if any
+    const variable* at(uint16_t address) const;
+    const variable* find(const std::string& name) const;
+
+    const_iterator begin() const {
+        return m_variables.begin();
+    }
+    const_iterator end() const {
+        return m_variables.end();
+    }
+    std::size_t size() const {
+        return m_variables.size();
+    }
+
+private:
+    // Sorted by address
+    std::vector<variable> m_variables;
+    // Index in m_variables of the variable at each address of the memory of the VM, so that applying
+    // the values sent by the node does not depend on the number of variables
+    static constexpr uint16_t NO_VARIABLE = 0xffff;
+    std::vector<uint16_t> m_by_address;
+    // Indexes of the variables changed since the last take_changed
+    std::vector<uint16_t> m_changed;
+};
+
+}  // namespace mobsya
@@ -24,8 +24,9 @@
 #include <string.h>
 #include <assert.h>
 
-static unsigned char buffer[ASEBA_MAX_INNER_PACKET_SIZE];
-static unsigned buffer_pos;
+/* per thread if VMs run on several threads, see ASEBA_VM_THREAD_LOCAL */
+ASEBA_VM_GLOBAL_STORAGE unsigned char buffer[ASEBA_MAX_INNER_PACKET_SIZE];
+ASEBA_VM_GLOBAL_STORAGE unsigned buffer_pos;
 
 static void buffer_add(const uint8_t* data, const uint16_t len) {
     uint16_t i = 0;
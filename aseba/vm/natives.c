@@ -892,7 +892,8 @@ const AsebaNativeFunctionDescription AsebaNativeDescription_vecnonzerosequence =
     "not found or if smaller than minLength",
     {{1, "dest"}, {-1, "src"}, {1, "minLength"}, {0, 0}}};
 
-static uint16_t rnd_state;
+/* per thread if VMs run on several threads, see ASEBA_VM_THREAD_LOCAL */
+ASEBA_VM_GLOBAL_STORAGE uint16_t rnd_state;
 
 void AsebaSetRandomSeed(uint16_t seed) {
     rnd_state = seed;
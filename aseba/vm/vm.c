@@ -48,6 +48,14 @@ void AsebaVMInit(AsebaVMState* vm) {
 
     // fill with no event
     vm->bytecode[0] = 0;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    vm->threadedCodeValid = 0;
+    if(vm->threadedCode) {
+        uint16_t i;
+        for(i = 0; i < vm->bytecodeSize; i++)
+            vm->threadedCode[i].breakpoint = 0;
+    }
+#endif
     memset(vm->variables, 0, vm->variablesSize * sizeof(int16_t));
     memset(vm->variablesOld, 0, vm->variablesSize * sizeof(int16_t));
 }
@@ -508,6 +516,15 @@ void AsebaVMEmitNodeSpecificError(AsebaVMState* vm, const char* message) {
     VM must be ready for run otherwise trashes may occur. */
 uint16_t AsebaVMCheckBreakpoint(AsebaVMState* vm) {
     uint16_t i;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    if(vm->threadedCode) {
+        if(vm->threadedCode[vm->pc].breakpoint) {
+            AsebaMaskSet(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK);
+            return 1;
+        }
+        return 0;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
     for(i = 0; i < vm->breakpointsCount; i++) {
         if(vm->breakpoints[i] == vm->pc) {
             AsebaMaskSet(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK);
@@ -518,9 +535,373 @@ uint16_t AsebaVMCheckBreakpoint(AsebaVMState* vm) {
     return 0;
 }
 
+#ifdef ASEBA_VM_THREADED_DISPATCH
+
+#    ifndef __GNUC__
+#        error "ASEBA_VM_THREADED_DISPATCH requires the labels as values extension of GCC or Clang"
+#    endif
+
+// In the threaded engine, a failed assertion hands the instruction over to AsebaVMStep
+#    ifdef ASEBA_ASSERT
+#        define THREADED_ASSERT(condition) \
+            if(condition)                   \
+            goto fallback
+#    else
+#        define THREADED_ASSERT(condition)
+#    endif
+
+//! Count one executed instruction and jump to the next one, unless stepsLimit is reached
+#    define THREADED_NEXT()                        \
+        do {                                        \
+            if(--stepsLeft == 0 && stepsLimit != 0) \
+                goto done;                          \
+            goto* code[pc].handler;                 \
+        } while(0)
+
+//! A superinstruction is only taken if all its instructions fit in stepsLimit
+#    define THREADED_FUSED_FITS(count)                  \
+        if(stepsLimit != 0 && stepsLeft < (count)) \
+        goto fallback
+
+//! Count the instructions executed by a superinstruction and jump to the next one
+#    define THREADED_FUSED_NEXT(count)  \
+        do {                             \
+            stepsLeft -= (count)-1;      \
+            THREADED_NEXT();             \
+        } while(0)
+
+/*! Run using the threaded code, decoding it first if bytecode changed.
+    This is equivalent to running AsebaVMStep in the loop of AsebaDebugBareRun, or of
+    AsebaDebugBreakpointRun as breakpoints are decoded as traps, except that
+    pc and sp are kept in locals and flags are only polled after the instructions that can
+    change them. These, as well as any error condition, are executed by AsebaVMStep itself.
+    Frequent sequences emitted by the compiler are fused into superinstructions, whose entry
+    in the threaded code is the one of their first instruction. As the entries of the other
+    instructions are left untouched, jumping inside a sequence and observing pc still behave
+    as with the switch interpreter. */
+static void AsebaVMThreadedRun(AsebaVMState* vm, uint16_t stepsLimit) {
+    // indexed by bytecode >> 12, refined by operator when decoding
+    static const void* const handlers[16] = {
+        &&stop,
+        &&small_immediate,
+        &&large_immediate,
+        &&load,
+        &&store,
+        &&load_indirect,
+        &&store_indirect,
+        &&unary_arithmetic,
+        &&binary_arithmetic,
+        &&jump,
+        &&conditional_branch,
+        &&fallback,  // emit
+        &&fallback,  // native call
+        &&sub_call,
+        &&sub_ret,
+        &&fallback  // unknown
+    };
+    AsebaVMThreadedInstruction* const code = vm->threadedCode;
+    uint16_t* const bytecode = vm->bytecode;
+    int16_t* const variables = vm->variables;
+    int16_t* const stack = vm->stack;
+    uint16_t pc = vm->pc;
+    int16_t sp = vm->sp;
+    uint32_t stepsLeft = stepsLimit;
+    int16_t valueOne, valueTwo;
+
+    AsebaMaskSet(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
+    if(AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK))
+        goto done;
+
+decode:
+    if(!vm->threadedCodeValid) {
+        uint16_t i;
+        for(i = 0; i < vm->bytecodeSize; i++) {
+            const uint16_t word = bytecode[i];
+            const uint16_t op = word & ASEBA_BINARY_OPERATOR_MASK;
+            code[i].handler = handlers[word >> 12];
+            code[i].operand = word & 0x0fff;
+            switch(word >> 12) {
+                case ASEBA_BYTECODE_SMALL_IMMEDIATE:
+                case ASEBA_BYTECODE_JUMP: code[i].operand = ((int16_t)(word << 4)) >> 4; break;
+                case ASEBA_BYTECODE_UNARY_ARITHMETIC:
+                    code[i].operand = word & ASEBA_UNARY_OPERATOR_MASK;
+                    if(code[i].operand > ASEBA_UNARY_OP_BIT_NOT)
+                        code[i].handler = &&fallback;
+                    break;
+                case ASEBA_BYTECODE_BINARY_ARITHMETIC:
+                    code[i].operand = op;
+                    if(op == ASEBA_OP_DIV || op == ASEBA_OP_MOD)
+                        code[i].handler = &&binary_arithmetic_division;
+                    else if(op > ASEBA_OP_AND)
+                        code[i].handler = &&fallback;
+                    break;
+                case ASEBA_BYTECODE_CONDITIONAL_BRANCH:
+                    // the was-true bit changes during execution, so it is read from bytecode
+                    code[i].operand = op;
+                    if(op == ASEBA_OP_DIV || op == ASEBA_OP_MOD)
+                        code[i].handler = &&conditional_branch_division;
+                    else if(op > ASEBA_OP_AND)
+                        code[i].handler = &&fallback;
+                    break;
+                default: break;
+            }
+        }
+        // fuse sequences, looking ahead at entries not yet overwritten,
+        // but never over a breakpoint as the superinstruction would skip it
+        for(i = 0; i + 1 < vm->bytecodeSize; i++) {
+            const void* const first = code[i].handler;
+            const void* const second = code[i + 1].breakpoint ? NULL : code[i + 1].handler;
+            const void* const third =
+                i + 2 < vm->bytecodeSize && !code[i + 2].breakpoint ? code[i + 2].handler : NULL;
+            const void* const fourth =
+                i + 3 < vm->bytecodeSize && !code[i + 3].breakpoint ? code[i + 3].handler : NULL;
+            if(first == &&small_immediate && second == &&store)
+                code[i].handler = &&immediate_store;
+            else if(first == &&load && second == &&load && third == &&binary_arithmetic && fourth == &&store)
+                code[i].handler = &&load_load_op_store;
+            else if(first == &&load && second == &&small_immediate && third == &&binary_arithmetic &&
+                    fourth == &&store)
+                code[i].handler = &&load_immediate_op_store;
+            else if(first == &&load && second == &&load && third == &&conditional_branch)
+                code[i].handler = &&load_load_branch;
+            else if(first == &&load && second == &&small_immediate && third == &&conditional_branch)
+                code[i].handler = &&load_immediate_branch;
+        }
+        // trap on breakpoints, once the entries they replace are not needed any more
+        if(vm->breakpointsCount) {
+            for(i = 0; i < vm->bytecodeSize; i++)
+                if(code[i].breakpoint)
+                    code[i].handler = &&breakpoint;
+        }
+        vm->threadedCodeValid = 1;
+    }
+    goto* code[pc].handler;
+
+stop:
+    AsebaMaskClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK);
+    goto done;
+
+small_immediate:
+    THREADED_ASSERT(sp + 1 >= vm->stackSize);
+    stack[++sp] = code[pc].operand;
+    pc++;
+    THREADED_NEXT();
+
+large_immediate:
+    THREADED_ASSERT(sp + 1 >= vm->stackSize);
+    stack[++sp] = bytecode[pc + 1];
+    pc += 2;
+    THREADED_NEXT();
+
+load:
+    THREADED_ASSERT(sp + 1 >= vm->stackSize);
+    THREADED_ASSERT((uint16_t)code[pc].operand >= vm->variablesSize);
+    stack[++sp] = variables[code[pc].operand];
+    pc++;
+    THREADED_NEXT();
+
+store:
+    THREADED_ASSERT(sp < 0);
+    THREADED_ASSERT((uint16_t)code[pc].operand >= vm->variablesSize);
+    variables[code[pc].operand] = stack[sp--];
+    pc++;
+    THREADED_NEXT();
+
+load_indirect: {
+    const uint16_t arraySize = bytecode[pc + 1];
+    uint16_t variableIndex;
+    THREADED_ASSERT(sp < 0);
+    variableIndex = stack[sp];
+    if(variableIndex >= arraySize)
+        goto fallback;
+    stack[sp] = variables[code[pc].operand + variableIndex];
+    pc += 2;
+    THREADED_NEXT();
+}
+
+store_indirect: {
+    const uint16_t arraySize = bytecode[pc + 1];
+    uint16_t variableIndex;
+    THREADED_ASSERT(sp < 1);
+    variableIndex = (uint16_t)stack[sp];
+    if(variableIndex >= arraySize)
+        goto fallback;
+    variables[code[pc].operand + variableIndex] = stack[sp - 1];
+    sp -= 2;
+    pc += 2;
+    THREADED_NEXT();
+}
+
+unary_arithmetic:
+    THREADED_ASSERT(sp < 0);
+    stack[sp] = AsebaVMDoUnaryOperation(vm, stack[sp], code[pc].operand);
+    pc++;
+    THREADED_NEXT();
+
+binary_arithmetic_division:
+    THREADED_ASSERT(sp < 1);
+    if(stack[sp] == 0)
+        goto fallback;
+binary_arithmetic:
+    THREADED_ASSERT(sp < 1);
+    stack[sp - 1] = AsebaVMDoBinaryOperation(vm, stack[sp - 1], stack[sp], code[pc].operand);
+    sp--;
+    pc++;
+    THREADED_NEXT();
+
+jump:
+    THREADED_ASSERT((pc + code[pc].operand < 0) || (pc + code[pc].operand >= vm->bytecodeSize));
+    pc += code[pc].operand;
+    THREADED_NEXT();
+
+conditional_branch_division:
+    THREADED_ASSERT(sp < 1);
+    if(stack[sp] == 0)
+        goto fallback;
+conditional_branch: {
+    int16_t conditionResult;
+    int16_t disp;
+    THREADED_ASSERT(sp < 1);
+    conditionResult = AsebaVMDoBinaryOperation(vm, stack[sp - 1], stack[sp], code[pc].operand);
+    if(conditionResult &&
+       !(GET_BIT(bytecode[pc], ASEBA_IF_IS_WHEN_BIT) && GET_BIT(bytecode[pc], ASEBA_IF_WAS_TRUE_BIT)))
+        disp = 2;
+    else
+        disp = (int16_t)bytecode[pc + 1];
+    THREADED_ASSERT((pc + disp < 0) || (pc + disp >= vm->bytecodeSize));
+    sp -= 2;
+    if(conditionResult)
+        BIT_SET(bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);
+    else
+        BIT_CLR(bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);
+    pc += disp;
+    THREADED_NEXT();
+}
+
+sub_call:
+    THREADED_ASSERT(sp + 1 >= vm->stackSize);
+    stack[++sp] = pc + 1;
+    pc = code[pc].operand;
+    THREADED_NEXT();
+
+sub_ret:
+    THREADED_ASSERT(sp < 0);
+    pc = stack[sp--];
+    THREADED_NEXT();
+
+immediate_store:
+    // SMALL_IMMEDIATE value; STORE dest
+    THREADED_FUSED_FITS(2);
+    THREADED_ASSERT(sp + 1 >= vm->stackSize || sp + 1 < 0 || (uint16_t)code[pc + 1].operand >= vm->variablesSize);
+    stack[sp + 1] = code[pc].operand;
+    variables[code[pc + 1].operand] = code[pc].operand;
+    pc += 2;
+    THREADED_FUSED_NEXT(2);
+
+load_load_op_store:
+    // LOAD source; LOAD source; BINARY_ARITHMETIC op; STORE dest
+    THREADED_FUSED_FITS(4);
+    THREADED_ASSERT(sp + 2 >= vm->stackSize || sp + 1 < 0 || (uint16_t)code[pc].operand >= vm->variablesSize ||
+                    (uint16_t)code[pc + 1].operand >= vm->variablesSize ||
+                    (uint16_t)code[pc + 3].operand >= vm->variablesSize);
+    valueTwo = variables[code[pc + 1].operand];
+    goto fused_op_store;
+
+load_immediate_op_store:
+    // LOAD source; SMALL_IMMEDIATE value; BINARY_ARITHMETIC op; STORE dest
+    THREADED_FUSED_FITS(4);
+    THREADED_ASSERT(sp + 2 >= vm->stackSize || sp + 1 < 0 || (uint16_t)code[pc].operand >= vm->variablesSize ||
+                    (uint16_t)code[pc + 3].operand >= vm->variablesSize);
+    valueTwo = code[pc + 1].operand;
+fused_op_store:
+    // leave the stack as the individual instructions would have
+    valueOne = variables[code[pc].operand];
+    stack[sp + 1] = AsebaVMDoBinaryOperation(vm, valueOne, valueTwo, code[pc + 2].operand);
+    stack[sp + 2] = valueTwo;
+    variables[code[pc + 3].operand] = stack[sp + 1];
+    pc += 4;
+    THREADED_FUSED_NEXT(4);
+
+load_load_branch:
+    // LOAD source; LOAD source; CONDITIONAL_BRANCH op
+    THREADED_FUSED_FITS(3);
+    THREADED_ASSERT(sp + 2 >= vm->stackSize || sp + 1 < 0 || (uint16_t)code[pc].operand >= vm->variablesSize ||
+                    (uint16_t)code[pc + 1].operand >= vm->variablesSize);
+    valueTwo = variables[code[pc + 1].operand];
+    goto fused_branch;
+
+load_immediate_branch:
+    // LOAD source; SMALL_IMMEDIATE value; CONDITIONAL_BRANCH op
+    THREADED_FUSED_FITS(3);
+    THREADED_ASSERT(sp + 2 >= vm->stackSize || sp + 1 < 0 || (uint16_t)code[pc].operand >= vm->variablesSize);
+    valueTwo = code[pc + 1].operand;
+fused_branch: {
+    const uint16_t branch = pc + 2;
+    int16_t conditionResult;
+    int16_t disp;
+    valueOne = variables[code[pc].operand];
+    conditionResult = AsebaVMDoBinaryOperation(vm, valueOne, valueTwo, code[branch].operand);
+    if(conditionResult &&
+       !(GET_BIT(bytecode[branch], ASEBA_IF_IS_WHEN_BIT) && GET_BIT(bytecode[branch], ASEBA_IF_WAS_TRUE_BIT)))
+        disp = 2;
+    else
+        disp = (int16_t)bytecode[branch + 1];
+    THREADED_ASSERT((branch + disp < 0) || (branch + disp >= vm->bytecodeSize));
+    stack[sp + 1] = valueOne;
+    stack[sp + 2] = valueTwo;
+    if(conditionResult)
+        BIT_SET(bytecode[branch], ASEBA_IF_WAS_TRUE_BIT);
+    else
+        BIT_CLR(bytecode[branch], ASEBA_IF_WAS_TRUE_BIT);
+    pc = branch + disp;
+    THREADED_FUSED_NEXT(3);
+}
+
+breakpoint:
+    // as AsebaDebugBreakpointRun, stop before the instruction and leave the running mask set
+    vm->pc = pc;
+    vm->sp = sp;
+    AsebaMaskSet(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK);
+    AsebaVMSendExecutionStateChanged(vm);
+    return;
+
+fallback:
+    // let the switch interpreter execute this instruction, then resynchronize
+    vm->pc = pc;
+    vm->sp = sp;
+    AsebaVMStep(vm);
+    pc = vm->pc;
+    sp = vm->sp;
+    if(AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK) ||
+       AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK))
+        goto done;
+    if(--stepsLeft == 0 && stepsLimit != 0)
+        goto done;
+    goto decode;
+
+done:
+    vm->pc = pc;
+    vm->sp = sp;
+    AsebaMaskClear(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
+}
+
+#    undef THREADED_FUSED_NEXT
+#    undef THREADED_FUSED_FITS
+#    undef THREADED_NEXT
+#    undef THREADED_ASSERT
+
+#endif  // ASEBA_VM_THREADED_DISPATCH
+
 /*! Run without support of breakpoints.
     Check ASEBA_VM_EVENT_RUNNING_MASK to exit on interrupts or stepsLimit if > 0. */
 void AsebaDebugBareRun(AsebaVMState* vm, uint16_t stepsLimit) {
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    if(vm->threadedCode) {
+        AsebaVMThreadedRun(vm, stepsLimit);
+        return;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
+
     AsebaMaskSet(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
 
     if(stepsLimit > 0) {
@@ -544,6 +925,13 @@ void AsebaDebugBareRun(AsebaVMState* vm, uint16_t stepsLimit) {
 /*! Run with support of breakpoints.
     Also check ASEBA_VM_EVENT_RUNNING_MASK to exit on interrupts. */
 void AsebaDebugBreakpointRun(AsebaVMState* vm, uint16_t stepsLimit) {
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    if(vm->threadedCode) {
+        AsebaVMThreadedRun(vm, stepsLimit);
+        return;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
+
     AsebaMaskSet(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
 
     if(stepsLimit > 0) {
@@ -601,6 +989,20 @@ uint8_t AsebaVMSetBreakpoint(AsebaVMState* vm, uint16_t pc) {
         AsebaAssert(vm, ASEBA_ASSERT_BREAKPOINT_OUT_OF_BYTECODE_BOUNDS);
 #endif
 
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    // one trap per address, as many as there are addresses
+    if(vm->threadedCode) {
+        if(pc >= vm->bytecodeSize)
+            return 0;
+        if(!vm->threadedCode[pc].breakpoint) {
+            vm->threadedCode[pc].breakpoint = 1;
+            vm->breakpointsCount++;
+            vm->threadedCodeValid = 0;
+        }
+        return 1;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
+
     if(vm->breakpointsCount < ASEBA_MAX_BREAKPOINTS) {
         vm->breakpoints[vm->breakpointsCount++] = pc;
         return 1;
@@ -611,6 +1013,16 @@ uint8_t AsebaVMSetBreakpoint(AsebaVMState* vm, uint16_t pc) {
 /*! Clear the breakpoint at a specific location. */
 uint16_t AsebaVMClearBreakpoint(AsebaVMState* vm, uint16_t pc) {
     uint16_t i;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    if(vm->threadedCode) {
+        if(pc >= vm->bytecodeSize || !vm->threadedCode[pc].breakpoint)
+            return 0;
+        vm->threadedCode[pc].breakpoint = 0;
+        vm->breakpointsCount--;
+        vm->threadedCodeValid = 0;
+        return 1;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
     for(i = 0; i < vm->breakpointsCount; i++) {
         if(vm->breakpoints[i] == pc) {
             uint16_t j;
@@ -626,6 +1038,14 @@ uint16_t AsebaVMClearBreakpoint(AsebaVMState* vm, uint16_t pc) {
 
 /*! Clear all breakpoints. */
 void AsebaVMClearBreakpoints(AsebaVMState* vm) {
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    if(vm->threadedCode && vm->breakpointsCount) {
+        uint16_t i;
+        for(i = 0; i < vm->bytecodeSize; i++)
+            vm->threadedCode[i].breakpoint = 0;
+        vm->threadedCodeValid = 0;
+    }
+#endif  // ASEBA_VM_THREADED_DISPATCH
     vm->breakpointsCount = 0;
 }
 
@@ -717,6 +1137,10 @@ void AsebaVMDebugMessage(AsebaVMState* vm, uint16_t id, uint16_t* data, uint16_t
 #endif
             for(i = 0; i < length; i++)
                 vm->bytecode[start + i] = bswap16(data[i + 1]);
+#ifdef ASEBA_VM_THREADED_DISPATCH
+            // threaded code will be decoded again on next run
+            vm->threadedCodeValid = 0;
+#endif
         }
             // There is no break here because we want to do a reset after a set bytecode
             ASEBA_FALLTHROUGH;
@@ -51,9 +51,19 @@ else
 /*@{*/
 
 enum {
-    ASEBA_MAX_BREAKPOINTS = 16  //!< maximum number of simultaneous breakpoints the target supports
+    ASEBA_MAX_BREAKPOINTS = 16  //!< maximum number of simultaneous breakpoints the target supports, unless they are stored in threadedCode
 };
 
+#ifdef ASEBA_VM_THREADED_DISPATCH
+/*! Pre-decoded form of one bytecode word, used by the threaded dispatch engine.
+    Only available on hosts, when built with ASEBA_VM_THREADED_DISPATCH. */
+typedef struct {
+    const void* handler; /*!< address of the code executing this word as an instruction */
+    int16_t operand;     /*!< immediate value, variable address, displacement or operator of the instruction */
+    uint16_t breakpoint; /*!< non-zero if a breakpoint is set at this address */
+} AsebaVMThreadedInstruction;
+#endif  // ASEBA_VM_THREADED_DISPATCH
+
 /*! This structure contains the state of the Aseba VM.
     This is the required and the sufficient data for the VM to run.
     This is not sufficient for the compiler to build bytecode, as there is
@@ -63,6 +73,12 @@ enum {
     ALL fields of this structure have to be initialized correctly for
     aseba to work. An initial call to AsebaVMInitStep must be done prior
     to any call to AsebaVMPeriodicStep or AsebaVMEventStep.
+    When built with ASEBA_VM_THREADED_DISPATCH, threadedCode must either be
+    NULL or point to bytecodeSize entries; it is decoded lazily from bytecode
+    whenever the latter was modified through AsebaVMInit or SetBytecode.
+    Glue code writing to bytecode directly must reset threadedCodeValid.
+    In that case breakpoints are stored in threadedCode as traps, so there
+    is no limit on their number and they cost nothing until hit.
 */
 typedef struct {
     // node id
@@ -87,8 +103,14 @@ typedef struct {
     int16_t sp;
 
     // breakpoint
-    uint16_t breakpoints[ASEBA_MAX_BREAKPOINTS];
+    uint16_t breakpoints[ASEBA_MAX_BREAKPOINTS]; /*!< breakpoint addresses, unused if stored in threadedCode */
     uint16_t breakpointsCount;
+
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    // threaded code
+    AsebaVMThreadedInstruction* threadedCode; /*!< pre-decoded bytecode of size bytecodeSize, or NULL to use the switch interpreter */
+    uint16_t threadedCodeValid;               /*!< 0 if bytecode changed since threadedCode was last decoded */
+#endif  // ASEBA_VM_THREADED_DISPATCH
 } AsebaVMState;
 
 // Macros to work with masks
@@ -131,6 +153,15 @@ uint16_t AsebaVMRun(AsebaVMState* vm, uint16_t stepsLimit);
     dataLength is given in number of uint16_t. */
 void AsebaVMDebugMessage(AsebaVMState* vm, uint16_t id, uint16_t* data, uint16_t dataLength);
 
+/*! Set a breakpoint at pc, return 1 on success, 0 if no more breakpoints are available. */
+uint8_t AsebaVMSetBreakpoint(AsebaVMState* vm, uint16_t pc);
+
+/*! Clear the breakpoint at pc, return 1 if there was one. */
+uint16_t AsebaVMClearBreakpoint(AsebaVMState* vm, uint16_t pc);
+
+/*! Clear all breakpoints, for instance when the debugger disconnects. */
+void AsebaVMClearBreakpoints(AsebaVMState* vm);
+
 /*! Can be called by glue code (including native functions), to stop vm and emit a node specific
  * error */
 void AsebaVMEmitNodeSpecificError(AsebaVMState* vm, const char* message);
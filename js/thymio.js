@@ -77,6 +77,7 @@ export class Node {
         this._on_vars_changed_cb = undefined;
         this._on_events_cb = undefined;
         this._monitoring_flags = 0
+        this._variables_update_period = 0
     }
 
     /** return the node id*/
@@ -238,6 +239,22 @@ export class Node {
         this._on_vars_changed_cb = cb;
     }
 
+    /** Period in milliseconds at which the variables are refreshed while watched,
+     *  0 to let the device manager choose
+     */
+    get variables_update_period() {
+        return this._variables_update_period;
+    }
+
+    set variables_update_period(period) {
+        if(period != this._variables_update_period) {
+            this._variables_update_period = period
+            if(this._monitoring_flags & mobsya.fb.WatchableInfo.Variables) {
+                this._client.watch(this._id, this._monitoring_flags, this._variables_update_period)
+            }
+        }
+    }
+
     get on_events() {
         return this._on_events_cb;
     }
@@ -274,7 +291,7 @@ export class Node {
             this._monitoring_flags &= ~flag
 
         if(old != this._monitoring_flags) {
-            this._client.watch(this._id, this._monitoring_flags)
+            this._client.watch(this._id, this._monitoring_flags, this._variables_update_period)
         }
     }
 }
@@ -603,7 +620,7 @@ export class Client {
         return this._prepare_request(req_id)
     }
 
-    watch(id, monitoring_flags) {
+    watch(id, monitoring_flags, variables_update_period = 0) {
         let builder = new flatbuffers.Builder();
         let req_id  = this._gen_request_id()
         const nodeOffset = this._create_node_id(builder, id)
@@ -611,6 +628,7 @@ export class Client {
         mobsya.fb.WatchNode.addRequestId(builder, req_id)
         mobsya.fb.WatchNode.addNodeId(builder, nodeOffset)
         mobsya.fb.WatchNode.addInfoType(builder, monitoring_flags)
+        mobsya.fb.WatchNode.addVariablesUpdatePeriod(builder, variables_update_period)
         let offset = mobsya.fb.WatchNode.endWatchNode(builder)
         this._wrap_message_and_send(builder, offset, mobsya.fb.AnyMessage.WatchNode)
         return this._prepare_request(req_id)
@@ -4146,11 +4146,34 @@ mobsya.fb.WatchNode.prototype.mutate_info_type = function(value) {
   return true;
 };
 
+/**
+ * @returns {number}
+ */
+mobsya.fb.WatchNode.prototype.variablesUpdatePeriod = function() {
+  var offset = this.bb.__offset(this.bb_pos, 10);
+  return offset ? this.bb.readUint32(this.bb_pos + offset) : 0;
+};
+
+/**
+ * @param {number} value
+ * @returns {boolean}
+ */
+mobsya.fb.WatchNode.prototype.mutate_variables_update_period = function(value) {
+  var offset = this.bb.__offset(this.bb_pos, 10);
+
+  if (offset === 0) {
+    return false;
+  }
+
+  this.bb.writeUint32(this.bb_pos + offset, value);
+  return true;
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  */
 mobsya.fb.WatchNode.startWatchNode = function(builder) {
-  builder.startObject(3);
+  builder.startObject(4);
 };
 
 /**
@@ -4177,6 +4200,14 @@ mobsya.fb.WatchNode.addInfoType = function(builder, infoType) {
   builder.addFieldInt32(2, infoType, 0);
 };
 
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} variablesUpdatePeriod
+ */
+mobsya.fb.WatchNode.addVariablesUpdatePeriod = function(builder, variablesUpdatePeriod) {
+  builder.addFieldInt32(3, variablesUpdatePeriod, 0);
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  * @returns {flatbuffers.Offset}
@@ -0,0 +1,201 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measure how many programs per second the compiler processes, as Studio or the device manager
+// recompiling a program on each edit: the same compiler compiles all the sources in turn, those
+// failing to compile included.
+// With --incremental, each source is followed by an edited version with a line inserted in its
+// middle, compiled by an incremental compiler; the results are first checked against the ones of
+// complete compilations.
+
+// Aseba
+#include "compiler/compiler.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+#include "common/utils/utils.h"
+using namespace Aseba;
+
+// C++
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+// C
+#include <stdlib.h>  // exit()
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+// same target and definitions as asebatest, so that the compiler test data compile
+static TargetDescription describe() {
+    TargetDescription d;
+    d.name = L"benchcompiler";
+    d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+    d.bytecodeSize = 512;
+    d.variablesSize = 256;
+    d.stackSize = 64;
+
+    for(const AsebaNativeFunctionDescription* const* nativeDescs = nativeFunctionsDescriptions; *nativeDescs;
+        ++nativeDescs) {
+        const std::string name((*nativeDescs)->name);
+        const std::string doc((*nativeDescs)->doc);
+        TargetDescription::NativeFunction native{std::wstring(name.begin(), name.end()),
+                                                 std::wstring(doc.begin(), doc.end())};
+        for(const AsebaNativeFunctionArgumentDescription* param = (*nativeDescs)->arguments; param->size; ++param) {
+            const std::string paramName(param->name);
+            native.parameters.push_back(TargetDescription::NativeFunctionParameter(
+                std::wstring(paramName.begin(), paramName.end()), param->size));
+        }
+        d.nativeFunctions.push_back(native);
+    }
+
+    TargetDescription::LocalEvent testLocalEvent;
+    testLocalEvent.name = L"test";
+    testLocalEvent.description = L"test local event";
+    d.localEvents.push_back(testLocalEvent);
+    return d;
+}
+
+static std::wstring readSource(const std::string& filename) {
+    std::ifstream ifs(filename.c_str(), std::ifstream::binary);
+    if(!ifs.is_open()) {
+        std::cerr << "Error opening source file " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return UTF8ToWString(oss.str());
+}
+
+// Return source with an empty line inserted at the end of the line in its middle
+static std::wstring editSource(const std::wstring& source) {
+    const size_t lineEnd(source.find(L'\n', source.size() / 2));
+    if(lineEnd == std::wstring::npos)
+        return source + L"\n";
+    return source.substr(0, lineEnd) + L"\n" + source.substr(lineEnd);
+}
+
+struct Compilation {
+    bool success;
+    BytecodeVector bytecode;
+    unsigned varCount;
+    Error error;
+};
+
+static Compilation compile(Compiler& compiler, const std::wstring& source) {
+    Compilation compilation;
+    std::wistringstream stream(source);
+    compilation.success = compiler.compile(stream, compilation.bytecode, compilation.varCount, compilation.error);
+    return compilation;
+}
+
+static bool sameCompilation(const Compilation& lhs, const Compilation& rhs) {
+    if(lhs.success != rhs.success)
+        return false;
+    if(!lhs.success)
+        return lhs.error.message == rhs.error.message && lhs.error.pos.character == rhs.error.pos.character;
+    if(lhs.varCount != rhs.varCount || lhs.bytecode.size() != rhs.bytecode.size())
+        return false;
+    for(size_t i = 0; i < lhs.bytecode.size(); ++i)
+        if(lhs.bytecode[i].bytecode != rhs.bytecode[i].bytecode || lhs.bytecode[i].line != rhs.bytecode[i].line)
+            return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned iterations = 100;
+    bool incremental = false;
+    int firstFile = 1;
+    for(; firstFile < argc; ++firstFile) {
+        const std::string arg(argv[firstFile]);
+        if(arg == "--iterations" && firstFile + 1 < argc)
+            iterations = atoi(argv[++firstFile]);
+        else if(arg == "--incremental")
+            incremental = true;
+        else
+            break;
+    }
+    if(firstFile >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] [--incremental] source..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::wstring> sources;
+    size_t sourcesSize = 0;
+    for(int i = firstFile; i < argc; ++i) {
+        sources.push_back(readSource(argv[i]));
+        sourcesSize += sources.back().size();
+        if(incremental) {
+            sources.push_back(editSource(sources.back()));
+            sourcesSize += sources.back().size();
+        }
+    }
+
+    const TargetDescription description(describe());
+    CommonDefinitions definitions;
+    definitions.events.push_back(NamedValue(L"event1", 0));
+    definitions.events.push_back(NamedValue(L"event2", 3));
+    definitions.constants.push_back(NamedValue(L"FOO", 2));
+
+    Compiler compiler;
+    compiler.setTargetDescription(&description);
+    compiler.setCommonDefinitions(&definitions);
+    compiler.setIncrementalCompilation(incremental);
+
+    if(incremental) {
+        Compiler reference;
+        reference.setTargetDescription(&description);
+        reference.setCommonDefinitions(&definitions);
+        for(size_t i = 0; i < sources.size(); ++i) {
+            // each source twice, the second time reusing all it can
+            for(unsigned pass = 0; pass < 2; ++pass) {
+                if(!sameCompilation(compile(compiler, sources[i]), compile(reference, sources[i]))) {
+                    std::cerr << "Incremental compilation differs for " << argv[firstFile + i / 2]
+                              << (i % 2 ? " (edited)" : "") << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    unsigned compiled = 0;
+    unsigned reusedBlocks = 0;
+    const auto start(std::chrono::steady_clock::now());
+    for(unsigned iteration = 0; iteration < iterations; ++iteration) {
+        for(const auto& source : sources) {
+            if(compile(compiler, source).success)
+                ++compiled;
+            reusedBlocks += compiler.getReusedBlocksCount();
+        }
+    }
+    const double duration(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    const double programs(double(sources.size()) * iterations);
+    std::cout << sources.size() << " programs (" << compiled / iterations << " compiling), " << iterations
+              << " iterations in " << std::fixed << std::setprecision(3) << duration << " s" << std::endl;
+    std::cout << std::setprecision(0) << programs / duration << " programs/s, " << std::setprecision(1)
+              << double(sourcesSize) * iterations / duration / 1e6 << " M characters/s" << std::endl;
+    if(incremental)
+        std::cout << double(reusedBlocks) / programs << " events and subroutines reused per program" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that incremental compilation only recompiles the events and subroutines that changed, and
+// gives the same results as complete compilation.
+// By default, each event and subroutine of the source, which must declare a variable named counter,
+// is edited in turn, by inserting a statement at its beginning: all the other events and subroutines
+// must be reused.
+// With --random-edits N, each source is edited N times by randomly removing, duplicating, swapping
+// and changing lines, the results being compared to the ones of complete compilations.
+
+// Aseba
+#include "compiler/compiler.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+#include "common/utils/utils.h"
+using namespace Aseba;
+
+// C++
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+
+// C
+#include <stdlib.h>  // exit()
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+// same target and definitions as asebatest, so that the compiler test data compile
+static TargetDescription describe() {
+    TargetDescription d;
+    d.name = L"testincremental";
+    d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+    d.bytecodeSize = 512;
+    d.variablesSize = 256;
+    d.stackSize = 64;
+
+    for(const AsebaNativeFunctionDescription* const* nativeDescs = nativeFunctionsDescriptions; *nativeDescs;
+        ++nativeDescs) {
+        const std::string name((*nativeDescs)->name);
+        const std::string doc((*nativeDescs)->doc);
+        TargetDescription::NativeFunction native{std::wstring(name.begin(), name.end()),
+                                                 std::wstring(doc.begin(), doc.end())};
+        for(const AsebaNativeFunctionArgumentDescription* param = (*nativeDescs)->arguments; param->size; ++param) {
+            const std::string paramName(param->name);
+            native.parameters.push_back(TargetDescription::NativeFunctionParameter(
+                std::wstring(paramName.begin(), paramName.end()), param->size));
+        }
+        d.nativeFunctions.push_back(native);
+    }
+
+    TargetDescription::LocalEvent testLocalEvent;
+    testLocalEvent.name = L"test";
+    testLocalEvent.description = L"test local event";
+    d.localEvents.push_back(testLocalEvent);
+    return d;
+}
+
+static std::vector<std::wstring> readLines(const std::string& filename) {
+    std::ifstream ifs(filename.c_str(), std::ifstream::binary);
+    if(!ifs.is_open()) {
+        std::cerr << "Error opening source file " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    const std::wstring source(UTF8ToWString(oss.str()));
+
+    std::vector<std::wstring> lines;
+    size_t lineBegin(0);
+    for(size_t lineEnd = source.find(L'\n'); lineEnd != std::wstring::npos; lineEnd = source.find(L'\n', lineBegin)) {
+        lines.push_back(source.substr(lineBegin, lineEnd - lineBegin));
+        lineBegin = lineEnd + 1;
+    }
+    lines.push_back(source.substr(lineBegin));
+    return lines;
+}
+
+static std::wstring join(const std::vector<std::wstring>& lines) {
+    std::wstring source;
+    for(const auto& line : lines) {
+        source += line;
+        source += L'\n';
+    }
+    return source;
+}
+
+struct Compilation {
+    bool success;
+    BytecodeVector bytecode;
+    unsigned varCount;
+    Error error;
+};
+
+static Compilation compile(Compiler& compiler, const std::vector<std::wstring>& lines) {
+    Compilation compilation;
+    std::wistringstream stream(join(lines));
+    compilation.success = compiler.compile(stream, compilation.bytecode, compilation.varCount, compilation.error);
+    return compilation;
+}
+
+static bool sameCompilation(const Compilation& lhs, const Compilation& rhs) {
+    if(lhs.success != rhs.success)
+        return false;
+    if(!lhs.success)
+        return lhs.error.message == rhs.error.message && lhs.error.pos.character == rhs.error.pos.character;
+    if(lhs.varCount != rhs.varCount || lhs.bytecode.size() != rhs.bytecode.size())
+        return false;
+    for(size_t i = 0; i < lhs.bytecode.size(); ++i)
+        if(lhs.bytecode[i].bytecode != rhs.bytecode[i].bytecode || lhs.bytecode[i].line != rhs.bytecode[i].line)
+            return false;
+    return true;
+}
+
+// Compile lines with both compilers, return whether the results are the same
+static bool check(Compiler& compiler, Compiler& reference, const std::vector<std::wstring>& lines,
+                  const std::string& what) {
+    const Compilation compilation(compile(compiler, lines));
+    if(!sameCompilation(compilation, compile(reference, lines))) {
+        std::cerr << "Incremental compilation differs from complete compilation " << what << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool isBlockDeclaration(const std::wstring& line) {
+    return line.compare(0, 8, L"onevent ") == 0 || line.compare(0, 4, L"sub ") == 0;
+}
+
+static bool editBlocks(Compiler& compiler, Compiler& reference, const std::string& filename) {
+    const std::vector<std::wstring> lines(readLines(filename));
+    std::vector<size_t> declarations;
+    for(size_t i = 0; i < lines.size(); ++i)
+        if(isBlockDeclaration(lines[i]))
+            declarations.push_back(i);
+    if(declarations.size() < 2) {
+        std::cerr << filename << " must have several events and subroutines" << std::endl;
+        return false;
+    }
+    const unsigned blocksCount(declarations.size());
+
+    if(!compile(compiler, lines).success) {
+        std::cerr << filename << " does not compile" << std::endl;
+        return false;
+    }
+    if(!check(compiler, reference, lines, "when recompiling " + filename))
+        return false;
+    if(compiler.getReusedBlocksCount() != blocksCount) {
+        std::cerr << "Recompiling " << filename << " reused " << compiler.getReusedBlocksCount() << " of "
+                  << blocksCount << " events and subroutines" << std::endl;
+        return false;
+    }
+
+    for(const size_t declaration : declarations) {
+        // all the following blocks move down by one line
+        std::vector<std::wstring> edited(lines);
+        edited.insert(edited.begin() + declaration + 1, L"\tcounter++");
+        const std::string what("after editing line " + std::to_string(declaration + 1) + " of " + filename);
+        if(!check(compiler, reference, edited, what))
+            return false;
+        if(compiler.getReusedBlocksCount() != blocksCount - 1) {
+            std::cerr << "Reused " << compiler.getReusedBlocksCount() << " of " << blocksCount - 1
+                      << " unchanged events and subroutines " << what << std::endl;
+            return false;
+        }
+        // and back
+        if(!check(compiler, reference, lines, "when undoing the edit of line " + std::to_string(declaration + 1) +
+                                                  " of " + filename))
+            return false;
+        if(compiler.getReusedBlocksCount() != blocksCount - 1) {
+            std::cerr << "Undoing the edit of line " << declaration + 1 << " of " << filename << " reused "
+                      << compiler.getReusedBlocksCount() << " events and subroutines" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool editRandomly(Compiler& compiler, Compiler& reference, const std::string& filename, unsigned edits) {
+    const std::vector<std::wstring> original(readLines(filename));
+    // deterministic, so that failures can be reproduced
+    std::mt19937 random(1);
+    std::vector<std::wstring> lines(original);
+    for(unsigned edit = 0; edit < edits; ++edit) {
+        const size_t line(random() % lines.size());
+        switch(random() % 6) {
+            case 0:
+                if(lines.size() > 1)
+                    lines.erase(lines.begin() + line);
+                break;
+            case 1: lines.insert(lines.begin() + line, original[random() % original.size()]); break;
+            case 2: lines.insert(lines.begin() + line, L""); break;
+            case 3: std::swap(lines[line], lines[random() % lines.size()]); break;
+            case 4: lines = original; break;
+            default: lines[line] += L" "; break;
+        }
+        if(!check(compiler, reference, lines, "after " + std::to_string(edit + 1) + " random edits of " + filename))
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned randomEdits = 0;
+    int firstFile = 1;
+    if(firstFile + 1 < argc && std::string(argv[firstFile]) == "--random-edits") {
+        randomEdits = atoi(argv[firstFile + 1]);
+        firstFile += 2;
+    }
+    if(firstFile >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--random-edits N] source..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const TargetDescription description(describe());
+    CommonDefinitions definitions;
+    definitions.events.push_back(NamedValue(L"event1", 0));
+    definitions.events.push_back(NamedValue(L"event2", 3));
+    definitions.constants.push_back(NamedValue(L"FOO", 2));
+
+    Compiler compiler;
+    compiler.setTargetDescription(&description);
+    compiler.setCommonDefinitions(&definitions);
+    compiler.setIncrementalCompilation(true);
+
+    Compiler reference;
+    reference.setTargetDescription(&description);
+    reference.setCommonDefinitions(&definitions);
+
+    for(int i = firstFile; i < argc; ++i) {
+        const bool success(randomEdits ? editRandomly(compiler, reference, argv[i], randomEdits) :
+                                         editBlocks(compiler, reference, argv[i]));
+        if(!success)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -19,6 +19,7 @@ using namespace Aseba;
 // C
 #include <getopt.h>  // getopt_long()
 #include <stdlib.h>  // exit()
+#include <string.h>  // strcmp()
 
 // defines
 #define DEFAULT_STEPS 1000
@@ -35,14 +36,16 @@ extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsD
 std::wstring read_source(const std::string& filename);
 void dump_source(const std::wstring& source);
 
-static const char short_options[] = "fcepnvsdumi:";
+static const char short_options[] = "fcepnvsdumi:l:to:";
 static const struct option long_options[] = {
     {"fail", no_argument, nullptr, 'f'},        {"comp_fail", no_argument, nullptr, 'c'},
     {"exec_fail", no_argument, nullptr, 'e'},   {"post_fail", no_argument, nullptr, 'p'},
     {"memcmp_fail", no_argument, nullptr, 'n'}, {"event", no_argument, nullptr, 'v'},
     {"source", no_argument, nullptr, 's'},      {"dump", no_argument, nullptr, 'd'},
     {"memdump", no_argument, nullptr, 'u'},     {"memcmp", required_argument, nullptr, 'm'},
-    {"steps", required_argument, nullptr, 'i'}, {nullptr, 0, nullptr, 0}};
+    {"steps", required_argument, nullptr, 'i'}, {"vector-loops", required_argument, nullptr, 'l'},
+    {"stats", no_argument, nullptr, 't'},       {"peephole-saved", required_argument, nullptr, 'o'},
+    {nullptr, 0, nullptr, 0}};
 
 static void usage(int argc, char** argv) {
     std::cerr << "Usage: " << argv[0] << " [options] source" << std::endl
@@ -58,7 +61,13 @@ static void usage(int argc, char** argv) {
               << "    -d | --dump         Dump the compilation result (tokens, tree, bytecode)" << std::endl
               << "    -u | --memdump      Dump the memory content at the end of the execution" << std::endl
               << "    -m | --memcmp file  Compare result of the VM execution with file" << std::endl
-              << "    -i | --steps        Number of VM execution steps (default: " << DEFAULT_STEPS << ")" << std::endl;
+              << "    -i | --steps        Number of VM execution steps (default: " << DEFAULT_STEPS << ")" << std::endl
+              << "    -l | --vector-loops Compile assignments between vectors to loops: never (default), smaller or always"
+              << std::endl
+              << "    -t | --stats        Print the bytecode size, the number of VM steps executed and the words saved by the"
+              << std::endl
+              << "                        peephole optimizer" << std::endl
+              << "    -o | --peephole-saved words  Fail unless the peephole optimizer saved that many words" << std::endl;
 }
 
 
@@ -66,6 +75,9 @@ struct AsebaNode {
     AsebaVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED_DISPATCH
+    std::valarray<AsebaVMThreadedInstruction> threadedCode;
+#endif
     TargetDescription d;
 
     struct Variables {
@@ -78,6 +90,10 @@ struct AsebaNode {
         bytecode.resize(512);
         vm.bytecode = &bytecode[0];
         vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED_DISPATCH
+        threadedCode.resize(bytecode.size());
+        vm.threadedCode = &threadedCode[0];
+#endif
 
         stack.resize(64);
         vm.stack = &stack[0];
@@ -152,6 +168,17 @@ struct AsebaNode {
         AsebaVMRun(&vm, stepCount);
     }
 
+    //! Run one step at a time, return the number of steps executed
+    int runCounting(int stepCount) {
+        processMessage(Run(1));
+        int steps = 0;
+        while((vm.flags & ASEBA_VM_EVENT_ACTIVE_MASK) && steps < stepCount) {
+            AsebaVMRun(&vm, 1);
+            ++steps;
+        }
+        return steps;
+    }
+
     void runEvent(int stepCount) {
         // reset VM and run it with user event
         vm.flags = 0;
@@ -200,6 +227,9 @@ int main(int argc, char** argv) {
     bool memDump = false;
     bool memCmp = false;
     int stepCount = DEFAULT_STEPS;
+    Compiler::VectorLoops vectorLoops = Compiler::VectorLoops::NEVER;
+    bool stats = false;
+    int peepholeSaved = -1;
     std::string memCmpFileName;
 
     std::locale::global(std::locale(""));
@@ -236,6 +266,20 @@ int main(int argc, char** argv) {
                 memCmpFileName = optarg;
                 break;
             case 'i': stepCount = atoi(optarg); break;
+            case 'l':
+                if(strcmp(optarg, "never") == 0)
+                    vectorLoops = Compiler::VectorLoops::NEVER;
+                else if(strcmp(optarg, "smaller") == 0)
+                    vectorLoops = Compiler::VectorLoops::WHEN_SMALLER;
+                else if(strcmp(optarg, "always") == 0)
+                    vectorLoops = Compiler::VectorLoops::ALWAYS;
+                else {
+                    usage(argc, argv);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't': stats = true; break;
+            case 'o': peepholeSaved = atoi(optarg); break;
             default: usage(argc, argv); exit(EXIT_FAILURE);
         }
     }
@@ -279,6 +323,7 @@ int main(int argc, char** argv) {
     // compile
     compiler.setTargetDescription(node.getTargetDescription());
     compiler.setCommonDefinitions(&definitions);
+    compiler.setVectorLoops(vectorLoops);
     if(dump)
         compiler.compile(ifs, bytecode, varCount, outError, &(std::wcout));
     else
@@ -288,12 +333,23 @@ int main(int argc, char** argv) {
 
     checkForError("Compilation", should_compilation_fail, (outError.message != L"not defined"), outError.toWString());
 
+    if(peepholeSaved >= 0)
+        checkForError("Peephole optimization", false, int(compiler.getPeepholeSavedWords()) != peepholeSaved,
+                      WFormatableString(L"saved %0 words instead of %1")
+                          .arg(compiler.getPeepholeSavedWords())
+                          .arg(peepholeSaved));
+
     // run
     if(!node.loadBytecode(bytecode)) {
         std::cerr << "Load bytecode failure" << std::endl;
         return EXIT_FAILURE;
     }
-    node.run(stepCount);
+    if(stats) {
+        const int steps(node.runCounting(stepCount));
+        std::cout << "bytecode: " << bytecode.size() << " words, steps: " << steps
+                  << ", peephole saved: " << compiler.getPeepholeSavedWords() << " words" << std::endl;
+    } else
+        node.run(stepCount);
 
     // is execution completed?
     const bool stillExecuting(node.vm.flags & ASEBA_VM_EVENT_ACTIVE_MASK);
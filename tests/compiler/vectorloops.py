@@ -0,0 +1,56 @@
+#!/usr/bin/env python
+
+# Compare the size of the bytecode and the number of VM steps of programs, when vectorial
+# assignments are fully expanded, compiled to loops when this makes the bytecode smaller, and
+# always compiled to loops.
+# If script is a directory, use all the .txt files inside this directory
+
+from __future__ import print_function
+
+import sys
+import os
+import stat
+import glob
+import re
+import subprocess
+
+if len(sys.argv) != 3:
+    print("Wrong number of arguments.\n", file=sys.stderr)
+    print("Usage:", file=sys.stderr)
+    print("  {} asebatest_bin input_script".format(sys.argv[0]), file=sys.stderr)
+    exit(1)
+
+asebatest_bin = sys.argv[1]
+input_scripts = sys.argv[2]
+modes = ["never", "smaller", "always"]
+
+if stat.S_ISDIR(os.stat(input_scripts).st_mode):
+    input_scripts = sorted(glob.glob(os.path.join(input_scripts, "*.txt")))
+else:
+    input_scripts = [input_scripts]
+
+stats_re = re.compile(r"bytecode: (\d+) words, steps: (\d+)")
+
+def run(input_script, mode):
+    # return (bytecode size, steps), or None if the program does not compile and run
+    process = subprocess.Popen([asebatest_bin, "--stats", "--steps", "30000", "--vector-loops", mode, input_script],
+                               stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    output = process.communicate()[0].decode("utf-8", "replace")
+    match = stats_re.search(output)
+    if process.returncode != 0 or not match:
+        return None
+    return int(match.group(1)), int(match.group(2))
+
+totals = [[0, 0] for mode in modes]
+print("{:40}".format("program") + "".join(" {:>13}".format(mode) for mode in modes))
+print("{:40}".format("") + " {:>13}".format("words/steps") * len(modes))
+for input_script in input_scripts:
+    results = [run(input_script, mode) for mode in modes]
+    if None in results:
+        continue
+    for total, result in zip(totals, results):
+        total[0] += result[0]
+        total[1] += result[1]
+    if len(set(results)) > 1:
+        print("{:40}".format(os.path.basename(input_script)) + "".join(" {:>13}".format("{}/{}".format(*r)) for r in results))
+print("{:40}".format("total") + "".join(" {:>13}".format("{}/{}".format(*t)) for t in totals))
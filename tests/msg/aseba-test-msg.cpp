@@ -18,6 +18,12 @@
 */
 
 #include "common/msg/msg.h"
+#include "common/msg/MessageView.h"
+#include "common/msg/Trace.h"
+#include "common/msg/TraceIndex.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <iostream>
 #include <functional>
 
@@ -101,6 +107,149 @@ void testMessageNoInitNoFunc(Args&&... args) {
     testMessage<T>([](T&) {}, {}, args...);
 }
 
+//! Frame message m as it is sent on the wire
+vector<uint8_t> frame(const Message& m) {
+    Message::SerializationBuffer buffer;
+    m.serializeSpecific(buffer);
+    const auto len = static_cast<uint16_t>(buffer.rawData.size());
+    vector<uint8_t> data{uint8_t(len), uint8_t(len >> 8), uint8_t(m.source), uint8_t(m.source >> 8), uint8_t(m.type),
+                         uint8_t(m.type >> 8)};
+    data.insert(data.end(), buffer.rawData.begin(), buffer.rawData.end());
+    return data;
+}
+
+//! Test that views give access to the content of framed messages, and re-emit them
+void testMessageView() {
+    const auto check = [](bool condition, const char* what) {
+        if(!condition) {
+            cerr << "Message view: " << what << endl;
+            throw logic_error("Message view failed");
+        }
+    };
+
+    UserMessage user(12, VariablesDataVector{1, -2, 3});
+    user.source = 5;
+    const auto userFrame(frame(user));
+    const MessageView userView(userFrame.data(), userFrame.size());
+    check(userView.isValid(), "complete frame is invalid");
+    check(userView.frameSize() == userFrame.size(), "wrong frame size");
+    check(userView.source() == 5 && userView.type() == 12, "wrong header");
+    check(userView.isUserMessage() && !userView.isCommand(), "wrong user message kind");
+    check(userView.wordCount() == 3 && userView.word(1) == -2, "wrong payload");
+    check(userView.destination() == ASEBA_DEST_INVALID, "user message has a destination");
+    check(!MessageView(userFrame.data(), userFrame.size() - 1).isValid(), "truncated frame is valid");
+    check(!MessageView(userFrame.data(), 3).isValid(), "truncated header is valid");
+
+    unique_ptr<Message> userCopy(userView.toMessage());
+    check(*userCopy == user, "conversion changed the message");
+
+    SetVariables set(3, 10, VariablesDataVector{7, 8});
+    set.source = 1;
+    const auto setFrame(frame(set));
+    const MessageView setView(setFrame.data(), setFrame.size());
+    check(setView.isCommand() && !setView.isUserMessage(), "wrong command kind");
+    check(setView.destination() == 3, "wrong destination");
+    check(!setView.isFromNode() && !userView.isFromNode(), "wrong origin");
+
+    Variables variables;
+    variables.start = 10;
+    variables.variables = {1};
+    variables.source = 3;
+    const auto variablesFrame(frame(variables));
+    const MessageView variablesView(variablesFrame.data(), variablesFrame.size());
+    check(variablesView.isFromNode() && !variablesView.isCommand(), "wrong reply kind");
+
+    vector<uint8_t> remapped(userFrame);
+    setView.appendTo(remapped, 2, 4);
+    const MessageView remappedView(remapped.data() + userFrame.size(), remapped.size() - userFrame.size());
+    check(remappedView.source() == 2 && remappedView.destination() == 4, "remapping failed");
+    unique_ptr<Message> remappedCopy(remappedView.toMessage());
+    auto* remappedSet(dynamic_cast<SetVariables*>(remappedCopy.get()));
+    check(remappedSet && remappedSet->start == 10 && remappedSet->variables == set.variables,
+          "remapping changed the payload");
+
+    vector<uint8_t> copy;
+    userView.appendTo(copy);
+    check(copy == userFrame, "re-emitted frame differs");
+}
+
+//! Test that messages written to a trace are read back in order, and that seeking skips earlier messages
+void testTrace() {
+    const auto check = [](bool condition, const char* what) {
+        if(!condition) {
+            cerr << "Trace: " << what << endl;
+            throw logic_error("Trace failed");
+        }
+    };
+
+    const string fileName("aseba-test-msg.trace");
+    const UnifiedTime start(1000000);
+    {
+        // small chunks, so that the trace holds several of them
+        TraceWriter writer(fileName, start, 256);
+        check(writer.isOpen(), "cannot create trace");
+        for(int i = 0; i < 100; ++i) {
+            UserMessage message(uint16_t(i), VariablesDataVector(i % 5, int16_t(i)));
+            message.source = uint16_t(i % 3);
+            const auto data(frame(message));
+            writer.write(MessageView(data.data(), data.size()), start + UnifiedTime(10 * i));
+        }
+        check(writer.messagesCount() == 100, "wrong messages count");
+    }
+
+    check(TraceReader::isTrace(fileName), "trace not recognized");
+    TraceReader reader(fileName);
+    check(reader.getStartTime() == start, "wrong start time");
+
+    TraceRecord record;
+    int i = 0;
+    for(; reader.next(record); ++i) {
+        check(record.time == uint32_t(10 * i), "wrong time");
+        check(record.message.type() == i && record.message.source() == i % 3, "wrong header");
+        check(record.message.wordCount() == size_t(i % 5), "wrong payload size");
+        unique_ptr<Message> message(record.message.toMessage());
+        check(message->type == i, "wrong message");
+    }
+    check(i == 100, "wrong number of messages read");
+
+    reader.seek(555);
+    check(reader.next(record) && record.time == 560, "seeking failed");
+    reader.seek(0);
+    check(reader.next(record) && record.time == 0, "seeking to the start failed");
+    reader.seek(10000);
+    check(!reader.next(record), "seeking past the end failed");
+
+    // index the trace and query it
+    vector<uint8_t> data;
+    {
+        ifstream file(fileName, ios::binary);
+        data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+    vector<uint8_t> indexData;
+    check(TraceIndex::build(data.data(), data.size(), indexData), "cannot index trace");
+    TraceIndex index;
+    check(!index.open(indexData.data(), indexData.size(), data.size() + 1), "outdated index accepted");
+    check(index.open(indexData.data(), indexData.size(), data.size()), "cannot open index");
+    check(index.keysCount() == 100, "wrong number of keys");
+
+    TraceIndex::Query query;
+    check(index.query(query).size() == 100, "wrong number of messages");
+    query.source = 1;
+    query.from = 200;
+    query.to = 500;
+    const auto entries(index.query(query));
+    // messages 22, 25, ..., 49 come from node 1
+    check(entries.size() == 10, "wrong number of messages from node 1");
+    for(const auto& entry : entries) {
+        const auto message(TraceIndex::messageAt(data.data(), data.size(), entry.offset));
+        check(message.source() == 1 && entry.time == message.type() * 10u, "wrong message from node 1");
+    }
+    query.type = 22;
+    check(index.query(query).size() == 1, "wrong number of messages of a type from node 1");
+
+    remove(fileName.c_str());
+}
+
 int main() {
     // Test the serialization and deserialization of all messages
 
@@ -318,5 +467,8 @@ int main() {
     testMessage<Reboot>([](Reboot& m) { m.dest = 1; }, {[](Reboot& m) { m.dest = 3; }});
     testMessage<Sleep>([](Sleep& m) { m.dest = 1; }, {[](Sleep& m) { m.dest = 3; }});
 
+    testMessageView();
+    testTrace();
+
     return 0;
 }
@@ -0,0 +1,178 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measure the wall time the playground takes to simulate many Thymios running a busy program,
+// depending on the number of threads running their VMs (as --vm-threads), the world being stepped
+// as in the headless mode of the playground.
+
+#include "targets/playground/EnkiGlue.h"
+#include "targets/playground/Robots.h"
+#include "targets/playground/VMScheduler.h"
+#include "common/msg/NodesManager.h"
+#include "compiler/compiler.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace Aseba;
+using namespace Enki;
+using namespace std;
+
+struct BenchNodesManager : NodesManager {
+    DirectAsebaThymio2* thymio;
+
+    BenchNodesManager(DirectAsebaThymio2* thymio) : thymio(thymio) {}
+
+    void sendMessage(const Message& message) override {
+        thymio->inQueue.emplace(message.clone());
+    }
+};
+
+struct BenchSimulatorEnvironment : SimulatorEnvironment {
+    World& world;
+
+    BenchSimulatorEnvironment(World& world) : world(world) {}
+
+    void notify(const EnvironmentNotificationType type, const string& description, const strings& arguments) override {}
+
+    string getSDFilePath(const string& robotName, unsigned fileNumber) const override {
+        return "";
+    }
+
+    World* getWorld() const override {
+        return &world;
+    }
+};
+
+// each robot moves according to a weighted sum of its proximity sensors, computed at every prox event
+static const wchar_t program[] =
+    L"var i\n"
+    L"var sum\n"
+    L"var weights[7] = [3, 2, 1, 0, -1, -2, -3]\n"
+    L"onevent prox\n"
+    L"sum = 0\n"
+    L"for i in 0:34 do\n"
+    L"  sum = sum + (prox.horizontal[i % 7] * weights[i % 7]) / 64\n"
+    L"end\n"
+    L"motor.left.target = 200 + sum / 16\n"
+    L"motor.right.target = 200 - sum / 16\n";
+
+int main(int argc, char** argv) {
+    unsigned robotsCount = 200;
+    unsigned steps = 300;
+    vector<unsigned> threadCounts = {0, 1, 2, 4, 8};
+    for(int i = 1; i < argc; ++i) {
+        const string arg(argv[i]);
+        if(arg == "--robots" && i + 1 < argc) {
+            robotsCount = atoi(argv[++i]);
+        } else if(arg == "--steps" && i + 1 < argc) {
+            steps = atoi(argv[++i]);
+        } else if(arg == "--vm-threads" && i + 1 < argc) {
+            threadCounts = {unsigned(atoi(argv[++i]))};
+        } else {
+            cerr << "Usage: " << argv[0] << " [--robots N] [--steps N] [--vm-threads COUNT]" << endl;
+            return 1;
+        }
+    }
+
+    // parameters, as in the headless mode of the playground
+    const double dt(0.03);
+    const unsigned physicsOversampling(3);
+
+    // create world and robots on a grid
+    const unsigned columns(20);
+    const double spacing(15);
+    World world(columns * spacing, (robotsCount / columns + 1) * spacing);
+    simulatorEnvironment.reset(new BenchSimulatorEnvironment(world));
+
+    vector<DirectAsebaThymio2*> thymios;
+    for(unsigned i = 0; i < robotsCount; ++i) {
+        auto* thymio(new DirectAsebaThymio2("thymio2_" + to_string(i), i + 1));
+        thymio->pos = {(i % columns + 0.5) * spacing, (i / columns + 0.5) * spacing};
+        thymio->angle = i;
+        world.addObject(thymio);
+        thymios.push_back(thymio);
+    }
+
+    // drop what robots send, as no one listens to them
+    auto step = [&]() {
+        world.step(dt, physicsOversampling);
+        vmScheduler.step();
+        for(auto* thymio : thymios)
+            while(!thymio->outQueue.empty())
+                thymio->outQueue.pop();
+    };
+
+    // get the description of the robots from the first one
+    BenchNodesManager nodesManager(thymios[0]);
+    thymios[0]->inQueue.emplace(ListNodes().clone());
+    for(unsigned i = 0; i < 2; ++i) {
+        world.step(dt, physicsOversampling);
+        while(!thymios[0]->outQueue.empty()) {
+            nodesManager.processMessage(thymios[0]->outQueue.front().get());
+            thymios[0]->outQueue.pop();
+        }
+    }
+    bool ok(false);
+    const unsigned firstNodeId(nodesManager.getNodeId(L"thymio-II", 0, &ok));
+    const TargetDescription* targetDescription(nodesManager.getDescription(firstNodeId));
+    if(!ok || !targetDescription) {
+        cerr << "nodes manager did not get the description of \"thymio-II\"" << endl;
+        return 2;
+    }
+
+    // compile the program and load it on all robots
+    Compiler compiler;
+    CommonDefinitions commonDefinitions;
+    compiler.setTargetDescription(targetDescription);
+    compiler.setCommonDefinitions(&commonDefinitions);
+    wistringstream programStream(program);
+    BytecodeVector bytecode;
+    unsigned allocatedVariablesCount;
+    Error errorDescription;
+    if(!compiler.compile(programStream, bytecode, allocatedVariablesCount, errorDescription)) {
+        wcerr << L"compilation error: " << errorDescription.toWString() << endl;
+        return 3;
+    }
+    for(unsigned i = 0; i < robotsCount; ++i) {
+        vector<unique_ptr<Message>> setBytecodeMessages;
+        sendBytecode(setBytecodeMessages, i + 1, vector<uint16_t>(bytecode.begin(), bytecode.end()));
+        for(auto& message : setBytecodeMessages)
+            thymios[i]->inQueue.emplace(move(message));
+        thymios[i]->inQueue.emplace(new Run(i + 1));
+    }
+    step();
+
+    cout << robotsCount << " robots, " << steps << " steps of " << dt << " s" << endl;
+    for(const unsigned threadCount : threadCounts) {
+        vmScheduler.setThreadCount(threadCount);
+        const auto start(chrono::steady_clock::now());
+        for(unsigned i = 0; i < steps; ++i)
+            step();
+        const double duration(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        cout << "--vm-threads " << threadCount << ": " << fixed << setprecision(3) << duration << " s, "
+             << setprecision(1) << steps * dt / duration << " simulated seconds per wall second" << endl;
+    }
+    vmScheduler.setThreadCount(0);
+
+    return 0;
+}
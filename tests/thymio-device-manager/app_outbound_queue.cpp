@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/app_outbound_queue.h>
+#include <boost/uuid/random_generator.hpp>
+
+using mobsya::app_outbound_queue;
+using mobsya::fb::AnyMessage;
+
+static app_outbound_queue::buffer_ptr message(AnyMessage tag, std::size_t size = 100) {
+    flatbuffers::FlatBufferBuilder fb;
+    fb.Finish(fb.CreateVector(std::vector<uint8_t>(size)));
+    return std::make_shared<mobsya::tagged_detached_flatbuffer>(
+        mobsya::tagged_detached_flatbuffer{fb.ReleaseBufferPointer(), tag});
+}
+
+static app_outbound_queue make_queue(app_outbound_queue::policy policy, std::size_t messages) {
+    app_outbound_queue queue;
+    queue.set_limits({messages * message(AnyMessage::NodesChanged)->buffer.size(), policy});
+    return queue;
+}
+
+TEST_CASE("Variables updates are coalesced per node", "[app_outbound_queue]") {
+    auto queue = make_queue(app_outbound_queue::policy::coalesce, 4);
+    const mobsya::node_id a = boost::uuids::random_generator()();
+    const mobsya::node_id b = boost::uuids::random_generator()();
+
+    // The first message is being written and is never removed
+    REQUIRE(queue.push(message(AnyMessage::NodeVariablesChanged), a));
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    for(int i = 0; i < 4; i++) {
+        REQUIRE(queue.push(message(AnyMessage::NodeVariablesChanged), a));
+        REQUIRE(queue.push(message(AnyMessage::NodeVariablesChanged), b));
+    }
+    REQUIRE(queue.stats().coalesced > 0);
+    REQUIRE(queue.stats().dropped == 0);
+    REQUIRE(queue.size() <= 4 * message(AnyMessage::NodesChanged)->buffer.size());
+    REQUIRE(queue.front().tag == AnyMessage::NodeVariablesChanged);
+
+    // Nodes are resynchronized once the application caught up
+    REQUIRE(queue.take_nodes_to_resync().empty());
+    bool nodes_changed_sent = false;
+    while(!queue.empty()) {
+        nodes_changed_sent |= queue.front().tag == AnyMessage::NodesChanged;
+        queue.pop();
+    }
+    REQUIRE(nodes_changed_sent);
+    auto nodes = queue.take_nodes_to_resync();
+    REQUIRE(nodes.size() == 2);
+    REQUIRE(queue.take_nodes_to_resync().empty());
+}
+
+TEST_CASE("Oldest notifications are dropped", "[app_outbound_queue]") {
+    auto queue = make_queue(app_outbound_queue::policy::drop_oldest, 3);
+    REQUIRE(queue.push(message(AnyMessage::EventsEmitted)));
+    REQUIRE(queue.push(message(AnyMessage::EventsEmitted, 10)));
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    REQUIRE(queue.push(message(AnyMessage::EventsEmitted)));
+    REQUIRE(queue.stats().dropped == 1);
+
+    // Other messages are kept even past the limit
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    REQUIRE(queue.stats().dropped == 2);
+    queue.pop();
+    REQUIRE(queue.front().tag == AnyMessage::NodesChanged);
+    REQUIRE(queue.take_nodes_to_resync().empty());
+}
+
+TEST_CASE("Slow applications can be disconnected", "[app_outbound_queue]") {
+    auto queue = make_queue(app_outbound_queue::policy::disconnect, 2);
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    REQUIRE(queue.push(message(AnyMessage::NodesChanged)));
+    REQUIRE_FALSE(queue.push(message(AnyMessage::NodesChanged)));
+}
+
+TEST_CASE("Slow application policies are parsed", "[app_outbound_queue]") {
+    REQUIRE(app_outbound_queue::policy_from_string("coalesce") == app_outbound_queue::policy::coalesce);
+    REQUIRE(app_outbound_queue::policy_from_string("drop") == app_outbound_queue::policy::drop_oldest);
+    REQUIRE(app_outbound_queue::policy_from_string("disconnect") == app_outbound_queue::policy::disconnect);
+    REQUIRE_FALSE(app_outbound_queue::policy_from_string("ignore"));
+}
@@ -0,0 +1,58 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/aseba_message_parser.h>
+#include <aseba/thymio-device-manager/aseba_message_writer.h>
+#include <algorithm>
+
+static std::size_t feed(mobsya::aseba_message_reader& reader, const std::vector<uint8_t>& data, std::size_t pos,
+                        std::size_t count) {
+    auto buffer = reader.prepare();
+    count = std::min({count, data.size() - pos, buffer.size()});
+    std::copy_n(data.begin() + pos, count, static_cast<uint8_t*>(buffer.data()));
+    reader.commit(count);
+    return pos + count;
+}
+
+TEST_CASE("Messages received together are decoded from a single read", "[aseba_message_reader]") {
+    Aseba::Message::SerializationBuffer stream;
+    mobsya::serialize_aseba_message(Aseba::ListNodes(), stream);
+    mobsya::serialize_aseba_message(Aseba::GetVariables(12, 4, 8), stream);
+    mobsya::serialize_aseba_message(Aseba::UserMessage(3, std::vector<int16_t>(200, 7)), stream);
+
+    mobsya::aseba_message_reader reader;
+    REQUIRE_FALSE(reader.next());
+    feed(reader, stream.rawData, 0, stream.rawData.size());
+
+    auto list = reader.next();
+    REQUIRE(list);
+    REQUIRE(list->type == ASEBA_MESSAGE_LIST_NODES);
+    auto get = reader.next();
+    REQUIRE(get);
+    REQUIRE(get->type == ASEBA_MESSAGE_GET_VARIABLES);
+    REQUIRE(static_cast<Aseba::GetVariables&>(*get).start == 4);
+    REQUIRE(static_cast<Aseba::GetVariables&>(*get).length == 8);
+    auto event = reader.next();
+    REQUIRE(event);
+    REQUIRE(event->type == 3);
+    REQUIRE(static_cast<Aseba::UserMessage&>(*event).data == std::vector<int16_t>(200, 7));
+    REQUIRE_FALSE(reader.next());
+}
+
+TEST_CASE("Messages split across reads are reassembled", "[aseba_message_reader]") {
+    Aseba::Message::SerializationBuffer stream;
+    for(int i = 0; i < 50; i++)
+        mobsya::serialize_aseba_message(Aseba::UserMessage(i, std::vector<int16_t>(i * 5, int16_t(i))), stream);
+
+    mobsya::aseba_message_reader reader;
+    std::size_t pos = 0;
+    int received = 0;
+    while(pos < stream.rawData.size()) {
+        pos = feed(reader, stream.rawData, pos, 37);
+        while(auto msg = reader.next()) {
+            REQUIRE(msg->type == received);
+            REQUIRE(static_cast<Aseba::UserMessage&>(*msg).data ==
+                    std::vector<int16_t>(received * 5, int16_t(received)));
+            received++;
+        }
+    }
+    REQUIRE(received == 50);
+}
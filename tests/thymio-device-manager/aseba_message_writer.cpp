@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/aseba_message_parser.h>
+#include <aseba/thymio-device-manager/aseba_message_writer.h>
+
+using message_ptr = std::shared_ptr<Aseba::Message>;
+
+// Serialize the messages in batches of at most max_size bytes, as the endpoints write them
+static std::vector<std::vector<uint8_t>> batches(const std::vector<message_ptr>& messages, std::size_t max_size) {
+    std::vector<std::vector<uint8_t>> batches;
+    Aseba::Message::SerializationBuffer buffer;
+    auto it = messages.begin();
+    while(it != messages.end()) {
+        buffer.rawData.clear();
+        const auto count = mobsya::serialize_aseba_messages(
+            it, messages.end(), max_size, buffer, [](const message_ptr& m) -> const Aseba::Message& { return *m; });
+        REQUIRE(count > 0);
+        it += count;
+        batches.push_back(buffer.rawData);
+    }
+    return batches;
+}
+
+static std::vector<uint16_t> decode(const std::vector<std::vector<uint8_t>>& batches) {
+    std::vector<uint16_t> types;
+    mobsya::aseba_message_reader reader;
+    for(const auto& batch : batches) {
+        std::size_t pos = 0;
+        while(pos < batch.size()) {
+            auto buffer = reader.prepare();
+            const auto count = std::min(batch.size() - pos, buffer.size());
+            std::copy_n(batch.begin() + pos, count, static_cast<uint8_t*>(buffer.data()));
+            reader.commit(count);
+            pos += count;
+            while(auto message = reader.next())
+                types.push_back(message->type);
+        }
+    }
+    return types;
+}
+
+TEST_CASE("Batches fit in the maximum write size and keep the messages order", "[aseba_message_writer]") {
+    std::vector<message_ptr> messages;
+    std::vector<uint16_t> types;
+    for(uint16_t i = 0; i < 40; i++) {
+        messages.push_back(std::make_shared<Aseba::UserMessage>(i, std::vector<int16_t>(i % 7 * 10, 1)));
+        types.push_back(i);
+    }
+
+    for(std::size_t max_size : {std::size_t(ASEBA_MAX_OUTER_PACKET_SIZE), std::size_t(512), std::size_t(16 * 1024)}) {
+        const auto written = batches(messages, max_size);
+        for(const auto& batch : written)
+            REQUIRE(batch.size() <= max_size);
+        if(max_size < 16 * 1024)
+            REQUIRE(written.size() > 1);
+        else
+            REQUIRE(written.size() == 1);
+        REQUIRE(decode(written) == types);
+    }
+}
+
+TEST_CASE("Messages larger than the maximum write size are written alone", "[aseba_message_writer]") {
+    const std::vector<message_ptr> messages{
+        std::make_shared<Aseba::ListNodes>(), std::make_shared<Aseba::UserMessage>(3, std::vector<int16_t>(200, 7)),
+        std::make_shared<Aseba::ListNodes>()};
+    const auto written = batches(messages, 64);
+    REQUIRE(written.size() == 3);
+    REQUIRE(written[1].size() > 64);
+    REQUIRE(decode(written) == std::vector<uint16_t>{ASEBA_MESSAGE_LIST_NODES, 3, ASEBA_MESSAGE_LIST_NODES});
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/compilation_cache.h>
+
+static std::string key_for(const std::string& program) {
+    Aseba::TargetDescription description;
+    description.name = L"thymio-II";
+    description.bytecodeSize = 1534;
+    Aseba::CommonDefinitions defs;
+    defs.constants.emplace_back(L"SPEED", 200);
+    return mobsya::compilation_cache::make_key(description, defs, mobsya::fb::ProgrammingLanguage::Aseba,
+                                               mobsya::fb::VectorLoops::WhenSmaller, program);
+}
+
+TEST_CASE("Keys depend on all the inputs of a compilation", "[compilation_cache]") {
+    using mobsya::compilation_cache;
+    using mobsya::fb::ProgrammingLanguage;
+    using mobsya::fb::VectorLoops;
+    Aseba::TargetDescription description;
+    description.name = L"thymio-II";
+    Aseba::CommonDefinitions defs;
+    const auto aseba = ProgrammingLanguage::Aseba;
+    const auto smaller = VectorLoops::WhenSmaller;
+    const auto key = compilation_cache::make_key(description, defs, aseba, smaller, "");
+    REQUIRE(key == compilation_cache::make_key(description, defs, aseba, smaller, ""));
+    REQUIRE(key != compilation_cache::make_key(description, defs, ProgrammingLanguage::Aesl, smaller, ""));
+    REQUIRE(key != compilation_cache::make_key(description, defs, aseba, VectorLoops::Never, ""));
+    REQUIRE(key != compilation_cache::make_key(description, defs, aseba, smaller, "var a"));
+
+    auto other_defs = defs;
+    other_defs.events.emplace_back(L"ping", 0);
+    REQUIRE(key != compilation_cache::make_key(description, other_defs, aseba, smaller, ""));
+
+    auto other_description = description;
+    other_description.namedVariables.emplace_back(L"leds", 8);
+    REQUIRE(key != compilation_cache::make_key(other_description, defs, aseba, smaller, ""));
+}
+
+TEST_CASE("Identical compilations are coalesced then cached", "[compilation_cache]") {
+    boost::asio::io_context ctx;
+    auto& cache = boost::asio::make_service<mobsya::compilation_cache>(ctx);
+    const auto key = key_for("var a = 1");
+
+    int received = 0;
+    auto waiter = [&](mobsya::compilation_cache::program_ptr p) {
+        REQUIRE(p);
+        received++;
+    };
+    bool compile = false;
+    REQUIRE_FALSE(cache.find(key, waiter, compile));
+    REQUIRE(compile);
+    REQUIRE_FALSE(cache.find(key, waiter, compile));
+    REQUIRE_FALSE(compile);
+    REQUIRE_FALSE(cache.find(key, waiter, compile));
+    REQUIRE_FALSE(compile);
+
+    auto program = std::make_shared<mobsya::compiled_program>();
+    program->bytecode.push_back(Aseba::BytecodeElement(0x1234, 3));
+    cache.insert(key, program);
+    REQUIRE(received == 2);
+
+    auto cached = cache.find(key, waiter, compile);
+    REQUIRE(cached == program);
+    REQUIRE_FALSE(compile);
+    REQUIRE(cached->bytecode[0].line == 3);
+
+    const auto stats = cache.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.coalesced == 2);
+    REQUIRE(stats.size == 1);
+}
+
+TEST_CASE("Least recently used programs are evicted", "[compilation_cache]") {
+    boost::asio::io_context ctx;
+    auto& cache = boost::asio::make_service<mobsya::compilation_cache>(ctx);
+    cache.set_capacity(2);
+    bool compile = false;
+    auto add = [&](const std::string& key) {
+        REQUIRE_FALSE(cache.find(key, {}, compile));
+        REQUIRE(compile);
+        cache.insert(key, std::make_shared<mobsya::compiled_program>());
+    };
+
+    add(key_for("a"));
+    add(key_for("b"));
+    // "a" becomes the most recently used
+    REQUIRE(cache.find(key_for("a"), {}, compile));
+    add(key_for("c"));
+
+    REQUIRE(cache.find(key_for("a"), {}, compile));
+    REQUIRE(cache.find(key_for("c"), {}, compile));
+    REQUIRE_FALSE(cache.find(key_for("b"), {}, compile));
+    REQUIRE(compile);
+    REQUIRE(cache.stats().evictions == 1);
+    REQUIRE(cache.stats().size == 2);
+}
+
+TEST_CASE("Abandoned compilations are not cached", "[compilation_cache]") {
+    boost::asio::io_context ctx;
+    auto& cache = boost::asio::make_service<mobsya::compilation_cache>(ctx);
+    const auto key = key_for("var b");
+    bool compile = false;
+    mobsya::compilation_cache::program_ptr received;
+    REQUIRE_FALSE(cache.find(key, {}, compile));
+    REQUIRE_FALSE(cache.find(key, [&](mobsya::compilation_cache::program_ptr p) { received = p; }, compile));
+
+    auto program = std::make_shared<mobsya::compiled_program>();
+    cache.abandon(key, program);
+    REQUIRE(received == program);
+    REQUIRE_FALSE(cache.find(key, {}, compile));
+    REQUIRE(compile);
+    REQUIRE(cache.stats().size == 0);
+}
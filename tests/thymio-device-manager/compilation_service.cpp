@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/compilation_service.h>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+TEST_CASE("Compilations complete on the given executor", "[compilation_service]") {
+    boost::asio::io_context ctx;
+    auto& service = boost::asio::make_service<mobsya::compilation_service>(ctx);
+    service.configure(2, 16);
+    auto strand = boost::asio::make_strand(ctx);
+
+    const auto io_thread = std::this_thread::get_id();
+    std::atomic<int> compiled{0};
+    int completed = 0;
+    for(int i = 0; i < 10; i++) {
+        REQUIRE(service.post(
+            [&] {
+                // Catch assertions are not thread safe, only count compilations running off the io thread
+                if(std::this_thread::get_id() != io_thread)
+                    compiled++;
+            },
+            strand,
+            [&] {
+                REQUIRE(std::this_thread::get_id() == io_thread);
+                completed++;
+            }));
+    }
+    // pending compilations keep the context running
+    ctx.run();
+    REQUIRE(completed == 10);
+
+    REQUIRE(compiled == 10);
+    const auto stats = service.stats();
+    REQUIRE(stats.completed == 10);
+    REQUIRE(stats.queue_depth == 0);
+    REQUIRE(stats.rejected == 0);
+    REQUIRE(stats.max_queue_depth >= 1);
+    REQUIRE(stats.max_latency >= stats.max_compilation_time);
+}
+
+TEST_CASE("Compilations are rejected when the queue is full", "[compilation_service]") {
+    boost::asio::io_context ctx;
+    auto& service = boost::asio::make_service<mobsya::compilation_service>(ctx);
+    service.configure(1, 2);
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool release = false;
+    auto blocking_job = [&] {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return release; });
+    };
+    int completed = 0;
+    auto completion = [&] { completed++; };
+
+    REQUIRE(service.post(blocking_job, ctx.get_executor(), completion));
+    REQUIRE(service.post(blocking_job, ctx.get_executor(), completion));
+    REQUIRE_FALSE(service.post(blocking_job, ctx.get_executor(), completion));
+    REQUIRE(service.stats().rejected == 1);
+    REQUIRE(service.stats().queue_depth == 2);
+
+    {
+        std::unique_lock<std::mutex> lock(m);
+        release = true;
+    }
+    cv.notify_all();
+    ctx.run();
+    REQUIRE(completed == 2);
+
+    REQUIRE(service.stats().queue_depth == 0);
+    REQUIRE(service.post([] {}, ctx.get_executor(), completion));
+    ctx.restart();
+    ctx.run();
+    REQUIRE(completed == 3);
+}
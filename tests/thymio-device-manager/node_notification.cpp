@@ -0,0 +1,28 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/node_notification.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Notifications are serialized once", "[node_notification]") {
+    auto notification = mobsya::make_node_notification(std::vector<int>{1, 2, 3});
+    REQUIRE(notification->payload().size() == 3);
+
+    std::atomic<int> serializations{0};
+    auto serialize = [&serializations](const std::vector<int>& payload) {
+        serializations++;
+        return mobsya::tagged_detached_flatbuffer{flatbuffers::DetachedBuffer(), mobsya::fb::AnyMessage::NONE};
+    };
+
+    std::vector<std::shared_ptr<const mobsya::tagged_detached_flatbuffer>> buffers(8);
+    std::vector<std::thread> threads;
+    for(std::size_t i = 0; i < buffers.size(); i++) {
+        threads.emplace_back([&, i] { buffers[i] = notification->serialized(serialize); });
+    }
+    for(auto& t : threads)
+        t.join();
+
+    REQUIRE(serializations == 1);
+    for(const auto& buffer : buffers)
+        REQUIRE(buffer == buffers[0]);
+}
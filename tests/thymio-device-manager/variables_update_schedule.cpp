@@ -0,0 +1,77 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/variables_update_schedule.h>
+
+using mobsya::variables_update_schedule;
+using namespace std::chrono_literals;
+
+TEST_CASE("Watchers periods are bounded", "[variables_update_schedule]") {
+    REQUIRE(variables_update_schedule::watcher_period(0ms) == variables_update_schedule::DEFAULT_PERIOD);
+    REQUIRE(variables_update_schedule::watcher_period(1ms) == variables_update_schedule::MIN_PERIOD);
+    REQUIRE(variables_update_schedule::watcher_period(50ms) == 50ms);
+}
+
+TEST_CASE("Updates back off while variables do not change", "[variables_update_schedule]") {
+    variables_update_schedule schedule;
+    REQUIRE(schedule.next_period(50ms) == 50ms);
+
+    std::vector<std::chrono::milliseconds> periods;
+    for(int i = 0; i < 5; i++) {
+        REQUIRE(schedule.should_request());
+        schedule.requested(1);
+        schedule.received(false);
+        periods.push_back(schedule.next_period(50ms));
+    }
+    // Doubled up to 8 times the requested period
+    REQUIRE(periods == std::vector<std::chrono::milliseconds>{100ms, 200ms, 400ms, 400ms, 400ms});
+
+    // A change brings the requested period back
+    schedule.requested(1);
+    schedule.received(true);
+    REQUIRE(schedule.next_period(50ms) == 50ms);
+}
+
+TEST_CASE("Backing off is capped at one second", "[variables_update_schedule]") {
+    variables_update_schedule schedule;
+    for(int i = 0; i < 4; i++) {
+        schedule.requested(1);
+        schedule.received(false);
+    }
+    REQUIRE(schedule.next_period(100ms) == 800ms);
+    REQUIRE(schedule.next_period(200ms) == 1s);
+    // Unless a slower period was requested
+    REQUIRE(schedule.next_period(2s) == 2s);
+
+    schedule.reset_backoff();
+    REQUIRE(schedule.next_period(200ms) == 200ms);
+}
+
+TEST_CASE("Backing off waits for all the replies", "[variables_update_schedule]") {
+    variables_update_schedule schedule;
+    schedule.requested(3);
+    schedule.received(false);
+    schedule.received(false);
+    REQUIRE(schedule.pending_replies() == 1);
+    REQUIRE(schedule.next_period(100ms) == 100ms);
+    schedule.received(false);
+    REQUIRE(schedule.pending_replies() == 0);
+    REQUIRE(schedule.next_period(100ms) == 200ms);
+}
+
+TEST_CASE("Updates are skipped while a request is pending", "[variables_update_schedule]") {
+    variables_update_schedule schedule;
+    schedule.requested(1);
+
+    // Skipped, backing off, until the request is considered lost
+    for(unsigned i = 1; i < variables_update_schedule::MAX_SKIPPED_VARIABLES_UPDATES; i++) {
+        REQUIRE_FALSE(schedule.should_request());
+    }
+    REQUIRE(schedule.next_period(100ms) == 800ms);
+    REQUIRE(schedule.should_request());
+
+    // Requesting again starts counting the skipped updates from scratch
+    schedule.requested(1);
+    REQUIRE_FALSE(schedule.should_request());
+    schedule.received(true);
+    REQUIRE(schedule.should_request());
+    REQUIRE(schedule.next_period(100ms) == 100ms);
+}
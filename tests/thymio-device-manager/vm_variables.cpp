@@ -0,0 +1,93 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/vm_variables.h>
+
+using mobsya::vm_variables;
+
+static std::vector<std::string> take_changed(vm_variables& variables) {
+    std::vector<std::string> names;
+    variables.take_changed([&names](const vm_variables::variable& var) { names.push_back(var.name); });
+    return names;
+}
+
+// a at 0, b[3] at 1, a hole at 4 and 5, c at 6
+static vm_variables make_variables() {
+    vm_variables variables;
+    variables.reset({{L"c", {6, 1}}, {L"b", {1, 3}}, {L"a", {0, 1}}});
+    return variables;
+}
+
+TEST_CASE("Addresses map to the variables spanning them", "[vm_variables]") {
+    auto variables = make_variables();
+    REQUIRE(variables.size() == 3);
+    REQUIRE(variables.at(0)->name == "a");
+    for(uint16_t address = 1; address < 4; address++) {
+        REQUIRE(variables.at(address)->name == "b");
+    }
+    REQUIRE_FALSE(variables.at(4));
+    REQUIRE_FALSE(variables.at(5));
+    REQUIRE(variables.at(6)->name == "c");
+    REQUIRE_FALSE(variables.at(7));
+
+    // Sorted by address
+    std::vector<std::string> names;
+    for(const auto& var : variables)
+        names.push_back(var.name);
+    REQUIRE(names == std::vector<std::string>{"a", "b", "c"});
+    REQUIRE(variables.find("b")->start == 1);
+    REQUIRE_FALSE(variables.find("d"));
+}
+
+TEST_CASE("Values are set across variables and holes", "[vm_variables]") {
+    auto variables = make_variables();
+    variables.set(0, {1, 2, 3, 4, 42, 42, 7, 42});
+    REQUIRE(variables.find("a")->value == std::vector<int16_t>{1});
+    REQUIRE(variables.find("b")->value == std::vector<int16_t>{2, 3, 4});
+    REQUIRE(variables.find("c")->value == std::vector<int16_t>{7});
+
+    // Part of an array
+    variables.set(2, {30, 40});
+    REQUIRE(variables.find("b")->value == std::vector<int16_t>{2, 30, 40});
+    variables.set(3, {400, 0, 0, 70});
+    REQUIRE(variables.find("b")->value == std::vector<int16_t>{2, 30, 400});
+    REQUIRE(variables.find("c")->value == std::vector<int16_t>{70});
+}
+
+TEST_CASE("Values not sent yet are zero", "[vm_variables]") {
+    auto variables = make_variables();
+    variables.set(3, {4});
+    REQUIRE(variables.find("a")->value.empty());
+    REQUIRE(variables.find("b")->value == std::vector<int16_t>{0, 0, 4});
+}
+
+TEST_CASE("Changed variables are taken once, in the order they changed", "[vm_variables]") {
+    auto variables = make_variables();
+    variables.set(6, {7});
+    variables.set(0, {1, 2, 3, 4});
+    REQUIRE(take_changed(variables) == std::vector<std::string>{"c", "a", "b"});
+    REQUIRE(take_changed(variables).empty());
+
+    // Setting the same values changes nothing
+    variables.set(0, {1, 2, 3, 4, 0, 0, 7});
+    REQUIRE(take_changed(variables).empty());
+
+    // A variable changed several times is taken once
+    variables.set(2, {5});
+    variables.set(3, {6});
+    variables.set(0, {0});
+    REQUIRE(take_changed(variables) == std::vector<std::string>{"b", "a"});
+    REQUIRE(variables.find("b")->value == std::vector<int16_t>{2, 5, 6});
+
+    // Changes in holes are ignored
+    variables.set(4, {1, 1});
+    REQUIRE(take_changed(variables).empty());
+}
+
+TEST_CASE("Resetting the variables forgets the changes", "[vm_variables]") {
+    auto variables = make_variables();
+    variables.set(0, {1});
+    variables.reset({{L"d", {0, 2}}});
+    REQUIRE(take_changed(variables).empty());
+    REQUIRE(variables.at(1)->name == "d");
+    REQUIRE_FALSE(variables.at(2));
+    REQUIRE(variables.find("d")->value.empty());
+}
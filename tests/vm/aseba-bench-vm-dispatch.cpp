@@ -0,0 +1,238 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compare the switch interpreter with the threaded dispatch engine of the VM:
+// both must reach exactly the same state, also when stopping on breakpoints,
+// and the time taken by each is reported.
+
+// Aseba
+#include "compiler/compiler.h"
+#include "vm/vm.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+#include "common/msg/msg.h"
+#include "common/utils/utils.h"
+using namespace Aseba;
+
+// C++
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <valarray>
+#include <chrono>
+#include <cstring>
+
+// C
+#include <stdlib.h>  // exit()
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsDescriptions(AsebaVMState* vm) {
+    return nativeFunctionsDescriptions;
+}
+
+struct BenchNode {
+    AsebaVMState vm;
+    std::valarray<unsigned short> bytecode;
+    std::valarray<signed short> stack;
+    std::valarray<AsebaVMThreadedInstruction> threadedCode;
+    std::valarray<signed short> variables, variablesOld;
+
+    BenchNode(bool threaded) {
+        vm.nodeId = 1;
+        bytecode.resize(1024);
+        vm.bytecode = &bytecode[0];
+        vm.bytecodeSize = bytecode.size();
+        threadedCode.resize(bytecode.size());
+        vm.threadedCode = threaded ? &threadedCode[0] : nullptr;
+
+        stack.resize(64);
+        vm.stack = &stack[0];
+        vm.stackSize = stack.size();
+
+        variables.resize(1024);
+        variablesOld.resize(1024);
+        vm.variables = &variables[0];
+        vm.variablesOld = &variablesOld[0];
+        vm.variablesSize = variables.size();
+
+        AsebaVMInit(&vm);
+    }
+
+    void loadBytecode(const BytecodeVector& program) {
+        std::vector<std::unique_ptr<Message>> messagesVector;
+        sendBytecode(messagesVector, 1, std::vector<uint16_t>(program.begin(), program.end()));
+        for(auto& message : messagesVector) {
+            Message::SerializationBuffer data;
+            message->serializeSpecific(data);
+            AsebaVMDebugMessage(&vm, message->type, reinterpret_cast<uint16_t*>(&data.rawData[0]),
+                                data.rawData.size() / 2);
+        }
+    }
+
+    void runInit(uint16_t stepsLimit) {
+        variables = 0;
+        vm.flags = 0;
+        AsebaVMSetupEvent(&vm, ASEBA_EVENT_INIT);
+        AsebaVMRun(&vm, stepsLimit);
+    }
+
+    bool sameStateAs(const BenchNode& that) const {
+        return vm.pc == that.vm.pc && vm.sp == that.vm.sp && vm.flags == that.vm.flags &&
+            std::memcmp(&variables[0], &that.variables[0], variables.size() * sizeof(int16_t)) == 0 &&
+            std::memcmp(&stack[0], &that.stack[0], stack.size() * sizeof(int16_t)) == 0 &&
+            std::memcmp(&bytecode[0], &that.bytecode[0], bytecode.size() * sizeof(uint16_t)) == 0;
+    }
+};
+
+static TargetDescription describe(const BenchNode& node) {
+    TargetDescription d;
+    d.name = L"benchvm";
+    d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+    d.bytecodeSize = node.vm.bytecodeSize;
+    d.variablesSize = node.vm.variablesSize;
+    d.stackSize = node.vm.stackSize;
+
+    for(const AsebaNativeFunctionDescription* const* nativeDescs = nativeFunctionsDescriptions; *nativeDescs;
+        ++nativeDescs) {
+        const std::string name((*nativeDescs)->name);
+        const std::string doc((*nativeDescs)->doc);
+        TargetDescription::NativeFunction native{std::wstring(name.begin(), name.end()),
+                                                 std::wstring(doc.begin(), doc.end())};
+        for(const AsebaNativeFunctionArgumentDescription* param = (*nativeDescs)->arguments; param->size; ++param) {
+            const std::string paramName(param->name);
+            native.parameters.push_back(TargetDescription::NativeFunctionParameter(
+                std::wstring(paramName.begin(), paramName.end()), param->size));
+        }
+        d.nativeFunctions.push_back(native);
+    }
+    return d;
+}
+
+static std::wstring readSource(const std::string& filename) {
+    std::ifstream ifs(filename.c_str(), std::ifstream::binary);
+    if(!ifs.is_open()) {
+        std::cerr << "Error opening source file " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return UTF8ToWString(oss.str());
+}
+
+template <typename Function>
+static double timeIt(Function f) {
+    const auto start(std::chrono::steady_clock::now());
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    unsigned iterations = 10000;
+    int firstFile = 1;
+    if(argc > 2 && std::string(argv[1]) == "--iterations") {
+        iterations = atoi(argv[2]);
+        firstFile = 3;
+    }
+    if(firstFile >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] source..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool mismatch = false;
+    double totalSwitch = 0, totalThreaded = 0;
+    std::cout << std::left << std::setw(40) << "program" << std::right << std::setw(14) << "switch [us]"
+              << std::setw(14) << "threaded [us]" << std::setw(10) << "speedup" << std::endl;
+
+    for(int i = firstFile; i < argc; ++i) {
+        BenchNode switchNode(false), threadedNode(true);
+        const TargetDescription description(describe(switchNode));
+        CommonDefinitions definitions;
+
+        Compiler compiler;
+        compiler.setTargetDescription(&description);
+        compiler.setCommonDefinitions(&definitions);
+        std::wistringstream source(readSource(argv[i]));
+        BytecodeVector program;
+        unsigned varCount;
+        Error error;
+        if(!compiler.compile(source, program, varCount, error)) {
+            std::wcerr << L"Compilation of " << argv[i] << L" failed: " << error.toWString() << std::endl;
+            return EXIT_FAILURE;
+        }
+        switchNode.loadBytecode(program);
+        threadedNode.loadBytecode(program);
+
+        // interleave engines and check states after each run, including runs interrupted
+        // by a small steps limit, then time each engine alone
+        for(unsigned j = 0; j < std::min(iterations, 64u); ++j) {
+            const uint16_t stepsLimit(j % 2 ? 0xffff : j / 2 + 1);
+            switchNode.runInit(stepsLimit);
+            threadedNode.runInit(stepsLimit);
+            if(!switchNode.sameStateAs(threadedNode)) {
+                std::cerr << "State mismatch after running " << argv[i] << std::endl;
+                mismatch = true;
+                break;
+            }
+        }
+        // both engines must stop at the same place with a breakpoint on any instruction
+        for(uint16_t address = 0; address < program.size() && !mismatch; ++address) {
+            AsebaVMSetBreakpoint(&switchNode.vm, address);
+            AsebaVMSetBreakpoint(&threadedNode.vm, address);
+            switchNode.runInit(0xffff);
+            threadedNode.runInit(0xffff);
+            if(!switchNode.sameStateAs(threadedNode)) {
+                std::cerr << "State mismatch after running " << argv[i] << " with a breakpoint at " << address
+                          << std::endl;
+                mismatch = true;
+            }
+            AsebaVMClearBreakpoints(&switchNode.vm);
+            AsebaVMClearBreakpoints(&threadedNode.vm);
+        }
+        const double switchTime = timeIt([&] {
+            for(unsigned j = 0; j < iterations; ++j)
+                switchNode.runInit(0xffff);
+        });
+        const double threadedTime = timeIt([&] {
+            for(unsigned j = 0; j < iterations; ++j)
+                threadedNode.runInit(0xffff);
+        });
+        if(!switchNode.sameStateAs(threadedNode)) {
+            std::cerr << "State mismatch after timing " << argv[i] << std::endl;
+            mismatch = true;
+        }
+        totalSwitch += switchTime;
+        totalThreaded += threadedTime;
+
+        std::string name(argv[i]);
+        name = name.substr(name.find_last_of("/\\") + 1);
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << switchTime * 1e6 / iterations << std::setw(14)
+                  << threadedTime * 1e6 / iterations << std::setw(10) << switchTime / threadedTime << std::endl;
+    }
+
+    // time of a run of each program, summed over the programs, as in the rows above
+    std::cout << std::left << std::setw(40) << "total" << std::right << std::fixed << std::setprecision(3)
+              << std::setw(14) << totalSwitch * 1e6 / iterations << std::setw(14) << totalThreaded * 1e6 / iterations
+              << std::setw(10) << totalSwitch / totalThreaded << std::endl;
+
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}